@@ -22,13 +22,16 @@ def convert_svg_path_to_id(p):
 
 def addGeneralSettings(config_dic, win_x_size, win_y_size, sub_sampling, 
                        max_framerate, max_num_plotted, eq_names = [], 
-                       dv_buffer_size = 128, min_max_update_interval = 300):
+                       dv_buffer_size = 128, min_max_update_interval = 300,
+                       idle_framerate = 1, vsync = False,
+                       geometry_cache_file = 'lyrebird_geometry.cache'):
     assert(win_x_size > 0)
     assert(win_y_size > 0)
     assert(sub_sampling%2==0)
     assert(sub_sampling < 18)
     assert(max_num_plotted > 0)
     assert(min_max_update_interval > 0)
+    assert(idle_framerate > 0)
 
     
     config_dic['general_settings'] =  {'win_x_size': win_x_size,
@@ -38,7 +41,10 @@ def addGeneralSettings(config_dic, win_x_size, win_y_size, sub_sampling,
                                        'max_num_plotted': max_num_plotted,
                                        'eq_names': eq_names,
                                        'dv_buffer_size': dv_buffer_size,
-                                       'min_max_update_interval':min_max_update_interval
+                                       'min_max_update_interval':min_max_update_interval,
+                                       'idle_framerate': idle_framerate,
+                                       'vsync': vsync,
+                                       'geometry_cache_file': geometry_cache_file
                               }    
 def addDataVal(config_dic, dv_id, init_val, is_buffered):
     if not 'data_vals' in config_dic:
@@ -105,6 +111,55 @@ def addVisElem(config_dic,
 
 
 
+def addGridLayer(config_dic, grid_id, x_origin, y_origin, cell_width, cell_height,
+                 n_x, n_y, layer, cmap, cmap_min = 0.0, cmap_max = 1.0,
+                 aggregation = 'mean'):
+    assert(n_x > 0)
+    assert(n_y > 0)
+    assert(aggregation in ('mean', 'max'))
+    if not 'grid_layers' in config_dic:
+        config_dic['grid_layers'] = []
+    config_dic['grid_layers'].append(
+        {'id': grid_id,
+         'x_origin': x_origin,
+         'y_origin': y_origin,
+         'cell_width': cell_width,
+         'cell_height': cell_height,
+         'n_x': n_x,
+         'n_y': n_y,
+         'layer': layer,
+         'cmap': cmap,
+         'cmap_min': cmap_min,
+         'cmap_max': cmap_max,
+         'aggregation': aggregation,
+     })
+
+def addGridVisElem(config_dic, grid_id, grid_x, grid_y,
+                   highlight_path, x_scale, y_scale,
+                   labels, equations, labelled_data, group):
+    assert(len(labels))
+    assert(len(equations))
+
+    if not 'visual_elements' in config_dic:
+        config_dic['visual_elements'] = []
+
+    config_dic['visual_elements'].append(
+        {'grid_layer': grid_id,
+         'grid_x': grid_x,
+         'grid_y': grid_y,
+         'x_scale': x_scale,
+         'y_scale': y_scale,
+
+         'highlight_svg_path':highlight_path,
+         'highlight_svg_id':convert_svg_path_to_id(highlight_path),
+
+         'equations':equations,
+         'labels':labels,
+         'group': group,
+         'labelled_data': labelled_data,
+     })
+
+
 def validateConfigDic(config_dic):
     return True
 
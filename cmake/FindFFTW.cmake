@@ -2,14 +2,14 @@
 # Find the native FFTW includes and library
 #
 # FFTW_INCLUDES - where to find fftw3.h
-# FFTW_LIBRARIES - List of libraries when using FFTW.
+# FFTW_LIBRARIES - List of libraries when using FFTW, lyrebird uses the single precision one.
 # FFTW_FOUND - True if FFTW found.
 if (FFTW_INCLUDES)
 # Already in cache, be silent
 set (FFTW_FIND_QUIETLY TRUE)
 endif (FFTW_INCLUDES)
 find_path (FFTW_INCLUDES fftw3.h)
-find_library (FFTW_LIBRARIES NAMES fftw3)
+find_library (FFTW_LIBRARIES NAMES fftw3f)
 # handle the QUIETLY and REQUIRED arguments and set FFTW_FOUND to TRUE if
 # all listed variables are TRUE
 include (FindPackageHandleStandardArgs)
@@ -0,0 +1,206 @@
+#include "aggregate.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "logging.h"
+
+using namespace std;
+
+
+AggregatePlot::AggregatePlot(int buffer_size, FftPlanCache * fft_plans, int psd_segment_length, float psd_overlap,
+			     float refresh_time)
+  : buffer_size_(buffer_size), refresh_time_(refresh_time), next_time_(0),
+    plot_min_(0), plot_max_(1), psd_min_(0), psd_max_(1), sample_rate_(1), n_(0),
+    welch_(fft_plans, buffer_size,
+	   psd_segment_length > 0 ? psd_segment_length : buffer_size / 4,
+	   psd_overlap, AGGREGATE_PSD_BATCH),
+    job_mode_(AGGREGATE_MEAN_STD), job_n_(0),
+    is_queued_(false), is_running_(false), has_result_(false), is_stopping_(false){
+  plot_ = vector<float>(3 * buffer_size_, 0);
+  psd_ = vector<float>(3 * welch_.get_num_bins(), 0);
+  job_plot_ = plot_;
+  job_psd_ = psd_;
+  thread_ = std::thread(&AggregatePlot::worker_loop, this);
+}
+
+AggregatePlot::~AggregatePlot(){
+  {
+    lock_guard<mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+void AggregatePlot::get_plot(float *& center, float *& lower, float *& upper){
+  center = &(plot_[0]);
+  lower = center + buffer_size_;
+  upper = lower + buffer_size_;
+}
+
+void AggregatePlot::get_psd(float *& center, float *& lower, float *& upper){
+  int n_bins = welch_.get_num_bins();
+  center = &(psd_[0]);
+  lower = center + n_bins;
+  upper = lower + n_bins;
+}
+
+void AggregatePlot::get_psd_start_and_sep(float & start, float & sep){
+  start = 0;
+  sep = sample_rate_ / welch_.get_segment_length();
+}
+
+bool AggregatePlot::update(VisElemStore * vis_elems, const std::list<int> & elems, aggregate_mode mode, double time){
+  lock_guard<mutex> lock(mutex_);
+  if (is_queued_ || is_running_) return false;
+
+  bool picked_up = false;
+  if (has_result_){
+    has_result_ = false;
+    n_ = job_n_;
+    sample_rate_ = job_sample_rates_[0];
+    plot_.swap(job_plot_);
+    psd_.swap(job_psd_);
+    plot_min_ = 1e23;
+    plot_max_ = -1e23;
+    for (size_t i=0; i < plot_.size(); i++){
+      if (plot_[i] < plot_min_) plot_min_ = plot_[i];
+      if (plot_[i] > plot_max_) plot_max_ = plot_[i];
+    }
+    psd_min_ = 0;
+    psd_max_ = -1e30;
+    for (size_t i=0; i < psd_.size(); i++){
+      if (psd_[i] > psd_max_) psd_max_ = psd_[i];
+    }
+    picked_up = true;
+  }
+
+  if (time < next_time_ || elems.size() == 0 || mode == AGGREGATE_OFF) return picked_up;
+  next_time_ = time + refresh_time_;
+
+  job_mode_ = mode;
+  job_n_ = min((int)elems.size(), AGGREGATE_MAX_CHANNELS);
+  job_eqs_.resize(job_n_);
+  int i = 0;
+  for (auto it = elems.begin(); i < job_n_; ++it, i++) job_eqs_[i] = &(vis_elems->get_current_equation(*it));
+  if (elems.size() > AGGREGATE_MAX_CHANNELS){
+    log_debug("aggregate plot only uses the first %d of %zu elements", AGGREGATE_MAX_CHANNELS, elems.size());
+  }
+  is_queued_ = true;
+  cv_.notify_one();
+  return picked_up;
+}
+
+void AggregatePlot::worker_loop(){
+  while (true){
+    {
+      unique_lock<mutex> lock(mutex_);
+      cv_.wait(lock, [this]{return is_queued_ || is_stopping_;});
+      if (is_stopping_) return;
+      is_queued_ = false;
+      is_running_ = true;
+    }
+
+    //get_bulk_value takes the data vals lock itself
+    int n = job_n_;
+    job_in_.resize((size_t)n * buffer_size_);
+    job_sample_rates_.resize(n);
+    for (int i=0; i < n; i++){
+      job_eqs_[i]->get_bulk_value(&(job_in_[(size_t)i * buffer_size_]));
+      job_sample_rates_[i] = job_eqs_[i]->get_sample_rate();
+    }
+
+    int n_bins = welch_.get_num_bins();
+    job_plot_.resize(3 * buffer_size_);
+    job_psd_.resize(3 * n_bins);
+    reduce(&(job_in_[0]), n, buffer_size_, buffer_size_, job_mode_,
+	   &(job_plot_[0]), &(job_plot_[buffer_size_]), &(job_plot_[2 * buffer_size_]), job_scratch_);
+
+    //every element's spectrum, then the same statistic across them
+    job_asd_.resize((size_t)n * n_bins);
+    for (int b=0; b < n; b += AGGREGATE_PSD_BATCH){
+      int count = min(AGGREGATE_PSD_BATCH, n - b);
+      welch_.compute(&(job_in_[(size_t)b * buffer_size_]), count, &(job_sample_rates_[b]),
+		     &(job_asd_[(size_t)b * n_bins]));
+    }
+    for (size_t i=0; i < job_asd_.size(); i++) job_asd_[i] = sqrtf(job_asd_[i]);
+    reduce(&(job_asd_[0]), n, n_bins, n_bins, job_mode_,
+	   &(job_psd_[0]), &(job_psd_[n_bins]), &(job_psd_[2 * n_bins]), job_scratch_);
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      is_running_ = false;
+      has_result_ = true;
+    }
+    cv_.notify_all();
+  }
+}
+
+void AggregatePlot::wait_idle(){
+  unique_lock<mutex> lock(mutex_);
+  cv_.wait(lock, [this]{return !is_queued_ && !is_running_;});
+}
+
+void AggregatePlot::reduce(const float * z, int n, int n_samples, int stride, aggregate_mode mode,
+			   float * center, float * lower, float * upper, std::vector<float> & scratch){
+  if (mode != AGGREGATE_MEDIAN_PERCENTILES){
+    //sums of the differences from the first row, so an offset shared by the
+    //rows doesn't eat the precision of the squares
+    const float * ref = z;
+    fill(center, center + n_samples, 0.0f);
+    fill(upper, upper + n_samples, 0.0f);
+    for (int i=1; i < n; i++){
+      const float * row = z + (size_t)i * stride;
+      for (int t=0; t < n_samples; t++){
+	float d = row[t] - ref[t];
+	center[t] += d;
+	upper[t] += d * d;
+      }
+    }
+    for (int t=0; t < n_samples; t++){
+      float m = center[t] / n;
+      float var = upper[t] / n - m * m;
+      float sd = var > 0 ? sqrtf(var) : 0.0f;
+      center[t] = ref[t] + m;
+      lower[t] = center[t] - sd;
+      upper[t] = center[t] + sd;
+    }
+    return;
+  }
+
+  //a block of samples at a time with the elements of each sample next to
+  //each other, values that aren't finite are left out
+  scratch.resize((size_t)n * AGGREGATE_TRANSPOSE_BLOCK);
+  int counts[AGGREGATE_TRANSPOSE_BLOCK];
+  for (int t0=0; t0 < n_samples; t0 += AGGREGATE_TRANSPOSE_BLOCK){
+    int n_block = min(AGGREGATE_TRANSPOSE_BLOCK, n_samples - t0);
+    fill(counts, counts + n_block, 0);
+    for (int i=0; i < n; i++){
+      const float * row = z + (size_t)i * stride + t0;
+      for (int k=0; k < n_block; k++){
+	if (isfinite(row[k])) scratch[(size_t)k * n + counts[k]++] = row[k];
+      }
+    }
+    for (int k=0; k < n_block; k++){
+      float * col = &(scratch[(size_t)k * n]);
+      int c = counts[k];
+      int t = t0 + k;
+      if (c == 0){
+	center[t] = lower[t] = upper[t] = NAN;
+	continue;
+      }
+      //the median splits the column, so the percentiles only look at their half
+      int mid = (c - 1) / 2;
+      int lo = 0.1f * (c - 1) + 0.5f;
+      int hi = 0.9f * (c - 1) + 0.5f;
+      nth_element(col, col + mid, col + c);
+      center[t] = col[mid];
+      if (c % 2 == 0) center[t] = 0.5f * (col[mid] + *min_element(col + mid + 1, col + c));
+      if (lo < mid) nth_element(col, col + lo, col + mid);
+      lower[t] = col[lo];
+      if (hi > mid) nth_element(col + mid + 1, col + hi, col + c);
+      upper[t] = col[hi];
+    }
+  }
+}
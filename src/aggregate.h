@@ -0,0 +1,107 @@
+#pragma once
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "visualelement.h"
+#include "fftplans.h"
+#include "psd.h"
+
+/**
+   One trace for a whole selection instead of a line per element: the mean
+   with a band of one standard deviation around it, or the median with a band
+   from the 10th to the 90th percentile, taken across the elements at every
+   sample.  The same statistic of their amplitude spectral densities is the
+   aggregate spectrum.
+
+   At most every refresh_time seconds the render thread hands a worker the
+   equations of the elements, and the worker evaluates their histories back
+   to back and reduces them, so a large selection costs the render thread
+   one pointer per element.  The mean and spread are sums
+   over the rows, so the inner loops run along contiguous samples.  The
+   percentiles need every element at a sample, so a block of samples is
+   transposed at a time and partially ordered with nth_element.  The spectra
+   go through the Welch batches AGGREGATE_PSD_BATCH histories at a time.
+
+   Like the correlation matrix the result is picked up by the next update
+   after it is done, so the render thread never waits on it.
+ **/
+
+#define AGGREGATE_MAX_CHANNELS 16384
+#define AGGREGATE_PSD_BATCH 64
+#define AGGREGATE_TRANSPOSE_BLOCK 64
+
+enum aggregate_mode{
+  AGGREGATE_OFF = 0,
+  AGGREGATE_MEAN_STD = 1,
+  AGGREGATE_MEDIAN_PERCENTILES = 2
+};
+
+class AggregatePlot{
+ public:
+  AggregatePlot(int buffer_size, FftPlanCache * fft_plans, int psd_segment_length, float psd_overlap,
+		float refresh_time);
+  ~AggregatePlot();
+
+  //render thread, true if a new aggregate was picked up
+  bool update(VisElemStore * vis_elems, const std::list<int> & elems, aggregate_mode mode, double time);
+  //render thread, waits until the worker is done with the equations it was
+  //handed, so they can be changed
+  void wait_idle();
+
+  //the number of elements in the last aggregate
+  int get_num_elems(){return n_;}
+  //the center, lower and upper traces of the histories, buffer_size long
+  void get_plot(float *& center, float *& lower, float *& upper);
+  void get_plot_min_max(float & min, float & max){min = plot_min_; max = plot_max_;}
+  //the same for the spectra, get_psd_buffer_size() long
+  void get_psd(float *& center, float *& lower, float *& upper);
+  void get_psd_min_max(float & min, float & max){min = psd_min_; max = psd_max_;}
+  int get_psd_buffer_size(){return welch_.get_num_bins();}
+  void get_psd_start_and_sep(float & start, float & sep);
+
+  //the statistic of the n rows of z at each of the n_samples, the rows are
+  //stride apart, scratch is reused between calls
+  static void reduce(const float * z, int n, int n_samples, int stride, aggregate_mode mode,
+		     float * center, float * lower, float * upper, std::vector<float> & scratch);
+
+ private:
+  AggregatePlot(const AggregatePlot&); //prevent copy construction
+  AggregatePlot& operator=(const AggregatePlot&); //prevent assignment
+
+  void worker_loop();
+
+  int buffer_size_;
+  float refresh_time_;
+  double next_time_;
+
+  //center, lower and upper back to back
+  std::vector<float> plot_;
+  std::vector<float> psd_;
+  float plot_min_, plot_max_;
+  float psd_min_, psd_max_;
+  float sample_rate_;
+  int n_;
+
+  //owned by the worker while a job is queued or running
+  WelchPsd welch_;
+  aggregate_mode job_mode_;
+  int job_n_;
+  std::vector<Equation*> job_eqs_;
+  std::vector<float> job_in_;
+  std::vector<float> job_sample_rates_;
+  std::vector<float> job_asd_;
+  std::vector<float> job_plot_;
+  std::vector<float> job_psd_;
+  std::vector<float> job_scratch_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool is_queued_;
+  bool is_running_;
+  bool has_result_;
+  bool is_stopping_;
+};
@@ -26,6 +26,10 @@ CameraControl::CameraControl(int width, int height,
 }
 
 
+float CameraControl::get_pixels_per_unit(){
+  return width_ / (2 * half_span_.x);
+}
+
 glm::mat4 CameraControl::get_view_mat(){
   return  glm::ortho(center_.x-half_span_.x, center_.x+half_span_.x, 
 		     center_.y-half_span_.y,  center_.y+half_span_.y, 
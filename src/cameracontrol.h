@@ -22,6 +22,8 @@ class CameraControl{
 
   glm::mat4 get_view_mat();
   glm::mat4 get_view_mat_inverse();
+  //how many pixels one model space unit covers at the current zoom
+  float get_pixels_per_unit();
 
 
   void register_move_on(double x_pos, double y_pos);
@@ -4,6 +4,7 @@
 #include <stdio.h>
 #include <string>
 #include <vector>
+#include <unordered_set>
 
 #include "json/json.h"
 #include "genericutils.h"
@@ -34,6 +35,76 @@ dataval_desc parse_dataval_desc(Json::Value & dvjson){
   return dvdesc;
 }
 
+grid_layer_desc parse_grid_layer_desc(Json::Value & gljson){
+	if (!gljson.isMember("id")) log_fatal("id not found in grid_layer\n");
+	if (!gljson.isMember("x_origin") || !gljson["x_origin"].isNumeric()) log_fatal("x_origin not valid in grid_layer\n");
+	if (!gljson.isMember("y_origin") || !gljson["y_origin"].isNumeric()) log_fatal("y_origin not valid in grid_layer\n");
+	if (!gljson.isMember("cell_width") || !gljson["cell_width"].isNumeric()) log_fatal("cell_width not valid in grid_layer\n");
+	if (!gljson.isMember("cell_height") || !gljson["cell_height"].isNumeric()) log_fatal("cell_height not valid in grid_layer\n");
+	if (!gljson.isMember("n_x") || !gljson["n_x"].isInt()) log_fatal("n_x not valid in grid_layer\n");
+	if (!gljson.isMember("n_y") || !gljson["n_y"].isInt()) log_fatal("n_y not valid in grid_layer\n");
+	if (!gljson.isMember("layer") || !gljson["layer"].isInt()) log_fatal("layer not valid in grid_layer\n");
+	if (!gljson.isMember("cmap")) log_fatal("cmap not found in grid_layer\n");
+
+	grid_layer_desc desc;
+	desc.id = gljson["id"].asString();
+	desc.x_origin = gljson["x_origin"].asFloat();
+	desc.y_origin = gljson["y_origin"].asFloat();
+	desc.cell_width = gljson["cell_width"].asFloat();
+	desc.cell_height = gljson["cell_height"].asFloat();
+	desc.n_x = gljson["n_x"].asInt();
+	desc.n_y = gljson["n_y"].asInt();
+	desc.layer = gljson["layer"].asInt();
+	desc.cmap_id = gljson["cmap"].asString();
+	desc.cmap_min = gljson.isMember("cmap_min") ? gljson["cmap_min"].asFloat() : 0.0f;
+	desc.cmap_max = gljson.isMember("cmap_max") ? gljson["cmap_max"].asFloat() : 1.0f;
+
+	desc.aggregation = HEATMAP_AGG_MEAN;
+	if (gljson.isMember("aggregation")){
+		string agg = gljson["aggregation"].asString();
+		if (agg == "max") desc.aggregation = HEATMAP_AGG_MAX;
+		else if (agg != "mean") log_fatal("grid_layer aggregation %s is not mean or max\n", agg.c_str());
+	}
+	return desc;
+}
+
+spectral_engine_desc parse_spectral_engine_desc(Json::Value & sejson){
+	spectral_engine_desc desc;
+	desc.peak_freq = false;
+	desc.update_time = 1.0;
+	desc.n_threads = 1;
+	if (sejson.isMember("bands")){
+		for (unsigned int i=0; i < sejson["bands"].size(); i++){
+			Json::Value & b = sejson["bands"][i];
+			if (!b.isMember("name") || !b["name"].isString()) log_fatal("name not valid in spectral_engine band\n");
+			if (!b.isMember("min_freq") || !b["min_freq"].isNumeric()) log_fatal("min_freq not valid in spectral_engine band\n");
+			if (!b.isMember("max_freq") || !b["max_freq"].isNumeric()) log_fatal("max_freq not valid in spectral_engine band\n");
+			spectral_band_desc band;
+			band.name = b["name"].asString();
+			band.min_freq = b["min_freq"].asFloat();
+			band.max_freq = b["max_freq"].asFloat();
+			if (band.name == "peak_freq") log_fatal("spectral_engine band can't be called peak_freq\n");
+			if (band.max_freq < band.min_freq) log_fatal("spectral_engine band %s has max_freq below min_freq\n", band.name.c_str());
+			desc.bands.push_back(band);
+		}
+	}
+	if (sejson.isMember("peak_freq")){
+		if (!sejson["peak_freq"].isBool()) log_fatal("spectral_engine/peak_freq supplied but is not a bool\n");
+		desc.peak_freq = sejson["peak_freq"].asBool();
+	}
+	if (sejson.isMember("update_time")){
+		if (!sejson["update_time"].isNumeric() || sejson["update_time"].asFloat() <= 0)
+			log_fatal("spectral_engine/update_time supplied but is not a positive number\n");
+		desc.update_time = sejson["update_time"].asFloat();
+	}
+	if (sejson.isMember("n_threads")){
+		if (!sejson["n_threads"].isInt() || sejson["n_threads"].asInt() < 1)
+			log_fatal("spectral_engine/n_threads supplied but is not a positive integer\n");
+		desc.n_threads = sejson["n_threads"].asInt();
+	}
+	return desc;
+}
+
 datastreamer_desc parse_datastreamer_desc(Json::Value & dsjson){
   //printf("parse_datastramer_desc\n");
   datastreamer_desc dd;
@@ -52,6 +123,10 @@ void parse_config_file(string in_file,
 		       vector<string> & svg_paths,
 		       vector<string> & svg_ids,
 
+		       std::vector<grid_layer_desc> & grid_layer_descs,
+
+		       spectral_engine_desc & spectral_engine,
+
 		       std::vector<std::string> & displayed_global_equations,
 		       std::vector<std::string> & modifiable_data_vals,
 
@@ -63,8 +138,16 @@ void parse_config_file(string in_file,
 		       int & sub_sampling,
 		       int & num_layers,
 		       int & max_framerate,
+		       int & idle_framerate,
+		       bool & vsync,
+		       std::string & geometry_cache_file,
+		       std::string & control_socket,
+		       std::string & fft_wisdom_file,
 		       int & max_num_plotted,
 		       int & dv_buffer_size,
+		       int & psd_segment_length,
+		       float & psd_overlap,
+		       float & psd_averaging,
 
 		       size_t & min_max_update_interval,
 
@@ -88,8 +171,16 @@ void parse_config_file(string in_file,
   win_y_size = 480;
   sub_sampling = 2;
   max_framerate = -1;
+  idle_framerate = 1;
+  vsync = false;
+  geometry_cache_file = "lyrebird_geometry.cache";
+  control_socket = "tcp:127.0.0.1:5555";
+  fft_wisdom_file = "lyrebird_fftw.wisdom";
 
   dv_buffer_size = 128;
+  psd_segment_length = 0;
+  psd_overlap = 0.5;
+  psd_averaging = 0.25;
 
   num_layers = 10;
   max_num_plotted = 24;
@@ -132,6 +223,46 @@ void parse_config_file(string in_file,
 
 
 
+    if (v.isMember("idle_framerate")){
+      if (v["idle_framerate"].isInt()){
+	idle_framerate = v["idle_framerate"].asInt();
+      }else {
+	log_fatal("general_settings/idle_framerate supplied but is not integer");
+      }
+    }
+
+    if (v.isMember("vsync")){
+      if (v["vsync"].isBool()){
+	vsync = v["vsync"].asBool();
+      }else {
+	log_fatal("general_settings/vsync supplied but is not a bool");
+      }
+    }
+
+    if (v.isMember("geometry_cache_file")){
+      if (v["geometry_cache_file"].isString()){
+	geometry_cache_file = v["geometry_cache_file"].asString();
+      }else {
+	log_fatal("general_settings/geometry_cache_file supplied but is not a string");
+      }
+    }
+
+    if (v.isMember("control_socket")){
+      if (v["control_socket"].isString()){
+	control_socket = v["control_socket"].asString();
+      }else {
+	log_fatal("general_settings/control_socket supplied but is not a string");
+      }
+    }
+
+    if (v.isMember("fft_wisdom_file")){
+      if (v["fft_wisdom_file"].isString()){
+	fft_wisdom_file = v["fft_wisdom_file"].asString();
+      }else {
+	log_fatal("general_settings/fft_wisdom_file supplied but is not a string");
+      }
+    }
+
     if (v.isMember("dv_buffer_size")){
       if (v["dv_buffer_size"].isInt()){
 	dv_buffer_size = v["dv_buffer_size"].asInt();
@@ -140,6 +271,30 @@ void parse_config_file(string in_file,
       }
     }      
 
+    if (v.isMember("psd_segment_length")){
+      if (v["psd_segment_length"].isInt()){
+	psd_segment_length = v["psd_segment_length"].asInt();
+      }else {
+	log_fatal("general_settings/psd_segment_length supplied but is not integer");
+      }
+    }
+
+    if (v.isMember("psd_overlap")){
+      if (v["psd_overlap"].isNumeric() && v["psd_overlap"].asFloat() >= 0 && v["psd_overlap"].asFloat() < 1){
+	psd_overlap = v["psd_overlap"].asFloat();
+      }else {
+	log_fatal("general_settings/psd_overlap supplied but is not a number in [0, 1)");
+      }
+    }
+
+    if (v.isMember("psd_averaging")){
+      if (v["psd_averaging"].isNumeric() && v["psd_averaging"].asFloat() > 0 && v["psd_averaging"].asFloat() <= 1){
+	psd_averaging = v["psd_averaging"].asFloat();
+      }else {
+	log_fatal("general_settings/psd_averaging supplied but is not a number in (0, 1]");
+      }
+    }
+
     if (v.isMember("max_num_plotted")){
       if (v["max_num_plotted"].isInt()){
 	max_num_plotted = v["max_num_plotted"].asInt();
@@ -207,6 +362,21 @@ void parse_config_file(string in_file,
     }
   }
 
+  if (root.isMember("grid_layers")){
+	  log_trace("Parsing grid layers");
+	  for (unsigned int i=0; i < root["grid_layers"].size(); i++){
+		  grid_layer_descs.push_back(parse_grid_layer_desc(root["grid_layers"][i]));
+		  if (grid_layer_descs.back().layer + 1 > num_layers){
+			  num_layers = grid_layer_descs.back().layer + 1;
+		  }
+	  }
+  }
+
+  //an empty description leaves the spectral engine off
+  Json::Value spectral_v(Json::objectValue);
+  if (root.isMember("spectral_engine")) spectral_v = root["spectral_engine"];
+  spectral_engine = parse_spectral_engine_desc(spectral_v);
+
   if (root.isMember("displayed_global_equations")){
 	  log_trace("Parsing displayed global equations");
 	  for (unsigned int i=0; i < root["displayed_global_equations"].size(); i++)
@@ -253,6 +423,25 @@ void parse_config_file(string in_file,
 	  for (int i=0; i < n_vis_elems; i++){
 		  log_trace("individual");
 		  Json::Value v = visElemsJSON[i];
+		  if (v.isMember("grid_layer")){
+			  if (!v.isMember("grid_x") || !v["grid_x"].isInt()) log_fatal("grid_x  not valid in visual_element\n");
+			  if (!v.isMember("grid_y") || !v["grid_y"].isInt()) log_fatal("grid_y  not valid in visual_element\n");
+			  //grid cells take their position from the layer, the rest is only for the highlight
+			  if (!v.isMember("x_center")) v["x_center"] = 0.0;
+			  if (!v.isMember("y_center")) v["y_center"] = 0.0;
+			  if (!v.isMember("x_scale")) v["x_scale"] = 1.0;
+			  if (!v.isMember("y_scale")) v["y_scale"] = 1.0;
+			  if (!v.isMember("rotation")) v["rotation"] = 0.0;
+			  if (!v.isMember("layer")) v["layer"] = 0;
+			  if (!v.isMember("svg_id")) v["svg_id"] = "";
+			  if (!v.isMember("svg_path")) v["svg_path"] = "";
+			  vis_elems[i].grid_layer = v["grid_layer"].asString();
+			  vis_elems[i].grid_x = v["grid_x"].asInt();
+			  vis_elems[i].grid_y = v["grid_y"].asInt();
+		  } else {
+			  vis_elems[i].grid_x = -1;
+			  vis_elems[i].grid_y = -1;
+		  }
 		  if (!v.isMember("x_center")  ) log_fatal("x_center not found  in visual_element\n");
 		  if (!v.isMember("y_center") ) log_fatal("y_center not found  in visual_element\n");
 		  if (!v.isMember("x_scale")  ) log_fatal("x_scale not found  in visual_element\n");
@@ -304,8 +493,10 @@ void parse_config_file(string in_file,
 		  
 		  string svg_id = v["svg_id"].asString();
 		  string svg_path= v["svg_path"].asString();
-		  full_svg_ids.push_back(svg_id);
-		  full_svg_paths.push_back(svg_path);
+		  if (vis_elems[i].grid_layer.size() == 0){
+			  full_svg_ids.push_back(svg_id);
+			  full_svg_paths.push_back(svg_path);
+		  }
 		  
 		  svg_id = v["highlight_svg_id"].asString();
 		  svg_path= v["highlight_svg_path"].asString();
@@ -342,14 +533,9 @@ void parse_config_file(string in_file,
 	  }
 
 	  //filter the svg ids and paths to be unique so we don't spend forever loading them
+	  unordered_set<string> seen_svg_ids(svg_ids.begin(), svg_ids.end());
 	  for (unsigned int i=0; i < full_svg_ids.size(); i++){
-		  bool is_unique = true;
-		  for (unsigned int j=0; j < svg_ids.size(); j++)
-			  if (full_svg_ids[i] == svg_ids[j]){
-				  is_unique = false;
-				  break;
-			  }
-		  if (is_unique){
+		  if (seen_svg_ids.insert(full_svg_ids[i]).second){
 			  svg_ids.push_back(full_svg_ids[i]);
 			  svg_paths.push_back(full_svg_paths[i]);
 		  }
@@ -357,3 +543,23 @@ void parse_config_file(string in_file,
   }  
 
 }
+
+void parse_config_file(std::string in_file, config_desc & conf){
+  parse_config_file(in_file, conf.dataval_descs, conf.datastream_descs, conf.equation_descs,
+		    conf.vis_elems, conf.svg_paths, conf.svg_ids,
+		    conf.grid_layer_descs,
+		    conf.spectral_engine,
+		    conf.displayed_global_equations, conf.modifiable_data_vals,
+		    conf.command_lst, conf.command_label,
+		    conf.win_x_size, conf.win_y_size, conf.sub_sampling,
+		    conf.num_layers, conf.max_framerate, conf.idle_framerate, conf.vsync,
+		    conf.geometry_cache_file,
+		    conf.control_socket,
+		    conf.fft_wisdom_file,
+		    conf.max_num_plotted,
+		    conf.dv_buffer_size,
+		    conf.psd_segment_length, conf.psd_overlap, conf.psd_averaging,
+		    conf.min_max_update_interval,
+		    conf.displayed_eq_labels
+		    );
+}
@@ -5,6 +5,8 @@
 #include "datastreamer.h"
 #include "visualelement.h"
 #include "equation.h"
+#include "heatmaplayer.h"
+#include "spectralengine.h"
 
 
 void parse_config_file(std::string in_file, 
@@ -18,6 +20,10 @@ void parse_config_file(std::string in_file,
 		       std::vector<std::string> & svg_paths,
 		       std::vector<std::string> & svg_ids,
 
+		       std::vector<grid_layer_desc> & grid_layer_descs,
+
+		       spectral_engine_desc & spectral_engine,
+
 		       std::vector<std::string> & displayed_global_equations,
 		       std::vector<std::string> & modifiable_data_vals,
 
@@ -29,11 +35,63 @@ void parse_config_file(std::string in_file,
 		       int & sub_sampling,
 		       int & num_layers,
 		       int & max_framerate,
+		       int & idle_framerate,
+		       bool & vsync,
+		       std::string & geometry_cache_file,
+		       std::string & control_socket,
+		       std::string & fft_wisdom_file,
 		       int & max_num_plotted,
 		       int & dv_buffer_size,
+		       int & psd_segment_length,
+		       float & psd_overlap,
+		       float & psd_averaging,
 		       
 		       size_t & min_max_update_interval,
 		       
 		       std::vector<std::string> & displayed_eq_labels
 		        
 		       );
+
+
+//everything that comes out of a config file, either parsed from the json or
+//read back from a compiled scene file
+struct config_desc{
+  std::vector<dataval_desc> dataval_descs;
+  std::vector<datastreamer_desc> datastream_descs;
+  std::vector<equation_desc> equation_descs;
+  std::vector<vis_elem_repr> vis_elems;
+  std::vector<std::string> svg_paths;
+  std::vector<std::string> svg_ids;
+  std::vector<grid_layer_desc> grid_layer_descs;
+  spectral_engine_desc spectral_engine;
+  std::vector<std::string> displayed_global_equations;
+  std::vector<std::string> modifiable_data_vals;
+  std::vector<std::string> command_lst;
+  std::vector<std::string> command_label;
+
+  int win_x_size;
+  int win_y_size;
+  int sub_sampling;
+  int num_layers;
+  int max_framerate;
+  int idle_framerate;
+  bool vsync;
+  std::string geometry_cache_file;
+  //unix:path or tcp:host:port, empty turns the control server off
+  std::string control_socket;
+  std::string fft_wisdom_file;
+  int max_num_plotted;
+  int dv_buffer_size;
+  //0 uses a quarter of dv_buffer_size
+  int psd_segment_length;
+  float psd_overlap;
+  //weight of the newest spectrum in the running average, 1 turns it off
+  float psd_averaging;
+  size_t min_max_update_interval;
+
+  std::vector<std::string> displayed_eq_labels;
+};
+
+typedef struct config_desc config_desc;
+
+void parse_config_file(std::string in_file, config_desc & conf);
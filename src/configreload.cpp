@@ -0,0 +1,283 @@
+#include "configreload.h"
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <string.h>
+
+#include <map>
+#include <set>
+#include <stdexcept>
+
+#include "logging.h"
+#include "scenefile.h"
+
+using namespace std;
+
+
+ConfigWatcher::ConfigWatcher(std::string config_file) : watch_fd_(-1){
+  string dir = ".";
+  file_name_ = config_file;
+  size_t slash = config_file.find_last_of('/');
+  if (slash != string::npos){
+    dir = slash == 0 ? "/" : config_file.substr(0, slash);
+    file_name_ = config_file.substr(slash + 1);
+  }
+
+  inotify_fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (inotify_fd_ < 0){
+    log_warn("could not start inotify, %s will not be reloaded on change", config_file.c_str());
+    return;
+  }
+  watch_fd_ = inotify_add_watch(inotify_fd_, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO);
+  if (watch_fd_ < 0){
+    log_warn("could not watch %s, %s will not be reloaded on change", dir.c_str(), config_file.c_str());
+  }
+}
+
+ConfigWatcher::~ConfigWatcher(){
+  if (inotify_fd_ >= 0) close(inotify_fd_);
+}
+
+bool ConfigWatcher::has_changed(){
+  if (inotify_fd_ < 0 || watch_fd_ < 0) return false;
+  bool changed = false;
+  char buf[4096] __attribute__ ((aligned(__alignof__(struct inotify_event))));
+  while (true){
+    ssize_t len = read(inotify_fd_, buf, sizeof(buf));
+    if (len <= 0) break;
+    for (char * p = buf; p < buf + len; ){
+      const struct inotify_event * ev = (const struct inotify_event *) p;
+      if (ev->len > 0 && file_name_ == ev->name) changed = true;
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+  return changed;
+}
+
+
+static bool same_equation(const equation_desc & a, const equation_desc & b){
+  return a.eq == b.eq && a.cmap_id == b.cmap_id && a.label == b.label &&
+    a.display_label == b.display_label && a.sample_rate_id == b.sample_rate_id &&
+    a.display_in_info_bar == b.display_in_info_bar &&
+    a.color_is_dynamic == b.color_is_dynamic;
+}
+
+static bool same_vis_elem(const vis_elem_repr & a, const vis_elem_repr & b){
+  return a.x_center == b.x_center && a.y_center == b.y_center &&
+    a.x_scale == b.x_scale && a.y_scale == b.y_scale &&
+    a.rotation == b.rotation && a.layer == b.layer &&
+    a.geo_id == b.geo_id && a.highlight_geo_id == b.highlight_geo_id &&
+    a.labels == b.labels && a.equations == b.equations && a.group == b.group &&
+    a.labelled_data == b.labelled_data && a.labelled_data_vs == b.labelled_data_vs &&
+    a.grid_layer == b.grid_layer && a.grid_x == b.grid_x && a.grid_y == b.grid_y;
+}
+
+static bool same_data_vals(const vector<dataval_desc> & a, const vector<dataval_desc> & b){
+  if (a.size() != b.size()) return false;
+  for (size_t i=0; i < a.size(); i++){
+    if (a[i].id != b[i].id || a[i].init_val != b[i].init_val ||
+	a[i].is_buffered != b[i].is_buffered) return false;
+  }
+  return true;
+}
+
+static bool same_data_sources(const vector<datastreamer_desc> & a, const vector<datastreamer_desc> & b){
+  if (a.size() != b.size()) return false;
+  for (size_t i=0; i < a.size(); i++){
+    if (a[i].tag != b[i].tag || a[i].tp != b[i].tp ||
+	a[i].us_update_time != b[i].us_update_time ||
+	a[i].streamer_json_desc != b[i].streamer_json_desc) return false;
+  }
+  return true;
+}
+
+static bool same_grid_layers(const vector<grid_layer_desc> & a, const vector<grid_layer_desc> & b){
+  if (a.size() != b.size()) return false;
+  for (size_t i=0; i < a.size(); i++){
+    if (a[i].id != b[i].id || a[i].x_origin != b[i].x_origin || a[i].y_origin != b[i].y_origin ||
+	a[i].cell_width != b[i].cell_width || a[i].cell_height != b[i].cell_height ||
+	a[i].n_x != b[i].n_x || a[i].n_y != b[i].n_y || a[i].layer != b[i].layer ||
+	a[i].cmap_id != b[i].cmap_id || a[i].cmap_min != b[i].cmap_min ||
+	a[i].cmap_max != b[i].cmap_max || a[i].aggregation != b[i].aggregation) return false;
+  }
+  return true;
+}
+
+static bool same_spectral_engine(const spectral_engine_desc & a, const spectral_engine_desc & b){
+  if (a.bands.size() != b.bands.size()) return false;
+  for (size_t i=0; i < a.bands.size(); i++){
+    if (a.bands[i].name != b.bands[i].name || a.bands[i].min_freq != b.bands[i].min_freq ||
+	a.bands[i].max_freq != b.bands[i].max_freq) return false;
+  }
+  return a.peak_freq == b.peak_freq && a.update_time == b.update_time && a.n_threads == b.n_threads;
+}
+
+static bool same_settings(const config_desc & a, const config_desc & b){
+  return a.win_x_size == b.win_x_size && a.win_y_size == b.win_y_size &&
+    a.sub_sampling == b.sub_sampling && a.num_layers == b.num_layers &&
+    a.max_framerate == b.max_framerate && a.idle_framerate == b.idle_framerate &&
+    a.vsync == b.vsync && a.geometry_cache_file == b.geometry_cache_file &&
+    a.control_socket == b.control_socket && a.fft_wisdom_file == b.fft_wisdom_file &&
+    a.max_num_plotted == b.max_num_plotted && a.dv_buffer_size == b.dv_buffer_size &&
+    a.psd_segment_length == b.psd_segment_length && a.psd_overlap == b.psd_overlap &&
+    a.psd_averaging == b.psd_averaging &&
+    a.min_max_update_interval == b.min_max_update_interval;
+}
+
+static void warn_needs_restart(const config_desc & old_conf, const config_desc & new_conf){
+  vector<string> sections;
+  if (!same_data_vals(old_conf.dataval_descs, new_conf.dataval_descs)) sections.push_back("data_vals");
+  if (!same_data_sources(old_conf.datastream_descs, new_conf.datastream_descs)) sections.push_back("data_sources");
+  if (!same_grid_layers(old_conf.grid_layer_descs, new_conf.grid_layer_descs)) sections.push_back("grid_layers");
+  if (!same_spectral_engine(old_conf.spectral_engine, new_conf.spectral_engine)) sections.push_back("spectral_engine");
+  if (!same_settings(old_conf, new_conf)) sections.push_back("general_settings");
+  if (old_conf.displayed_global_equations != new_conf.displayed_global_equations)
+    sections.push_back("displayed_global_equations");
+  if (old_conf.modifiable_data_vals != new_conf.modifiable_data_vals) sections.push_back("modifiable_data_vals");
+  if (old_conf.command_lst != new_conf.command_lst || old_conf.command_label != new_conf.command_label)
+    sections.push_back("external_commands_list");
+  if (old_conf.displayed_eq_labels != new_conf.displayed_eq_labels) sections.push_back("eq_names");
+
+  for (size_t i=0; i < sections.size(); i++){
+    log_warn("config reload: %s changed, restart lyrebird to apply it", sections[i].c_str());
+  }
+}
+
+
+//everything that can make the new config fail is checked here, before the scene is touched
+static void check_new_config(const config_desc & new_conf, DataVals * data_vals,
+			     EquationMap & equation_map, SimpleRen & sren,
+			     const map<string, equation_desc> & old_eqs){
+  set<string> eq_labels;
+  for (size_t i=0; i < new_conf.equation_descs.size(); i++){
+    const equation_desc & desc = new_conf.equation_descs[i];
+    eq_labels.insert(desc.label);
+    auto it = old_eqs.find(desc.label);
+    if (it != old_eqs.end() && same_equation(it->second, desc)) continue;
+    //compiles and links against the running data vals, throws on errors
+    Equation scratch;
+    scratch.set_equation(data_vals, desc);
+  }
+
+  set<string> geo_ids(new_conf.svg_ids.begin(), new_conf.svg_ids.end());
+  for (size_t i=0; i < new_conf.vis_elems.size(); i++){
+    const vis_elem_repr & v = new_conf.vis_elems[i];
+    if (v.labels.size() == 0) log_fatal("Vis elem with no label");
+    for (size_t j=0; j < v.equations.size(); j++){
+      if (eq_labels.count(v.equations[j]) == 0 && !equation_map.has_equation(v.equations[j]))
+	log_fatal("could not find equation %s", v.equations[j].c_str());
+    }
+    if (v.grid_layer.size() > 0){
+      HeatmapLayer * grid = sren.get_heatmap_layer(v.grid_layer);
+      if (grid == NULL) log_fatal("Vis elem uses unknown grid layer %s", v.grid_layer.c_str());
+      if (v.grid_x < 0 || v.grid_x >= grid->get_n_x() || v.grid_y < 0 || v.grid_y >= grid->get_n_y())
+	log_fatal("grid cell %d %d is outside of layer %s", v.grid_x, v.grid_y, v.grid_layer.c_str());
+    } else if (geo_ids.count(v.geo_id) == 0){
+      log_fatal("Vis elem uses unknown svg %s", v.geo_id.c_str());
+    }
+    if (geo_ids.count(v.highlight_geo_id) == 0)
+      log_fatal("Vis elem uses unknown svg %s", v.highlight_geo_id.c_str());
+  }
+}
+
+
+bool reload_config(std::string config_file, config_desc & conf,
+		   DataVals * data_vals, EquationMap & equation_map,
+		   SimpleRen & sren, GeometryCache & geo_cache,
+		   VisElemStore & visual_elements,
+		   Highlighter & highlight, unsigned int displayed_eq,
+		   ThreadPool & pool){
+  log_notice("reloading %s", config_file.c_str());
+
+  map<string, equation_desc> old_eqs;
+  for (size_t i=0; i < conf.equation_descs.size(); i++)
+    old_eqs[conf.equation_descs[i].label] = conf.equation_descs[i];
+  map<string, string> old_svgs;
+  for (size_t i=0; i < conf.svg_ids.size(); i++) old_svgs[conf.svg_ids[i]] = conf.svg_paths[i];
+
+  config_desc new_conf;
+  vector<bool> svg_changed;
+  try {
+    load_config(config_file, new_conf);
+    check_new_config(new_conf, data_vals, equation_map, sren, old_eqs);
+
+    //all of the files are checked before any are loaded, two ids can share a path
+    for (size_t i=0; i < new_conf.svg_ids.size(); i++){
+      auto it = old_svgs.find(new_conf.svg_ids[i]);
+      bool changed = geo_cache.refresh(new_conf.svg_paths[i]);
+      svg_changed.push_back(changed || it == old_svgs.end() || it->second != new_conf.svg_paths[i]);
+    }
+    for (size_t i=0; i < new_conf.svg_ids.size(); i++){
+      if (svg_changed[i]) geo_cache.get_svg(new_conf.svg_paths[i]);
+    }
+  } catch (std::runtime_error & e){
+    log_warn("not reloading %s, keeping the running config: %s", config_file.c_str(), e.what());
+    return false;
+  }
+
+  warn_needs_restart(conf, new_conf);
+
+  //equations are changed in place so the info bars and plots keep their pointers
+  int n_eqs_changed = 0;
+  for (size_t i=0; i < new_conf.equation_descs.size(); i++){
+    const equation_desc & desc = new_conf.equation_descs[i];
+    auto it = old_eqs.find(desc.label);
+    if (it != old_eqs.end() && same_equation(it->second, desc)) continue;
+    equation_map.update_equation(desc);
+    n_eqs_changed++;
+  }
+
+  //svgs keep their geometry index so elements drawing them don't need rebuilding
+  int n_svgs_changed = 0;
+  for (size_t i=0; i < new_conf.svg_ids.size(); i++){
+    if (!svg_changed[i]) continue;
+    sren.load_svg_file(new_conf.svg_ids[i], new_conf.svg_paths[i], geo_cache);
+    highlight.add_shape_definition(new_conf.svg_ids[i], new_conf.svg_paths[i], geo_cache);
+    n_svgs_changed++;
+  }
+
+  vector<bool> elem_changed(new_conf.vis_elems.size(), true);
+  if (new_conf.vis_elems.size() == conf.vis_elems.size()){
+    for (size_t i=0; i < new_conf.vis_elems.size(); i++){
+      elem_changed[i] = !same_vis_elem(conf.vis_elems[i], new_conf.vis_elems[i]);
+    }
+  }
+  int n_elems_changed = 0;
+  for (size_t i=0; i < elem_changed.size(); i++) n_elems_changed += elem_changed[i];
+
+  if (n_elems_changed > 0 || new_conf.vis_elems.size() != visual_elements.size()){
+    highlight.clear_hls();
+    for (size_t i=0; i < visual_elements.size(); i++){
+      if (i >= elem_changed.size() || elem_changed[i]) visual_elements.remove_from_renderer(i);
+    }
+    visual_elements.truncate(new_conf.vis_elems.size());
+    for (size_t i=0; i < new_conf.vis_elems.size(); i++){
+      if (i < visual_elements.size()){
+	if (elem_changed[i]) visual_elements.replace(i, new_conf.vis_elems[i]);
+      } else {
+	visual_elements.add(new_conf.vis_elems[i]);
+      }
+    }
+    visual_elements.set_eq_ind(displayed_eq);
+    sren.precalc_ren();
+  }
+
+  if (n_elems_changed > 0 || n_svgs_changed > 0){
+    highlight.clear_shapes();
+    highlight.add_vis_elem_shapes(pool);
+    if (n_elems_changed > 0) highlight.build_label_index(pool);
+    pool.wait();
+  }
+  geo_cache.save();
+
+  conf.equation_descs = new_conf.equation_descs;
+  conf.vis_elems = new_conf.vis_elems;
+  conf.svg_ids = new_conf.svg_ids;
+  conf.svg_paths = new_conf.svg_paths;
+
+  log_notice("config reloaded, %d equations, %d svgs and %d visual elements changed",
+	     n_eqs_changed, n_svgs_changed, n_elems_changed);
+  return true;
+}
@@ -0,0 +1,53 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include "configparsing.h"
+#include "datavals.h"
+#include "equationmap.h"
+#include "geometrycache.h"
+#include "highlighter.h"
+#include "simplerender.h"
+#include "threadpool.h"
+#include "visualelement.h"
+
+/**
+   Applies an edited config to a running lyrebird.
+
+   The equations, svgs and visual elements are diffed against the running
+   config and only what changed is rebuilt.  The data vals and streamers are
+   never touched so the ring buffers keep their history.  Changes to anything
+   else (data_vals, data_sources, grid_layers, general_settings, ...) are
+   reported and need a restart.
+
+   The new config is parsed and its equations and elements checked before the
+   scene is changed, so a broken edit leaves the old scene running.
+ **/
+
+class ConfigWatcher{
+ public:
+  //watches the directory so editors that save by renaming are caught
+  ConfigWatcher(std::string config_file);
+  ~ConfigWatcher();
+
+  //non blocking, true if the file was written since the last call
+  bool has_changed();
+
+ private:
+  ConfigWatcher(const ConfigWatcher&); //prevent copy construction
+  ConfigWatcher& operator=(const ConfigWatcher&); //prevent assignment
+
+  std::string file_name_;
+  int inotify_fd_;
+  int watch_fd_;
+};
+
+
+//conf is the running config, on success the reloadable parts of it are
+//replaced.  returns false if nothing was applied.
+bool reload_config(std::string config_file, config_desc & conf,
+		   DataVals * data_vals, EquationMap & equation_map,
+		   SimpleRen & sren, GeometryCache & geo_cache,
+		   VisElemStore & visual_elements,
+		   Highlighter & highlight, unsigned int displayed_eq,
+		   ThreadPool & pool);
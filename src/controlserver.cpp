@@ -0,0 +1,529 @@
+#include "controlserver.h"
+
+#include <unistd.h>
+#include <stdexcept>
+#include <errno.h>
+#include <string.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <fcntl.h>
+
+#include "sockethelper.h"
+#include "logging.h"
+
+using namespace std;
+
+#define CONTROL_QUEUE_SIZE 4096
+#define CONTROL_MAX_FRAME (16 * 1024 * 1024)
+//a subscriber this far behind is dropped instead of buffering forever
+#define CONTROL_MAX_OUT_BUF (64 * 1024 * 1024)
+#define CONTROL_COMMANDS_PER_PROCESS 1024
+#define CONTROL_MAX_EVENTS 64
+
+//the listening socket and the two eventfds are tagged with negative ids
+#define CONTROL_LISTEN_ID -1
+#define CONTROL_WAKE_ID -2
+#define CONTROL_STOP_ID -3
+
+
+static void add_to_epoll(int epoll_fd, int fd, int id, uint32_t events){
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = (uint64_t)(int64_t) id;
+  if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0) log_fatal("epoll_ctl failed: %s", strerror(errno));
+}
+
+static void signal_eventfd(int fd){
+  uint64_t one = 1;
+  if (write(fd, &one, sizeof(one)) < 0 && errno != EAGAIN) log_warn("eventfd write failed: %s", strerror(errno));
+}
+
+static void drain_eventfd(int fd){
+  uint64_t count;
+  while (read(fd, &count, sizeof(count)) > 0);
+}
+
+
+ControlServer::ControlServer(std::string address, std::function<void()> wake_render)
+  : is_running_(false), wake_render_(wake_render),
+    listen_fd_(-1), epoll_fd_(-1), wake_fd_(-1), stop_fd_(-1),
+    to_render_(CONTROL_QUEUE_SIZE), to_control_(CONTROL_QUEUE_SIZE),
+    next_client_(0), render_needs_wake_(false){
+  if (address.size() == 0){
+    log_notice("control socket is off");
+    return;
+  }
+  if (listen_on_address(address.c_str(), listen_fd_, unix_path_)){
+    log_warn("could not open the control socket %s, running without it", address.c_str());
+    listen_fd_ = -1;
+    return;
+  }
+
+  epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+  wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  stop_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (epoll_fd_ < 0 || wake_fd_ < 0 || stop_fd_ < 0) log_fatal("could not set up the control server: %s", strerror(errno));
+  add_to_epoll(epoll_fd_, listen_fd_, CONTROL_LISTEN_ID, EPOLLIN);
+  add_to_epoll(epoll_fd_, wake_fd_, CONTROL_WAKE_ID, EPOLLIN);
+  add_to_epoll(epoll_fd_, stop_fd_, CONTROL_STOP_ID, EPOLLIN);
+
+  is_running_ = true;
+  thread_ = thread(&ControlServer::thread_loop, this);
+  log_notice("control socket listening on %s", address.c_str());
+}
+
+ControlServer::~ControlServer(){
+  if (is_running_){
+    signal_eventfd(stop_fd_);
+    thread_.join();
+  }
+  for (map<int, client_conn>::iterator it = clients_.begin(); it != clients_.end(); it++) close(it->second.fd);
+  if (listen_fd_ >= 0) close(listen_fd_);
+  if (epoll_fd_ >= 0) close(epoll_fd_);
+  if (wake_fd_ >= 0) close(wake_fd_);
+  if (stop_fd_ >= 0) close(stop_fd_);
+  if (unix_path_.size() > 0) unlink(unix_path_.c_str());
+}
+
+
+////////////////////
+// control thread //
+////////////////////
+
+void ControlServer::thread_loop(){
+  struct epoll_event events[CONTROL_MAX_EVENTS];
+  while (true){
+    //commands that didn't fit in the queue are retried shortly
+    int timeout_ms = control_pending_.empty() ? -1 : 1;
+    int n = epoll_wait(epoll_fd_, events, CONTROL_MAX_EVENTS, timeout_ms);
+    if (n < 0){
+      if (errno == EINTR) continue;
+      log_fatal("epoll_wait failed: %s", strerror(errno));
+    }
+    for (int i=0; i < n; i++){
+      int id = (int)(int64_t) events[i].data.u64;
+      if (id == CONTROL_STOP_ID) return;
+      if (id == CONTROL_LISTEN_ID){
+	accept_clients();
+      } else if (id == CONTROL_WAKE_ID){
+	drain_eventfd(wake_fd_);
+	control_msg msg;
+	while (to_control_.pop(msg)) queue_frame(msg);
+      } else {
+	if (events[i].events & EPOLLIN) read_client(id);
+	if (events[i].events & EPOLLOUT) write_client(id);
+	if (events[i].events & (EPOLLHUP | EPOLLERR)) close_client(id);
+      }
+    }
+    flush_pending();
+  }
+}
+
+void ControlServer::accept_clients(){
+  while (true){
+    int fd = accept(listen_fd_, NULL, NULL);
+    if (fd < 0){
+      if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+	log_warn("control socket accept failed: %s", strerror(errno));
+      return;
+    }
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    //client ids are never reused so a late reply can't reach the wrong client
+    int client = next_client_++;
+    client_conn & conn = clients_[client];
+    conn.fd = fd;
+    conn.events = EPOLLIN | EPOLLRDHUP;
+    conn.is_read_closed = false;
+    conn.n_waiting = 0;
+    add_to_epoll(epoll_fd_, fd, client, conn.events);
+    log_debug("control client %d connected", client);
+  }
+}
+
+void ControlServer::read_client(int client){
+  map<int, client_conn>::iterator it = clients_.find(client);
+  if (it == clients_.end()) return;
+  client_conn & conn = it->second;
+
+  char buf[65536];
+  bool is_eof = false;
+  while (true){
+    ssize_t n = recv(conn.fd, buf, sizeof(buf), 0);
+    if (n > 0){
+      conn.in_buf.append(buf, n);
+      continue;
+    }
+    if (n == 0) is_eof = true;
+    else if (errno == EINTR) continue;
+    else if (errno != EAGAIN && errno != EWOULDBLOCK){
+      close_client(client);
+      return;
+    }
+    break;
+  }
+
+  //pull out every complete frame
+  size_t pos = 0;
+  Json::Reader reader;
+  while (conn.in_buf.size() - pos >= 4){
+    const unsigned char * p = (const unsigned char *) conn.in_buf.data() + pos;
+    uint32_t len = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    if (len > CONTROL_MAX_FRAME){
+      log_warn("control client %d sent a %u byte frame, closing it", client, len);
+      close_client(client);
+      return;
+    }
+    if (conn.in_buf.size() - pos - 4 < len) break;
+
+    control_msg msg;
+    msg.client = client;
+    msg.type = CONTROL_MSG_COMMAND;
+    const char * body = conn.in_buf.data() + pos + 4;
+    pos += 4 + len;
+    if (!reader.parse(body, body + len, msg.body, false) || !msg.body.isObject() ||
+	!msg.body.isMember("cmd") || !msg.body["cmd"].isString()){
+      msg.type = CONTROL_MSG_INVALID;
+    }
+    control_pending_.push_back(control_msg());
+    swap(control_pending_.back(), msg);
+    conn.n_waiting++;
+  }
+  conn.in_buf.erase(0, pos);
+
+  //the client is done sending, it is closed once its replies are written
+  if (is_eof){
+    conn.is_read_closed = true;
+    write_client(client);
+  }
+}
+
+void ControlServer::write_client(int client){
+  map<int, client_conn>::iterator it = clients_.find(client);
+  if (it == clients_.end()) return;
+  client_conn & conn = it->second;
+
+  size_t sent = 0;
+  while (sent < conn.out_buf.size()){
+    ssize_t n = send(conn.fd, conn.out_buf.data() + sent, conn.out_buf.size() - sent, MSG_NOSIGNAL);
+    if (n > 0){
+      sent += n;
+      continue;
+    }
+    if (n < 0 && errno == EINTR) continue;
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+    close_client(client);
+    return;
+  }
+  conn.out_buf.erase(0, sent);
+
+  if (conn.is_read_closed && conn.n_waiting == 0 && conn.out_buf.size() == 0){
+    close_client(client);
+    return;
+  }
+  update_events(client, conn);
+}
+
+void ControlServer::update_events(int client, client_conn & conn){
+  //only ask for EPOLLOUT while there is something left to write, and stop
+  //reading once the client has shut its side down
+  uint32_t events = (conn.is_read_closed ? 0 : EPOLLIN | EPOLLRDHUP) | (conn.out_buf.size() > 0 ? EPOLLOUT : 0);
+  if (events == conn.events) return;
+  struct epoll_event ev;
+  memset(&ev, 0, sizeof(ev));
+  ev.events = events;
+  ev.data.u64 = (uint64_t)(int64_t) client;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+  conn.events = events;
+}
+
+void ControlServer::close_client(int client){
+  map<int, client_conn>::iterator it = clients_.find(client);
+  if (it == clients_.end()) return;
+  epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, it->second.fd, NULL);
+  close(it->second.fd);
+  clients_.erase(it);
+  log_debug("control client %d disconnected", client);
+
+  //so the render thread drops its subscriptions
+  control_msg msg;
+  msg.client = client;
+  msg.type = CONTROL_MSG_CLOSED;
+  control_pending_.push_back(control_msg());
+  swap(control_pending_.back(), msg);
+}
+
+void ControlServer::queue_frame(const control_msg & msg){
+  int client = msg.client;
+  map<int, client_conn>::iterator it = clients_.find(client);
+  if (it == clients_.end()) return;
+  client_conn & conn = it->second;
+  if (msg.type == CONTROL_MSG_REPLY) conn.n_waiting--;
+
+  string payload = writer_.write(msg.body);
+  if (conn.out_buf.size() + payload.size() > CONTROL_MAX_OUT_BUF){
+    log_warn("control client %d is not reading, closing it", client);
+    close_client(client);
+    return;
+  }
+  uint32_t len = payload.size();
+  char header[4] = {(char)(len >> 24), (char)(len >> 16), (char)(len >> 8), (char)len};
+  conn.out_buf.append(header, 4);
+  conn.out_buf.append(payload);
+  write_client(client);
+}
+
+void ControlServer::flush_pending(){
+  bool pushed = false;
+  while (!control_pending_.empty() && to_render_.push(control_pending_.front())){
+    control_pending_.pop_front();
+    pushed = true;
+  }
+  if (pushed && wake_render_) wake_render_();
+}
+
+
+///////////////////
+// render thread //
+///////////////////
+
+static bool get_add(const Json::Value & cmd){
+  return cmd["add"].isBool() && cmd["add"].asBool();
+}
+
+static bool get_point(const Json::Value & v, glm::vec2 & p){
+  if (!v.isArray() || v.size() != 2 || !v[0u].isNumeric() || !v[1u].isNumeric()) return false;
+  p = glm::vec2(v[0u].asFloat(), v[1u].asFloat());
+  return true;
+}
+
+static bool get_strings(const Json::Value & v, std::vector<std::string> & strs){
+  strs.clear();
+  if (!v.isArray()) return false;
+  for (unsigned int i=0; i < v.size(); i++){
+    if (!v[i].isString()) return false;
+    strs.push_back(v[i].asString());
+  }
+  return true;
+}
+
+static void add_elem_values(VisElemStore & elems, int elem, Json::Value & labels, Json::Value & values){
+  if (labels.isArray()) labels.append(elems.get_num_labels(elem) > 0 ? elems.get_label(elem, 0) : "");
+  if (elems.get_num_eqs(elem) > 0) values.append(elems.get_current_equation(elem).get_value());
+  else values.append(Json::Value());
+}
+
+void ControlServer::send_to_control(int client, int type, Json::Value & body){
+  control_msg msg;
+  msg.client = client;
+  msg.type = type;
+  msg.body.swap(body);
+  if (render_unsent_.empty() && to_control_.push(msg)){
+    render_needs_wake_ = true;
+    return;
+  }
+  render_unsent_.push_back(control_msg());
+  swap(render_unsent_.back(), msg);
+}
+
+void ControlServer::send_values(int client, subscription & sub, Highlighter & hl, VisElemStore & elems, double time){
+  Json::Value event(Json::objectValue);
+  event["event"] = "values";
+  event["time"] = time;
+  Json::Value labels;
+  if (hl.get_selection_epoch() != sub.values_epoch){
+    labels = Json::Value(Json::arrayValue);
+    sub.values_epoch = hl.get_selection_epoch();
+  }
+  Json::Value values(Json::arrayValue);
+  list<int> inds = hl.get_plot_inds();
+  for (list<int>::iterator it = inds.begin(); it != inds.end(); it++) add_elem_values(elems, *it, labels, values);
+  if (labels.isArray()) event["labels"].swap(labels);
+  event["values"].swap(values);
+  send_to_control(client, CONTROL_MSG_EVENT, event);
+}
+
+void ControlServer::run_command(const control_msg & msg, Highlighter & hl, VisElemStore & elems,
+				unsigned int & displayed_eq, const std::vector<std::string> & eq_labels,
+				double time, Json::Value & reply, bool & changed){
+  const Json::Value & cmd = msg.body;
+  string name = cmd["cmd"].asString();
+  vector<string> strs;
+  reply["ok"] = true;
+
+  //jsoncpp throws when a value is read as the wrong type
+  if (cmd.isMember("add") && !cmd["add"].isBool()){
+    reply["error"] = "add has to be a bool";
+  } else if (name == "select"){
+    if (!get_strings(cmd["labels"], strs)){
+      reply["error"] = "select needs a labels array of strings";
+    } else {
+      reply["selected"] = hl.select_labels(strs, get_add(cmd), true);
+      changed = true;
+    }
+  } else if (name == "glob"){
+    if (!cmd["pattern"].isString()){
+      reply["error"] = "glob needs a pattern string";
+    } else {
+      hl.run_search(cmd["pattern"].asString().c_str(), true, get_add(cmd), false);
+      reply["selected"] = (Json::UInt) hl.get_plot_inds().size();
+      changed = true;
+    }
+  } else if (name == "region"){
+    glm::vec2 min_p, max_p;
+    if (cmd.isMember("lasso")){
+      vector<glm::vec2> outline;
+      const Json::Value & lasso = cmd["lasso"];
+      for (unsigned int i=0; lasso.isArray() && i < lasso.size(); i++){
+	glm::vec2 p;
+	if (!get_point(lasso[i], p)) break;
+	outline.push_back(p);
+      }
+      if (outline.size() < 3 || outline.size() != lasso.size()){
+	reply["error"] = "lasso needs at least 3 [x, y] points";
+      } else {
+	hl.select_lasso(outline, get_add(cmd), true);
+	changed = true;
+      }
+    } else if (get_point(cmd["min"], min_p) && get_point(cmd["max"], max_p)){
+      hl.select_box(min_p, max_p, get_add(cmd), true);
+      changed = true;
+    } else {
+      reply["error"] = "region needs min and max [x, y] points or a lasso";
+    }
+    if (changed) reply["selected"] = (Json::UInt) hl.get_plot_inds().size();
+  } else if (name == "clear"){
+    hl.clear_hls();
+    changed = true;
+  } else if (name == "equation"){
+    int index = -1;
+    if (cmd["index"].isInt()){
+      index = cmd["index"].asInt();
+    } else if (cmd["label"].isString()){
+      for (size_t i=0; i < eq_labels.size(); i++){
+	if (eq_labels[i] == cmd["label"].asString()) index = i;
+      }
+    }
+    if (index < 0 || index >= (int)eq_labels.size()){
+      reply["error"] = "equation needs an index or label of a displayed equation";
+    } else {
+      displayed_eq = index;
+      changed = true;
+    }
+  } else if (name == "snapshot"){
+    Json::Value labels(Json::arrayValue);
+    Json::Value values(Json::arrayValue);
+    if (cmd.isMember("labels")){
+      if (!get_strings(cmd["labels"], strs)){
+	reply["error"] = "snapshot labels has to be an array of strings";
+      } else {
+	//the value of the first element with each label, null if there is none
+	Json::Value no_labels;
+	vector<int> matches;
+	for (size_t i=0; i < strs.size(); i++){
+	  labels.append(strs[i]);
+	  hl.find_label(strs[i], matches);
+	  if (matches.size() > 0) add_elem_values(elems, matches[0], no_labels, values);
+	  else values.append(Json::Value());
+	}
+      }
+    } else {
+      list<int> inds = hl.get_plot_inds();
+      for (list<int>::iterator it = inds.begin(); it != inds.end(); it++) add_elem_values(elems, *it, labels, values);
+    }
+    reply["time"] = time;
+    if (displayed_eq < eq_labels.size()) reply["equation"] = eq_labels[displayed_eq];
+    reply["labels"].swap(labels);
+    reply["values"].swap(values);
+  } else if (name == "subscribe"){
+    //a new subscription comes in zeroed
+    subscription & sub = subs_[msg.client];
+    if (cmd.isMember("values")){
+      if (!cmd["values"].isNumeric() || cmd["values"].asDouble() <= 0){
+	reply["error"] = "values needs a period in ms";
+      } else {
+	sub.values_period = cmd["values"].asDouble() / 1000.0;
+	sub.next_values_time = time;
+	//the first event always carries the labels
+	sub.values_epoch = hl.get_selection_epoch() - 1;
+      }
+    }
+    if (cmd.isMember("selection")){
+      if (!cmd["selection"].isBool()) reply["error"] = "selection has to be a bool";
+      else sub.selection = cmd["selection"].asBool();
+    }
+  } else if (name == "unsubscribe"){
+    subs_.erase(msg.client);
+  } else {
+    reply["error"] = "unknown cmd " + name;
+  }
+
+  if (reply.isMember("error")) reply["ok"] = false;
+}
+
+bool ControlServer::process(Highlighter & hl, VisElemStore & elems, unsigned int & displayed_eq,
+			    const std::vector<std::string> & eq_labels, double time){
+  if (!is_running_) return false;
+
+  //replies that didn't fit last time go first so they stay in order
+  while (!render_unsent_.empty() && to_control_.push(render_unsent_.front())){
+    render_unsent_.pop_front();
+    render_needs_wake_ = true;
+  }
+
+  bool changed = false;
+  control_msg msg;
+  for (int i=0; i < CONTROL_COMMANDS_PER_PROCESS && to_render_.pop(msg); i++){
+    if (msg.type == CONTROL_MSG_CLOSED){
+      subs_.erase(msg.client);
+      continue;
+    }
+    Json::Value reply(Json::objectValue);
+    if (msg.type == CONTROL_MSG_INVALID){
+      reply["ok"] = false;
+      reply["error"] = "requests are json objects with a cmd string";
+      send_to_control(msg.client, CONTROL_MSG_REPLY, reply);
+      continue;
+    }
+    if (msg.body.isMember("id")) reply["id"] = msg.body["id"];
+    //a request the checks missed costs its reply, not the process
+    try {
+      run_command(msg, hl, elems, displayed_eq, eq_labels, time, reply, changed);
+    } catch (std::runtime_error & e){
+      reply["ok"] = false;
+      reply["error"] = string("bad request: ") + e.what();
+    }
+    send_to_control(msg.client, CONTROL_MSG_REPLY, reply);
+  }
+
+  //the highlights picked here are announced to the selection subscribers
+  bool announce = false;
+  for (map<int, subscription>::iterator it = subs_.begin(); it != subs_.end(); it++) announce |= it->second.selection;
+  vector<string> labels;
+  hl.take_announced_labels(labels);
+  hl.set_announce_selection(announce);
+  for (map<int, subscription>::iterator it = subs_.begin(); it != subs_.end(); it++){
+    subscription & sub = it->second;
+    if (sub.selection && labels.size() > 0){
+      Json::Value event(Json::objectValue);
+      event["event"] = "highlighted";
+      Json::Value & ev_labels = event["labels"] = Json::Value(Json::arrayValue);
+      for (size_t i=0; i < labels.size(); i++) ev_labels.append(labels[i]);
+      send_to_control(it->first, CONTROL_MSG_EVENT, event);
+    }
+    if (sub.values_period > 0 && time >= sub.next_values_time){
+      send_values(it->first, sub, hl, elems, time);
+      //don't try to catch up after a stall
+      sub.next_values_time += sub.values_period;
+      if (sub.next_values_time < time) sub.next_values_time = time + sub.values_period;
+    }
+  }
+
+  if (render_needs_wake_){
+    signal_eventfd(wake_fd_);
+    render_needs_wake_ = false;
+  }
+  return changed;
+}
@@ -0,0 +1,190 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <atomic>
+#include <thread>
+#include <functional>
+#include <utility>
+
+#include "json/json.h"
+
+#include "highlighter.h"
+#include "visualelement.h"
+
+/**
+   The control socket that scripts use to drive lyrebird.
+
+   A thread of its own waits on the listening socket and the clients with
+   epoll, so nothing on the render thread blocks on the network.  The socket
+   is either a unix socket (unix:/path) or a tcp one (tcp:host:port).
+
+   Every message in either direction is a frame: a 4 byte big endian length
+   followed by that many bytes of a json object.  A request carries a "cmd"
+   and an optional "id" that is echoed in its reply.  Every request gets a
+   reply with "ok" set, and an "error" string when it is false.
+
+     select      "labels": [...], "add": bool
+     glob        "pattern": fnmatch pattern, "add": bool
+     region      "min": [x,y], "max": [x,y] or "lasso": [[x,y], ...], "add": bool
+     clear
+     equation    "index": n or "label": eq name
+     snapshot    "labels": [...] optional, the selection if left out
+     subscribe   "values": period in ms, "selection": bool
+     unsubscribe
+
+   Regions are in model space.  A values subscription gets a "values" event
+   with the current equation of the selected elements every period, with the
+   labels included whenever the selection changed since the last one.  A
+   selection subscription gets a "highlighted" event with the labels picked
+   with the mouse or the search box.
+
+   The parsed requests are handed to the render thread through a lock free
+   queue and run by process() between frames, the replies come back the same
+   way and are written out by the control thread.  A client that shuts down
+   its writing side still gets the replies to everything it sent before it
+   is closed.
+ **/
+
+#define CONTROL_MSG_COMMAND 0
+#define CONTROL_MSG_CLOSED 1
+#define CONTROL_MSG_REPLY 2
+//a frame that wasn't a request, its error reply goes through the render
+//thread so it stays in order with the replies around it
+#define CONTROL_MSG_INVALID 3
+//a subscription event, unlike a reply it doesn't answer a request
+#define CONTROL_MSG_EVENT 4
+
+struct control_msg{
+  int client;
+  int type;
+  Json::Value body;
+};
+
+//swaps the json instead of copying it through the queue
+inline void swap(control_msg & a, control_msg & b){
+  std::swap(a.client, b.client);
+  std::swap(a.type, b.type);
+  a.body.swap(b.body);
+}
+
+
+//one thread pushes and one other thread pops, capacity is a power of two
+template <typename T>
+class SpscQueue{
+ public:
+  explicit SpscQueue(size_t capacity) : items_(capacity), mask_(capacity - 1), head_(0), tail_(0){}
+
+  //swaps item into the queue, false if it is full
+  bool push(T & item){
+    size_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - head_.load(std::memory_order_acquire) == items_.size()) return false;
+    using std::swap;
+    swap(items_[tail & mask_], item);
+    tail_.store(tail + 1, std::memory_order_release);
+    return true;
+  }
+
+  //swaps the oldest item out, false if it is empty
+  bool pop(T & item){
+    size_t head = head_.load(std::memory_order_relaxed);
+    if (head == tail_.load(std::memory_order_acquire)) return false;
+    using std::swap;
+    swap(items_[head & mask_], item);
+    head_.store(head + 1, std::memory_order_release);
+    return true;
+  }
+
+  bool empty() const{
+    return head_.load(std::memory_order_acquire) == tail_.load(std::memory_order_acquire);
+  }
+
+ private:
+  SpscQueue(const SpscQueue&); //prevent copy construction
+  SpscQueue& operator=(const SpscQueue&); //prevent assignment
+
+  std::vector<T> items_;
+  const size_t mask_;
+  std::atomic<size_t> head_;
+  std::atomic<size_t> tail_;
+};
+
+
+class ControlServer{
+ public:
+  //an empty address leaves the server off, wake_render is called from the
+  //control thread whenever there are new commands
+  ControlServer(std::string address, std::function<void()> wake_render);
+  ~ControlServer();
+
+  bool is_running(){return is_running_;}
+
+  //render thread only, true if it changed the selection or the displayed equation
+  bool process(Highlighter & hl, VisElemStore & elems, unsigned int & displayed_eq,
+	       const std::vector<std::string> & eq_labels, double time);
+  //process() has work left, more commands came in than one call runs or
+  //the replies didn't fit in the queue
+  bool has_commands(){return !to_render_.empty() || !render_unsent_.empty();}
+
+ private:
+  ControlServer(const ControlServer&); //prevent copy construction
+  ControlServer& operator=(const ControlServer&); //prevent assignment
+
+  struct client_conn{
+    int fd;
+    std::string in_buf;
+    std::string out_buf;
+    uint32_t events; //what epoll waits for
+    bool is_read_closed;
+    int n_waiting; //requests whose replies haven't come back
+  };
+
+  struct subscription{
+    double values_period;
+    double next_values_time;
+    unsigned long values_epoch;
+    bool selection;
+  };
+
+  //control thread
+  void thread_loop();
+  void accept_clients();
+  void read_client(int client);
+  void write_client(int client);
+  void close_client(int client);
+  void update_events(int client, client_conn & conn);
+  void queue_frame(const control_msg & msg);
+  void flush_pending();
+
+  //render thread
+  void run_command(const control_msg & msg, Highlighter & hl, VisElemStore & elems,
+		   unsigned int & displayed_eq, const std::vector<std::string> & eq_labels,
+		   double time, Json::Value & reply, bool & changed);
+  void send_values(int client, subscription & sub, Highlighter & hl, VisElemStore & elems, double time);
+  void send_to_control(int client, int type, Json::Value & body);
+
+  bool is_running_;
+  std::string unix_path_;
+  std::function<void()> wake_render_;
+
+  int listen_fd_;
+  int epoll_fd_;
+  int wake_fd_; //the render thread signals replies here
+  int stop_fd_;
+  std::thread thread_;
+
+  SpscQueue<control_msg> to_render_;
+  SpscQueue<control_msg> to_control_;
+
+  //only touched by the control thread
+  std::map<int, client_conn> clients_;
+  int next_client_;
+  std::deque<control_msg> control_pending_;
+  Json::FastWriter writer_;
+
+  //only touched by the render thread
+  std::map<int, subscription> subs_;
+  std::deque<control_msg> render_unsent_;
+  bool render_needs_wake_;
+};
@@ -0,0 +1,125 @@
+#include "correlation.h"
+
+#include <math.h>
+#include <algorithm>
+
+#include "logging.h"
+
+using namespace std;
+
+
+CorrelationMatrix::CorrelationMatrix(int buffer_size, float refresh_time)
+  : buffer_size_(buffer_size), refresh_time_(refresh_time), next_time_(0), n_(0), job_n_(0),
+    is_queued_(false), is_running_(false), has_result_(false), is_stopping_(false){
+  matrix_ = vector<float>(1, 0);
+  job_in_ = vector<float>((size_t)CORRELATION_MAX_CHANNELS * buffer_size_);
+  job_out_ = vector<float>((size_t)CORRELATION_MAX_CHANNELS * CORRELATION_MAX_CHANNELS);
+  thread_ = std::thread(&CorrelationMatrix::worker_loop, this);
+}
+
+CorrelationMatrix::~CorrelationMatrix(){
+  {
+    lock_guard<mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  cv_.notify_all();
+  thread_.join();
+}
+
+bool CorrelationMatrix::update(VisElemStore * vis_elems, const std::list<int> & elems, double time){
+  lock_guard<mutex> lock(mutex_);
+  if (is_queued_ || is_running_) return false;
+
+  bool picked_up = false;
+  if (has_result_){
+    has_result_ = false;
+    n_ = job_n_;
+    matrix_.assign(job_out_.begin(), job_out_.begin() + max(1, n_ * n_));
+    picked_up = true;
+  }
+
+  if (time < next_time_ || elems.size() == 0) return picked_up;
+  next_time_ = time + refresh_time_;
+
+  job_n_ = 0;
+  for (auto it = elems.begin(); it != elems.end() && job_n_ < CORRELATION_MAX_CHANNELS; ++it, job_n_++){
+    vis_elems->get_current_equation(*it).get_bulk_value(&(job_in_[(size_t)job_n_ * buffer_size_]));
+  }
+  if (elems.size() > CORRELATION_MAX_CHANNELS){
+    log_debug("correlation matrix only uses the first %d of %zu elements", CORRELATION_MAX_CHANNELS, elems.size());
+  }
+  is_queued_ = true;
+  cv_.notify_one();
+  return picked_up;
+}
+
+void CorrelationMatrix::worker_loop(){
+  while (true){
+    {
+      unique_lock<mutex> lock(mutex_);
+      cv_.wait(lock, [this]{return is_queued_ || is_stopping_;});
+      if (is_stopping_) return;
+      is_queued_ = false;
+      is_running_ = true;
+    }
+
+    correlate(&(job_in_[0]), job_n_, buffer_size_, buffer_size_, &(job_out_[0]));
+
+    lock_guard<mutex> lock(mutex_);
+    is_running_ = false;
+    has_result_ = true;
+  }
+}
+
+void CorrelationMatrix::correlate(float * z, int n, int n_samples, int stride, float * c){
+  //unit length rows without their means, so the dot products are the correlations,
+  //a row that doesn't change is all zeros and correlates with nothing
+  for (int i=0; i < n; i++){
+    float * row = z + (size_t)i * stride;
+    double mean_val = 0;
+    for (int t=0; t < n_samples; t++) mean_val += row[t];
+    mean_val /= n_samples;
+    double norm = 0;
+    for (int t=0; t < n_samples; t++){
+      row[t] -= mean_val;
+      norm += row[t] * row[t];
+    }
+    float scale = norm > 0 && isfinite(norm) ? 1.0 / sqrt(norm) : 0.0f;
+    for (int t=0; t < n_samples; t++) row[t] *= scale;
+  }
+
+  for (int bi=0; bi < n; bi += CORRELATION_TILE){
+    int ei = min(n, bi + CORRELATION_TILE);
+    for (int bj=bi; bj < n; bj += CORRELATION_TILE){
+      int ej = min(n, bj + CORRELATION_TILE);
+      for (int i=bi; i < ei; i += 4){
+	//the diagonal tile only needs the blocks on or above the diagonal
+	int j0 = bj == bi ? i : bj;
+	for (int j=j0; j < ej; j += 4){
+	  //4x4 sums that stay in registers, the rows past the end repeat the last one
+	  const float * a[4];
+	  const float * b[4];
+	  for (int k=0; k < 4; k++){
+	    a[k] = z + (size_t)min(i + k, ei - 1) * stride;
+	    b[k] = z + (size_t)min(j + k, ej - 1) * stride;
+	  }
+	  float s[4][4] = {{0}};
+	  for (int t=0; t < n_samples; t++){
+	    float a0 = a[0][t], a1 = a[1][t], a2 = a[2][t], a3 = a[3][t];
+	    float b0 = b[0][t], b1 = b[1][t], b2 = b[2][t], b3 = b[3][t];
+	    s[0][0] += a0 * b0; s[0][1] += a0 * b1; s[0][2] += a0 * b2; s[0][3] += a0 * b3;
+	    s[1][0] += a1 * b0; s[1][1] += a1 * b1; s[1][2] += a1 * b2; s[1][3] += a1 * b3;
+	    s[2][0] += a2 * b0; s[2][1] += a2 * b1; s[2][2] += a2 * b2; s[2][3] += a2 * b3;
+	    s[3][0] += a3 * b0; s[3][1] += a3 * b1; s[3][2] += a3 * b2; s[3][3] += a3 * b3;
+	  }
+	  for (int ki=0; ki < 4 && i + ki < ei; ki++){
+	    for (int kj=0; kj < 4 && j + kj < ej; kj++){
+	      c[(size_t)(i + ki) * n + j + kj] = s[ki][kj];
+	      c[(size_t)(j + kj) * n + i + ki] = s[ki][kj];
+	    }
+	  }
+	}
+      }
+    }
+  }
+}
@@ -0,0 +1,67 @@
+#pragma once
+#include <list>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+#include "visualelement.h"
+
+/**
+   The correlation matrix of the histories of the highlighted elements.
+
+   The histories are collected on the render thread at most every
+   refresh_time seconds and handed to a worker, which takes out the means,
+   scales every row to unit length and multiplies the rows with each other.
+   The product is blocked in tiles of CORRELATION_TILE channels so both sets of
+   rows stay in cache, with a 4x4 block of sums in registers in the innermost
+   loop, and only the upper triangle is computed.
+
+   Like the spectra the result is picked up by the next update after it is
+   done, so the render thread never waits on it.
+ **/
+
+#define CORRELATION_MAX_CHANNELS 512
+#define CORRELATION_TILE 64
+
+class CorrelationMatrix{
+ public:
+  CorrelationMatrix(int buffer_size, float refresh_time);
+  ~CorrelationMatrix();
+
+  //render thread, true if a new matrix was picked up
+  bool update(VisElemStore * vis_elems, const std::list<int> & elems, double time);
+
+  //the last finished matrix, n by n row major
+  const float * get_matrix(int & n){n = n_; return &(matrix_[0]);}
+
+  //the correlation of the rows of z, n rows of n_samples with a stride of
+  //stride, into the n by n c
+  static void correlate(float * z, int n, int n_samples, int stride, float * c);
+
+ private:
+  CorrelationMatrix(const CorrelationMatrix&); //prevent copy construction
+  CorrelationMatrix& operator=(const CorrelationMatrix&); //prevent assignment
+
+  void worker_loop();
+
+  int buffer_size_;
+  float refresh_time_;
+  double next_time_;
+
+  std::vector<float> matrix_;
+  int n_;
+
+  //owned by the worker while a job is queued or running
+  std::vector<float> job_in_;
+  std::vector<float> job_out_;
+  int job_n_;
+
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  bool is_queued_;
+  bool is_running_;
+  bool has_result_;
+  bool is_stopping_;
+};
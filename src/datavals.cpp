@@ -18,12 +18,14 @@ DataVals::DataVals(int n_vals, int buffer_size){
 	buffer_size_ = buffer_size;
 	buffer_size_full_ = buffer_size_ + 1;
 	array_size_ = n_vals;
+	epoch_ = 0;
 }
 
 
 
 void DataVals::initialize(){
 	ring_indices_ = new int[array_size_];
+	n_buffered_ = new unsigned long[array_size_];
 	ring_buffers_ = std::vector< std::vector<float> >( array_size_, std::vector<float> (1, 0));;//new float[array_size_ * (buffer_size_full_)];
 	
 	is_buffered_ = new int[array_size_];
@@ -40,6 +42,7 @@ void DataVals::initialize(){
 		//vals[i] = 0;
 		ring_buffers_[ i ][0] = 0;
 		ring_indices_[i] = -1;
+		n_buffered_[i] = 0;
 		is_buffered_[i] = 0;
 		is_mean_filtered_[i] = 0;
 
@@ -65,6 +68,7 @@ void DataVals::register_data_source(int n_vals){
 DataVals::~DataVals(){
   //delete [] vals;
   delete [] ring_indices_;
+  delete [] n_buffered_;
   delete [] is_buffered_;
   delete [] is_mean_filtered_;
  
@@ -78,11 +82,13 @@ DataVals::~DataVals(){
 }
 
 int DataVals::get_ind(std::string id){
-  if (id_mapping_.find(id) == id_mapping_.end()){
+  //a plain find so equations can be tokenized from several threads
+  auto it = id_mapping_.find(id);
+  if (it == id_mapping_.end()){
     log_warn("ID %s not found\n", id.c_str());
     return -1;
   }  else
-    return id_mapping_[id];
+    return it->second;
 }
 
 
@@ -109,6 +115,7 @@ int DataVals::add_data_val(std::string id, float val, int is_buffered, float mea
 
 	n_current_++;
 	id_mapping_[id] = index;
+	ids_.push_back(id);
 	is_buffered_[index] = is_buffered;
 	is_mean_filtered_[index] = mean_decay != 0;
 	mean_decay_[index] = mean_decay;
@@ -151,8 +158,10 @@ void DataVals::update_val(int index, float val){
 		ring_buffers_[index][ ring_indices_[index] + 1] = val;
 		ring_indices_[index]++;
 		ring_indices_[index] = ring_indices_[index] % buffer_size_;
+		n_buffered_[index]++;
 		pthread_rwlock_unlock (&rwlock_);
 	} 
+	epoch_.fetch_add(1, std::memory_order_relaxed);
 }
 
 
@@ -194,9 +203,17 @@ float evaluate_tokenized_equation_or_die(PPStack<PPToken> * token_stack){
  **/
 
 
-void DataVals::apply_bulk_func(PPStack<PPToken> * token_stack, float * vals){
+void DataVals::apply_bulk_func(PPStack<PPToken> * token_stack, float * vals, unsigned long * n_samples){
   PPStack<float> eval_stack;
   pthread_rwlock_wrlock(&rwlock_ );
+  if (n_samples != NULL){
+    *n_samples = 0;
+    for (size_t i = 0; i < token_stack->size; i++){
+      int dv = token_stack->items[i].dv_index;
+      if (token_stack->items[i].val_addr == NULL || !is_buffered_[dv]) continue;
+      if (n_buffered_[dv] > *n_samples) *n_samples = n_buffered_[dv];
+    }
+  }
   for (int j = 0; j < buffer_size_; j++){
     eval_stack.size = 0;
     //does the pp calculation
@@ -223,6 +240,18 @@ void DataVals::apply_bulk_func(PPStack<PPToken> * token_stack, float * vals){
 
 void DataVals::toggle_pause(){
   is_paused_ = !is_paused_;
+  epoch_.fetch_add(1, std::memory_order_relaxed);
+}
+
+void DataVals::get_buffers(const std::vector<int> & inds, float * out){
+  pthread_rwlock_wrlock(&rwlock_ );
+  for (size_t i=0; i < inds.size(); i++){
+    const float * buf = &(ring_buffers_[inds[i]][0]);
+    int start = ring_indices_[inds[i]] < 0 ? 0 : ring_indices_[inds[i]];
+    float * o = out + i * buffer_size_;
+    for (int j = 0; j < buffer_size_; j++) o[j] = buf[(start + j) % buffer_size_ + 1];
+  }
+  pthread_rwlock_unlock(&rwlock_);
 }
 
 int DataVals::get_buffer_size(){
@@ -2,6 +2,7 @@
 #include <string>
 #include <vector>
 #include <pthread.h>
+#include <atomic>
 #include <unordered_map>
 
 
@@ -41,7 +42,13 @@ public:
 	//return a buffer of values for data val at index
 	std::vector<float> get_buffer_vals(int index);  
 	
-	void apply_bulk_func(PPStack<PPToken> * pp_stack, float * vals);  
+	//n_samples, if given, gets the most samples any buffered input of the
+	//stack has taken, read under the same lock as the history
+	void apply_bulk_func(PPStack<PPToken> * pp_stack, float * vals, unsigned long * n_samples = NULL);
+
+	//copies the ring buffers of the buffered data vals at inds into out, one
+	//after another and oldest sample first, all under one lock
+	void get_buffers(const std::vector<int> & inds, float * out);
 	
 	void toggle_pause();
 	
@@ -50,6 +57,12 @@ public:
 	
 	double get_sample_rate(int index);
 	int get_n_vals() {return array_size_;}
+	//how many data vals have been added so far, their indices are 0 to this
+	int get_num_added() {return n_current_;}
+	std::string get_id(int index) {return ids_[index];}
+
+	//bumped every time a value changes, so the renderer can tell if it has to redraw
+	unsigned long get_epoch() {return epoch_.load(std::memory_order_relaxed);}
   
  private:
 	DataVals(const DataVals&); //prevent copy construction      
@@ -63,6 +76,8 @@ public:
 	
 	int * is_buffered_;
 	int * ring_indices_;
+	//samples written to each ring buffer, only changes with the ring index
+	unsigned long * n_buffered_;
 
 	int * is_mean_filtered_;
 	float * mean_val_;
@@ -78,6 +93,9 @@ public:
 	bool is_paused_;
 	
 	int array_size_;
+
+	std::atomic<unsigned long> epoch_;
 	
 	std::unordered_map<std::string, int> id_mapping_;
+	std::vector<std::string> ids_;
 };
@@ -9,6 +9,7 @@
 #include <ctype.h>
 #include "glm/gtx/color_space.hpp"
 #include "genericutils.h"
+#include "logging.h"
 
 #include <dfmux/Housekeeping.h>
 
@@ -425,6 +426,7 @@ char** pp_str_split(char* a_str, const char a_delim)
   size_t count     = 0;
   char* tmp        = a_str;
   char* last_comma = 0;
+  char * save_ptr;
   char delim[2];
   delim[0] = a_delim;
   delim[1] = 0;
@@ -446,12 +448,12 @@ char** pp_str_split(char* a_str, const char a_delim)
   result = (char**)malloc(sizeof(char*) * count);
   if (result) {
       size_t idx  = 0;
-      char* token = strtok(a_str, delim);
+      char* token = strtok_r(a_str, delim, &save_ptr);
 
       while (token) {
 	  assert(idx < count);
 	  *(result + idx++) = strdup(token);
-	  token = strtok(0, delim);
+	  token = strtok_r(0, delim, &save_ptr);
         }
       assert(idx == count - 1); //this usually means that two spaces are in a row
       *(result + idx) = 0;
@@ -474,103 +476,116 @@ int is_numeric (const char * s)
 //////////////////////////////////////
 //list of functions
 //get number of arguments pushed / pulled
-void tokenize_equation_or_die(const char * eq, PPStack<PPToken> * out_stack, DataVals * data_vals){
-  out_stack->size = 0;
+void compile_equation_or_die(const char * eq, std::vector<eq_op> & ops){
+  ops.clear();
 
   //check for weird (ok not so fucking weird, shut up) edge cases
   //check that it is not empty
   int eqlen = strlen(eq);
   if ( eqlen == 0){
-    fprintf(stderr, "empty equation '%s'\n", eq);
-    exit(1);
+    log_fatal("empty equation '%s'", eq);
   }  
   //check if first character is space
   if ( isspace(eq[0]) ){
-    fprintf(stderr, "equation begins with whitespace '%s'\n", eq);
-    exit(1);
+    log_fatal("equation begins with whitespace '%s'", eq);
   }
 
   //check if last character is space
   if ( isspace(eq[eqlen-1]) ){
-    fprintf(stderr, "equation ends with whitespace '%s'\n", eq);
-    exit(1);
+    log_fatal("equation ends with whitespace '%s'", eq);
   }
   
   //check if there are two spaces in a row
   char twospace[] = "  ";
   if (strstr (eq, twospace) != NULL){
-    fprintf(stderr, "two spaces found in '%s'\n", eq);
-    exit(1);
+    log_fatal("two spaces found in '%s'", eq);
   }
 
   char * eq_copy;
   eq_copy = (char *) malloc((eqlen + 1) * sizeof(char));
   strncpy(eq_copy, eq, eqlen + 1 );
 
-
-  //printf("actually tokenizing, %s \n", eq);
-  
-  //tokenize equation
+  //split the equation, anything that isn't an operator or a number has to be a data val
   char ** split_eq = pp_str_split(eq_copy, ' ');
   if (split_eq){
     for (int i = 0; *(split_eq + i); i++){
-      //printf("Tokenizing:  %s\n",  *(split_eq + i));
-      //check if len 1 and func
       char * eqt = *(split_eq + i);
-      PPToken tok;
-
-      tok.val_addr = NULL;
-      tok.dv_index = 0;
+      eq_op op;
+      op.func = 0;
+      op.val = 0;
       if (strlen(eqt) == 1 && is_pp_func(eqt[0])){
-	tok.func = get_pp_func(eqt[0]);
-	tok.arg_num = get_pp_func_len(eqt[0]);
-	tok.val = 0;
+	op.kind = EQ_OP_FUNC;
+	op.func = eqt[0];
       } else if ( is_numeric( eqt )){
-	tok.arg_num = -1;
-	tok.val = atof(eqt);
-	tok.func = pp_func_push;
-      } else if ( data_vals->get_ind(  string(eqt)   ) != -1){
-	tok.arg_num = -1;
-	tok.val = -1;
-
-	if (data_vals->is_buffered( data_vals->get_ind(  string(eqt) ))) {
-		tok.func = pp_func_push_offset;
-	} else {
-		tok.func = pp_func_push;
-	}
-	tok.dv_index = data_vals->get_ind(string(eqt));
-	tok.val_addr = data_vals->get_addr( tok.dv_index );
-      }
-      else{
-	fprintf(stderr, "Token '%s' is not recognized\n", eqt);
-	exit(1);
+	op.kind = EQ_OP_NUMBER;
+	op.val = atof(eqt);
+      } else {
+	op.kind = EQ_OP_DATA_VAL;
+	op.dv_id = eqt;
       }
-      push(out_stack, tok);
+      ops.push_back(op);
       free( *(split_eq + i));
     }
     free(split_eq);
   }else{
-    fprintf(stderr, "pp_str_split failed miserably on '%s'\n", eq);
-    exit(1);
+    free(eq_copy);
+    log_fatal("pp_str_split failed miserably on '%s'", eq);
   }
+  free(eq_copy);
+  if (ops.size() > MAX_PP_STACK_SIZE){
+    log_fatal("equation is too long '%s'", eq);
+  }
+
   //check that it's a valid equation
   int check_val = 0;
-  for (int i = out_stack->size-1; i >= 0; i--){
-    check_val += out_stack->items[i].arg_num;
-    //printf("%d\n",check_val);
+  for (int i = ops.size()-1; i >= 0; i--){
+    check_val += ops[i].kind == EQ_OP_FUNC ? get_pp_func_len(ops[i].func) : -1;
     if (check_val > 0){
-      fprintf(stderr, "equation is not valid, too many operators before variables '%s'\n", eq);
-      exit(1);
+      log_fatal("equation is not valid, too many operators before variables '%s'", eq);
     }
   }
   //check that we end with only one value on the stack
   if (check_val != -1){
-    fprintf(stderr, "equation does not have a definite result '%s'\n", eq);
-    exit(1);
+    log_fatal("equation does not have a definite result '%s'", eq);
   }
-  free(eq_copy);
+}
+
+void link_equation_or_die(const char * eq, const std::vector<eq_op> & ops,
+			  PPStack<PPToken> * out_stack, DataVals * data_vals){
+  out_stack->size = 0;
+  for (size_t i = 0; i < ops.size(); i++){
+    PPToken tok;
+    tok.val_addr = NULL;
+    tok.dv_index = 0;
+    if (ops[i].kind == EQ_OP_FUNC){
+      tok.func = get_pp_func(ops[i].func);
+      tok.arg_num = get_pp_func_len(ops[i].func);
+      tok.val = 0;
+    } else if (ops[i].kind == EQ_OP_NUMBER){
+      tok.arg_num = -1;
+      tok.val = ops[i].val;
+      tok.func = pp_func_push;
+    } else if ( data_vals->get_ind( ops[i].dv_id ) != -1){
+      tok.arg_num = -1;
+      tok.val = -1;
+      tok.dv_index = data_vals->get_ind(ops[i].dv_id);
+      if (data_vals->is_buffered( tok.dv_index )) {
+	tok.func = pp_func_push_offset;
+      } else {
+	tok.func = pp_func_push;
+      }
+      tok.val_addr = data_vals->get_addr( tok.dv_index );
+    } else {
+      log_fatal("Token '%s' is not recognized in '%s'", ops[i].dv_id.c_str(), eq);
+    }
+    push(out_stack, tok);
+  }
+}
 
-  //printf("done tokenizing, %s \n", eq);
+void tokenize_equation_or_die(const char * eq, PPStack<PPToken> * out_stack, DataVals * data_vals){
+  std::vector<eq_op> ops;
+  compile_equation_or_die(eq, ops);
+  link_equation_or_die(eq, ops, out_stack, data_vals);
 }
 
 float evaluate_tokenized_equation_or_die(PPStack<PPToken> * token_stack){
@@ -604,7 +619,8 @@ void Equation::set_equation(DataVals * dvs,
 			    equation_desc desc){
   is_set=true;
   data_vals = dvs;
-  tokenize_equation_or_die(desc.eq.c_str(), &ppp_stack, data_vals);
+  if (desc.ops.size() > 0) link_equation_or_die(desc.eq.c_str(), desc.ops, &ppp_stack, data_vals);
+  else tokenize_equation_or_die(desc.eq.c_str(), &ppp_stack, data_vals);
   cmap =  get_color_map(desc.cmap_id);
   label_ = desc.label;
   display_label_ = desc.display_label;
@@ -624,14 +640,20 @@ float Equation::get_value(){
 }
 
 
-void Equation::get_bulk_value(float * v){
+void Equation::get_bulk_value(float * v, unsigned long * n_samples){
   //currently a stub  
+  if (n_samples != NULL) *n_samples = 0;
   if (is_set){
-    data_vals->apply_bulk_func(&ppp_stack, v);
+    data_vals->apply_bulk_func(&ppp_stack, v, n_samples);
   }
 }
 
 glm::vec4 Equation::get_color(size_t index){
+	return cmap(get_normalized_value(index));
+}
+
+//the value that gets fed to the color map
+float Equation::get_normalized_value(size_t index){
 	float value;
 	if (color_is_dynamic_){
 		if (index == 0) {
@@ -654,8 +676,7 @@ glm::vec4 Equation::get_color(size_t index){
 	} else {
 		value = get_value();
 	}
-	glm::vec4 col = cmap(value);
-	return col;
+	return value;
 }
 
 string Equation::get_label(){
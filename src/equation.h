@@ -9,6 +9,7 @@
 
 //color map defs
 typedef glm::vec4 (* color_map_t)(float val);
+color_map_t get_color_map(std::string n);
 
 //polish prefix parser defs
 template <class T> struct PPStack{
@@ -26,6 +27,22 @@ struct PPToken{
 };
 
 
+//an equation after it has been split and checked but before the data vals are looked up
+#define EQ_OP_FUNC 0
+#define EQ_OP_NUMBER 1
+#define EQ_OP_DATA_VAL 2
+
+struct eq_op{
+	int kind;
+	char func;
+	float val;
+	std::string dv_id;
+};
+typedef struct eq_op eq_op;
+
+void compile_equation_or_die(const char * eq, std::vector<eq_op> & ops);
+
+
 // equation class defs
 struct equation_desc{
 	std::string eq;
@@ -35,20 +52,26 @@ struct equation_desc{
 	std::string sample_rate_id;
 	bool display_in_info_bar;
 	bool color_is_dynamic;
+
+	//precompiled form of eq, when empty eq is compiled in set_equation
+	std::vector<eq_op> ops;
 };
 typedef struct equation_desc equation_desc;
 
 
-class VisElem;
+class VisElemStore;
 
 class Equation{
-	friend class VisElem;
+	friend class VisElemStore;
 public:
 	Equation();
 	void set_equation(DataVals * dvs, equation_desc desc);
 	float get_value();
-	void get_bulk_value(float * v);
+	//n_samples, if given, counts the samples taken into the history, the
+	//difference between two calls is how far the history moved
+	void get_bulk_value(float * v, unsigned long * n_samples = NULL);
 	glm::vec4 get_color(size_t index);
+	float get_normalized_value(size_t index);
 	std::string get_label();
 	std::string get_display_label();
 	float * get_value_address();
@@ -15,6 +15,40 @@ void EquationMap::add_equation(equation_desc desc){
   num_eqs_++;
 }
 
+void EquationMap::add_equations(const std::vector<equation_desc> & descs, ThreadPool & pool){
+  if (num_eqs_ + (int)descs.size() > max_num_eqs_)  log_fatal("too many eqs trying to be added");
+  int first_eq = num_eqs_;
+  for (size_t i=0; i < descs.size(); i++){
+    eq_vec_[num_eqs_] = std::shared_ptr<Equation>(new Equation);
+    ids_map_[descs[i].label] = num_eqs_;
+    num_eqs_++;
+  }
+  pool.submit_range("tokenize equations", descs.size(), 256,
+		    [this, first_eq, &descs](size_t begin, size_t end){
+		      for (size_t i=begin; i < end; i++){
+			eq_vec_[first_eq + i]->set_equation(data_vals_, descs[i]);
+		      }
+		    });
+}
+
+void EquationMap::update_equation(equation_desc desc){
+  auto it = ids_map_.find(desc.label);
+  if (it == ids_map_.end()){
+    if (num_eqs_ >= max_num_eqs_){
+      max_num_eqs_++;
+      eq_vec_.push_back(NULL);
+    }
+    add_equation(desc);
+    return;
+  }
+  //the equation object stays put since the info bars point at its value
+  eq_vec_[it->second]->set_equation(data_vals_, desc);
+}
+
+bool EquationMap::has_equation(std::string s){
+  return ids_map_.find(s) != ids_map_.end();
+}
+
 Equation & EquationMap::get_eq(int i){
   return *(eq_vec_.at(i));
 }
@@ -3,11 +3,17 @@
 #include <string>
 #include <memory>
 #include "equation.h"
+#include "threadpool.h"
 
 class EquationMap{
  public:
   EquationMap(int number_of_equations, DataVals * data_vals);
   void add_equation(equation_desc desc);
+  //the equations are tokenized on the pool, descs must outlive pool.wait()
+  void add_equations(const std::vector<equation_desc> & descs, ThreadPool & pool);
+  //changes an existing equation in place or adds it, for config reloads
+  void update_equation(equation_desc desc);
+  bool has_equation(std::string s);
   Equation & get_eq(int i);
   int get_eq_index(std::string s);
  private:
@@ -0,0 +1,45 @@
+#include "fftplans.h"
+
+#include "genericutils.h"
+#include "logging.h"
+
+using namespace std;
+
+
+FftPlanCache::FftPlanCache(std::string wisdom_file) : wisdom_file_(wisdom_file){
+  if (wisdom_file_.size() == 0 || !file_exists(wisdom_file_)) return;
+  if (fftwf_import_wisdom_from_filename(wisdom_file_.c_str())){
+    log_debug("loaded fftw wisdom from %s", wisdom_file_.c_str());
+  } else {
+    log_warn("could not read the fftw wisdom in %s, plans will be measured again", wisdom_file_.c_str());
+  }
+}
+
+FftPlanCache::~FftPlanCache(){
+  lock_guard<mutex> lock(mutex_);
+  for (auto it = plans_.begin(); it != plans_.end(); it++) fftwf_destroy_plan(it->second);
+}
+
+fftwf_plan FftPlanCache::get_r2c_plan(int n, int howmany){
+  lock_guard<mutex> lock(mutex_);
+  auto it = plans_.find(make_pair(n, howmany));
+  if (it != plans_.end()) return it->second;
+
+  //measuring writes over the arrays so the plan is made on scratch ones
+  int out_n = n / 2 + 1;
+  float * in = fftwf_alloc_real((size_t)n * howmany);
+  fftwf_complex * out = fftwf_alloc_complex((size_t)out_n * howmany);
+  fftwf_plan plan = fftwf_plan_many_dft_r2c(1, &n, howmany,
+					    in, NULL, 1, n,
+					    out, NULL, 1, out_n,
+					    FFTW_MEASURE);
+  fftwf_free(in);
+  fftwf_free(out);
+  if (plan == NULL) log_fatal("fftw could not plan %d transforms of length %d", howmany, n);
+  plans_[make_pair(n, howmany)] = plan;
+
+  if (wisdom_file_.size() > 0 && !fftwf_export_wisdom_to_filename(wisdom_file_.c_str())){
+    log_warn("could not write the fftw wisdom to %s", wisdom_file_.c_str());
+  }
+  return plan;
+}
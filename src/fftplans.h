@@ -0,0 +1,39 @@
+#pragma once
+#include <string>
+#include <map>
+#include <mutex>
+#include <utility>
+
+#include <fftw3.h>
+
+/**
+   Single precision real to complex FFTW plans shared by everything that takes
+   spectra.
+
+   A plan does howmany transforms of length n at once, the inputs packed back
+   to back n floats apart and the outputs n/2+1 complex values apart.  Plans
+   are made with FFTW_MEASURE the first time they are asked for and kept, and
+   the wisdom is written to the wisdom file after every new plan so later runs
+   plan instantly.
+
+   Making plans goes through a lock since the FFTW planner isn't thread safe.
+   The plans are run with fftwf_execute_dft_r2c, which is, on buffers from
+   fftwf_alloc_real and fftwf_alloc_complex so the alignment matches.
+ **/
+
+class FftPlanCache{
+ public:
+  //an empty wisdom file doesn't load or save wisdom
+  FftPlanCache(std::string wisdom_file);
+  ~FftPlanCache();
+
+  fftwf_plan get_r2c_plan(int n, int howmany);
+
+ private:
+  FftPlanCache(const FftPlanCache&); //prevent copy construction
+  FftPlanCache& operator=(const FftPlanCache&); //prevent assignment
+
+  std::string wisdom_file_;
+  std::mutex mutex_;
+  std::map< std::pair<int, int>, fftwf_plan > plans_;
+};
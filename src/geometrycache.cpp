@@ -0,0 +1,222 @@
+#include "geometrycache.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <unordered_set>
+
+#include "geometryutils.h"
+#include "genericutils.h"
+#include "logging.h"
+
+using namespace std;
+
+static const char GEO_CACHE_MAGIC[8] = {'L','Y','R','G','E','O','0','1'};
+
+//sanity limit so a corrupt file can't make us allocate the world
+#define GEO_CACHE_MAX_COUNT 100000000
+
+static uint64_t hash_svg(const string & text, float tol){
+  //fnv-1a over the text and the bits of the tolerance
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i=0; i < text.size(); i++){
+    h ^= (unsigned char)text[i];
+    h *= 1099511628211ULL;
+  }
+  uint32_t tol_bits;
+  memcpy(&tol_bits, &tol, sizeof(tol_bits));
+  for (int i=0; i < 4; i++){
+    h ^= (tol_bits >> (8*i)) & 0xff;
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+template <class T> static bool read_pod(FILE * f, T & v){
+  return fread(&v, sizeof(T), 1, f) == 1;
+}
+
+template <class T> static bool read_pod_vec(FILE * f, vector<T> & v){
+  uint32_t n;
+  if (!read_pod(f, n) || n > GEO_CACHE_MAX_COUNT) return false;
+  v.resize(n);
+  return n == 0 || fread(&v[0], sizeof(T), n, f) == n;
+}
+
+template <class T> static void write_pod(FILE * f, const T & v){
+  fwrite(&v, sizeof(T), 1, f);
+}
+
+template <class T> static void write_pod_vec(FILE * f, const vector<T> & v){
+  uint32_t n = v.size();
+  write_pod(f, n);
+  if (n > 0) fwrite(&v[0], sizeof(T), n, f);
+}
+
+
+GeometryCache::GeometryCache(std::string cache_path, float tol)
+  : cache_path_(cache_path), tol_(tol), is_dirty_(false), n_parsed_(0), n_cached_(0){
+  if (cache_path_.size() > 0 && file_exists(cache_path_)) load();
+}
+
+void GeometryCache::build_render_geometry(svg_geometry & geo){
+  geo.vertices.clear();
+  geo.uvs.clear();
+  geo.colors.clear();
+  for (size_t i=geo.polygon_tris.size(); i > 0; i--){
+    const vector<glm::vec2> & tris = geo.polygon_tris[i-1];
+    geo.vertices.insert(geo.vertices.end(), tris.begin(), tris.end());
+    geo.colors.insert(geo.colors.end(), tris.size(), geo.polygon_colors[i-1]);
+  }
+  con_verts_to_uvs(geo.vertices, geo.uvs);
+}
+
+void GeometryCache::tesselate(const std::string & text, svg_geometry & geo){
+  con_svg_string_to_polys(text, tol_, geo.polygons, geo.polygon_colors);
+  geo.polygon_tris = vector< vector<glm::vec2> >(geo.polygons.size());
+  for (size_t i=0; i < geo.polygons.size(); i++){
+    triangulate_polygon(geo.polygons[i], geo.polygon_tris[i]);
+  }
+  build_render_geometry(geo);
+}
+
+svg_geometry * GeometryCache::find_svg(std::string path, std::string & text, svg_geometry * & new_geo){
+  new_geo = NULL;
+  auto pit = path_keys_.find(path);
+  if (pit != path_keys_.end()) return &entries_[pit->second];
+
+  if (!file_exists(path)) log_fatal("svg file %s does not exist", path.c_str());
+  text = read_file(path);
+  uint64_t key = hash_svg(text, tol_);
+  path_keys_[path] = key;
+
+  auto eit = entries_.find(key);
+  if (eit != entries_.end()){
+    n_cached_++;
+    return &eit->second;
+  }
+
+  new_geo = &entries_[key];
+  n_parsed_++;
+  is_dirty_ = true;
+  return NULL;
+}
+
+const svg_geometry & GeometryCache::get_svg(std::string path){
+  string text;
+  svg_geometry * new_geo;
+  svg_geometry * geo = find_svg(path, text, new_geo);
+  if (geo != NULL) return *geo;
+  tesselate(text, *new_geo);
+  return *new_geo;
+}
+
+bool GeometryCache::refresh(std::string path){
+  auto pit = path_keys_.find(path);
+  if (pit == path_keys_.end()) return true;
+  if (!file_exists(path)) log_fatal("svg file %s does not exist", path.c_str());
+  if (hash_svg(read_file(path), tol_) == pit->second) return false;
+  path_keys_.erase(pit);
+  return true;
+}
+
+void GeometryCache::prefetch(const std::vector<std::string> & paths, ThreadPool & pool){
+  //all the entries are made before any work starts so the map doesn't change under the workers
+  vector<string> texts;
+  vector<svg_geometry*> to_tesselate;
+  for (size_t i=0; i < paths.size(); i++){
+    string text;
+    svg_geometry * new_geo;
+    if (find_svg(paths[i], text, new_geo) != NULL) continue;
+    texts.push_back(text);
+    to_tesselate.push_back(new_geo);
+  }
+  for (size_t i=0; i < to_tesselate.size(); i++){
+    string text = texts[i];
+    svg_geometry * geo = to_tesselate[i];
+    pool.submit("tesselate svgs", [this, text, geo](){ tesselate(text, *geo); });
+  }
+}
+
+void GeometryCache::load(){
+  FILE * f = fopen(cache_path_.c_str(), "rb");
+  if (f == NULL) return;
+
+  bool ok = true;
+  char magic[8];
+  uint32_t n_entries = 0;
+  float tol = 0;
+  ok = ok && fread(magic, 1, 8, f) == 8 && !memcmp(magic, GEO_CACHE_MAGIC, 8);
+  ok = ok && read_pod(f, tol) && tol == tol_;
+  ok = ok && read_pod(f, n_entries) && n_entries < GEO_CACHE_MAX_COUNT;
+
+  std::unordered_map<uint64_t, svg_geometry> loaded;
+  for (uint32_t i=0; ok && i < n_entries; i++){
+    uint64_t key;
+    uint32_t n_polys;
+    ok = read_pod(f, key) && read_pod(f, n_polys) && n_polys < GEO_CACHE_MAX_COUNT;
+    if (!ok) break;
+    svg_geometry & geo = loaded[key];
+    geo.polygons.resize(n_polys);
+    geo.polygon_tris.resize(n_polys);
+    geo.polygon_colors.resize(n_polys);
+    for (uint32_t j=0; ok && j < n_polys; j++){
+      ok = read_pod(f, geo.polygon_colors[j]) &&
+	read_pod_vec(f, geo.polygons[j]) &&
+	read_pod_vec(f, geo.polygon_tris[j]);
+    }
+    if (ok) build_render_geometry(geo);
+  }
+  fclose(f);
+
+  if (!ok){
+    log_warn("geometry cache %s is unreadable, ignoring it", cache_path_.c_str());
+    return;
+  }
+  entries_.swap(loaded);
+}
+
+void GeometryCache::save(){
+  if (cache_path_.size() == 0) return;
+
+  //path_keys_ holds the current version of every svg asked for in this run
+  unordered_set<uint64_t> used_keys;
+  for (auto it = path_keys_.begin(); it != path_keys_.end(); it++) used_keys.insert(it->second);
+  bool has_unused = false;
+  for (auto it = entries_.begin(); it != entries_.end() && !has_unused; it++){
+    has_unused = !used_keys.count(it->first);
+  }
+  if (!is_dirty_ && !has_unused) return;
+
+  //write next to the real file and move it over so a crash can't leave half a cache
+  string tmp_path = cache_path_ + ".tmp";
+  FILE * f = fopen(tmp_path.c_str(), "wb");
+  if (f == NULL){
+    log_warn("could not write geometry cache %s", tmp_path.c_str());
+    return;
+  }
+  fwrite(GEO_CACHE_MAGIC, 1, 8, f);
+  write_pod(f, tol_);
+  uint32_t n_entries = used_keys.size();
+  write_pod(f, n_entries);
+  for (auto it = entries_.begin(); it != entries_.end(); it++){
+    if (!used_keys.count(it->first)) continue;
+    const svg_geometry & geo = it->second;
+    write_pod(f, it->first);
+    uint32_t n_polys = geo.polygons.size();
+    write_pod(f, n_polys);
+    for (uint32_t j=0; j < n_polys; j++){
+      write_pod(f, geo.polygon_colors[j]);
+      write_pod_vec(f, geo.polygons[j]);
+      write_pod_vec(f, geo.polygon_tris[j]);
+    }
+  }
+  bool write_failed = ferror(f);
+  fclose(f);
+  if (write_failed || rename(tmp_path.c_str(), cache_path_.c_str())){
+    log_warn("could not write geometry cache %s", cache_path_.c_str());
+    remove(tmp_path.c_str());
+    return;
+  }
+  is_dirty_ = false;
+}
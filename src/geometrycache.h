@@ -0,0 +1,78 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "glm/glm.hpp"
+#include "threadpool.h"
+
+/**
+   Parses and triangulates every svg once and hands the result to both the
+   renderer and the click geometry.
+
+   The results are kept in a binary cache file keyed by a hash of the svg text
+   and the tesselation tolerance, so starting again with the same geometry
+   doesn't touch nanosvg or the ear clipper at all.  Only the entries of the
+   svgs used in this run are written back, so variants that are no longer
+   used drop out of the file the next time it is saved.
+ **/
+
+#define SVG_TESSELATION_TOL 0.1f
+
+struct svg_geometry{
+  //the flattened outlines in document order with their fill colors
+  std::vector< std::vector<glm::vec2> > polygons;
+  std::vector< glm::vec4 > polygon_colors;
+
+  //the triangulation of each polygon, three points per triangle
+  std::vector< std::vector<glm::vec2> > polygon_tris;
+
+  //render triangles, polygons are drawn back to front
+  std::vector< glm::vec2 > vertices;
+  std::vector< glm::vec2 > uvs;
+  std::vector< glm::vec4 > colors;
+};
+
+typedef struct svg_geometry svg_geometry;
+
+class GeometryCache{
+ public:
+  //an empty cache_path keeps the cache in memory only
+  GeometryCache(std::string cache_path, float tol);
+
+  const svg_geometry & get_svg(std::string path);
+
+  //tesselates every svg that isn't cached yet on the pool, get_svg must not
+  //be called until the pool has been waited on
+  void prefetch(const std::vector<std::string> & paths, ThreadPool & pool);
+
+  //rereads the svg, returns true if it changed since get_svg last saw it
+  bool refresh(std::string path);
+
+  //writes the cache file if anything new was tesselated or some loaded
+  //entries weren't used, only the used entries are kept
+  void save();
+
+  int get_num_parsed(){return n_parsed_;}
+  int get_num_cached(){return n_cached_;}
+
+ private:
+  GeometryCache(const GeometryCache&); //prevent copy construction
+  GeometryCache& operator=(const GeometryCache&); //prevent assignment
+
+  void load();
+  void tesselate(const std::string & text, svg_geometry & geo);
+  void build_render_geometry(svg_geometry & geo);
+  //returns NULL if the svg has to be tesselated, the new entry is in new_geo
+  svg_geometry * find_svg(std::string path, std::string & text, svg_geometry * & new_geo);
+
+  std::string cache_path_;
+  float tol_;
+  bool is_dirty_;
+  int n_parsed_;
+  int n_cached_;
+
+  std::unordered_map<uint64_t, svg_geometry> entries_;
+  std::unordered_map<std::string, uint64_t> path_keys_;
+};
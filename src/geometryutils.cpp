@@ -8,6 +8,9 @@
 #include <vector>
 #include <iostream>
 #include <algorithm>
+#include <unordered_map>
+#include <math.h>
+#include <stdint.h>
 
 //#include <glm/glm.hpp>
 
@@ -75,6 +78,19 @@ bool inside_triangle(float Ax, float Ay,
   return ((aCROSSbp >= 0.0f) && (bCROSScp >= 0.0f) && (cCROSSap >= 0.0f));
 };
 
+bool inside_contour(const std::vector < glm::vec2 > &contour, glm::vec2 p){
+  bool inside = false;
+  size_t n = contour.size();
+  for (size_t i=0, j=n-1; i < n; j=i++){
+    const glm::vec2 & a = contour[i];
+    const glm::vec2 & b = contour[j];
+    if ((a.y > p.y) != (b.y > p.y) &&
+	p.x < (b.x - a.x) * (p.y - a.y) / (b.y - a.y) + a.x)
+      inside = !inside;
+  }
+  return inside;
+}
+
 bool _snip(const std::vector < glm::vec2 > &contour,int u,int v,int w,int n,int *V)
 {
   int p;
@@ -180,21 +196,7 @@ void con_poly_to_tris(std::vector<std::vector<glm::vec2> > & polygons,
     out_vertices.insert(out_vertices.end(), triang_poly.begin(), triang_poly.end());
     out_color.insert(out_color.end(), triang_color.begin(), triang_color.end());
   }
-  
-  float min_value = 0;
-  float max_value = 0;
-  for (size_t j=0; j < out_vertices.size(); j++){
-    out_uvs.push_back(glm::vec2(out_vertices[j].x, out_vertices[j].y));
-    if (out_vertices[j].x < min_value) min_value = out_vertices[j].x;
-    if (out_vertices[j].y < min_value) min_value = out_vertices[j].y;
-    if (out_vertices[j].x > max_value) max_value = out_vertices[j].x;
-    if (out_vertices[j].y > max_value) max_value = out_vertices[j].y;
-  }
-  float delta = max_value - min_value;
-  for (size_t j=0; j < out_uvs.size(); j++){
-    out_uvs[j].x = (out_uvs[j].x  - min_value)/ delta;
-    out_uvs[j].y = (out_uvs[j].y  - min_value)/ delta;;
-  }
+  con_verts_to_uvs(out_vertices, out_uvs);
 }
 
 float dist_pt_seg(float x, float y, float px, float py, float qx, float qy)
@@ -260,27 +262,17 @@ glm::vec4 con_nanosvg_color_to_glm_vec4(unsigned int color){
 
 
 
-void con_svg_to_polys(string fn, float tol,
-		      std::vector<std::vector<glm::vec2> > & polygons,
-		      std::vector< glm::vec4 > & polygon_colors
-		      ){
-  NSVGimage* g_image = NULL;
+static void con_nsvg_image_to_polys(NSVGimage * g_image, float tol,
+				    std::vector<std::vector<glm::vec2> > & polygons,
+				    std::vector< glm::vec4 > & polygon_colors
+				    ){
   NSVGshape* shape;
   NSVGpath* path;
-  
-
-  l3_assert(file_exists(fn));
-  g_image = nsvgParseFromFile(fn.c_str(), "px", 96.0f);
-  
   for (shape = g_image->shapes; shape != NULL; shape = shape->next) {
-    //DCOUT("parsing verts\n", DEBUG_0);
     for (path = shape->paths; path != NULL; path = path->next) {
       vector<glm::vec2> poly_verts;
       if (shape->fill.type == NSVG_PAINT_COLOR){
-	//cout<<"is paint colo"<<endl;
 	polygon_colors.push_back(con_nanosvg_color_to_glm_vec4(shape->fill.color));
-	//polygon_colors.push_back(glm::vec4(1.0,1.0,1.0,0.5));
-
       }
       else if (shape->fill.type == NSVG_PAINT_NONE){
 	continue;
@@ -296,12 +288,52 @@ void con_svg_to_polys(string fn, float tol,
       polygons.push_back(poly_verts);
     }
   }
-  
+}
+
 
+void con_svg_to_polys(string fn, float tol,
+		      std::vector<std::vector<glm::vec2> > & polygons,
+		      std::vector< glm::vec4 > & polygon_colors
+		      ){
+  l3_assert(file_exists(fn));
+  NSVGimage* g_image = nsvgParseFromFile(fn.c_str(), "px", 96.0f);
+  if (g_image == NULL) log_fatal("could not parse svg %s", fn.c_str());
+  con_nsvg_image_to_polys(g_image, tol, polygons, polygon_colors);
+  nsvgDelete(g_image);
 }
 
 
+void con_svg_string_to_polys(std::string svg_text, float tol,
+			     std::vector<std::vector<glm::vec2> > & polygons,
+			     std::vector< glm::vec4 > & polygon_colors
+			     ){
+  //nsvgParse chews on its input so it gets a copy
+  std::vector<char> buf(svg_text.begin(), svg_text.end());
+  buf.push_back('\0');
+  NSVGimage* g_image = nsvgParse(&buf[0], "px", 96.0f);
+  if (g_image == NULL) log_fatal("could not parse svg text");
+  con_nsvg_image_to_polys(g_image, tol, polygons, polygon_colors);
+  nsvgDelete(g_image);
+}
+
 
+void con_verts_to_uvs(const std::vector < glm::vec2 > & vertices,
+		      std::vector < glm::vec2 > & out_uvs){
+  float min_value = 0;
+  float max_value = 0;
+  for (size_t j=0; j < vertices.size(); j++){
+    out_uvs.push_back(glm::vec2(vertices[j].x, vertices[j].y));
+    if (vertices[j].x < min_value) min_value = vertices[j].x;
+    if (vertices[j].y < min_value) min_value = vertices[j].y;
+    if (vertices[j].x > max_value) max_value = vertices[j].x;
+    if (vertices[j].y > max_value) max_value = vertices[j].y;
+  }
+  float delta = max_value - min_value;
+  for (size_t j=0; j < out_uvs.size(); j++){
+    out_uvs[j].x = (out_uvs[j].x  - min_value)/ delta;
+    out_uvs[j].y = (out_uvs[j].y  - min_value)/ delta;;
+  }
+}
 
 
 //verts to include
@@ -312,37 +344,10 @@ void con_svg_to_geo(string fn, float tol,
 		    std::vector < glm::vec2 > & out_uvs,
 		    std::vector < glm::vec4 > & out_color
 		    ){
-  NSVGimage* g_image = NULL;
-  NSVGshape* shape;
-  NSVGpath* path;
-  l3_assert(file_exists(fn));
-  g_image = nsvgParseFromFile(fn.c_str(), "px", 96.0f);
-  
   //converts the svg files to a vec of vertices and colors
   std::vector<std::vector<glm::vec2> > polygons;
   std::vector<glm::vec4 > polygon_colors;
-  for (shape = g_image->shapes; shape != NULL; shape = shape->next) {
-    for (path = shape->paths; path != NULL; path = path->next) {
-      vector<glm::vec2> poly_verts;
-      if (shape->fill.type == NSVG_PAINT_COLOR){
-	polygon_colors.push_back(con_nanosvg_color_to_glm_vec4(shape->fill.color));
-      }
-      else if (shape->fill.type == NSVG_PAINT_NONE){
-	continue;
-      }
-      else {
-	polygon_colors.push_back(glm::vec4(1.0,1.0,1.0,0.5));
-      }
-
-      for (int i = 0; i < path->npts-1; i+=3){
-	float* p = &(path->pts[i*2]);
-	cubic_bez(p[0],p[1], p[2],p[3], p[4],p[5], p[6],p[7], tol, 0, &poly_verts);
-      }
-
-      polygons.push_back(poly_verts);
-
-    }
-  }
+  con_svg_to_polys(fn, tol, polygons, polygon_colors);
 
   std::reverse(polygons.begin(), polygons.end());
   std::reverse(polygon_colors.begin(), polygon_colors.end());
@@ -355,3 +360,68 @@ void con_svg_to_geo(string fn, float tol,
 
 
 
+static inline uint64_t weld_cell_key(int64_t x, int64_t y){
+  return (((uint64_t)x) << 32) ^ ((uint64_t)y & 0xffffffffULL);
+}
+
+static inline bool weld_close(float a, float b, float tol){
+  return fabsf(a - b) <= tol;
+}
+
+void weld_vertices(const std::vector < glm::vec2 > & in_vertices,
+		   const std::vector < glm::vec2 > & in_uvs,
+		   const std::vector < glm::vec4 > & in_colors,
+		   float tol,
+		   std::vector < glm::vec2 > & out_vertices,
+		   std::vector < glm::vec2 > & out_uvs,
+		   std::vector < glm::vec4 > & out_colors,
+		   std::vector < unsigned int > & out_indices){
+  l3_assert(tol > 0);
+  out_vertices.clear();
+  out_uvs.clear();
+  out_colors.clear();
+  out_indices.clear();
+  out_indices.reserve(in_vertices.size());
+
+  //the positions are hashed into cells of size tol, a match can only be in the
+  //cell of the vertex or one of its neighbours
+  std::unordered_map<uint64_t, std::vector<unsigned int> > cells;
+  cells.reserve(in_vertices.size());
+  const float inv_tol = 1.0f / tol;
+
+  for (size_t i=0; i < in_vertices.size(); i++){
+    const glm::vec2 & v = in_vertices[i];
+    const glm::vec2 & uv = in_uvs[i];
+    const glm::vec4 & col = in_colors[i];
+    int64_t cx = (int64_t)floorf(v.x * inv_tol);
+    int64_t cy = (int64_t)floorf(v.y * inv_tol);
+
+    int found = -1;
+    for (int dx = -1; dx <= 1 && found < 0; dx++){
+      for (int dy = -1; dy <= 1 && found < 0; dy++){
+	auto it = cells.find(weld_cell_key(cx + dx, cy + dy));
+	if (it == cells.end()) continue;
+	const std::vector<unsigned int> & cands = it->second;
+	for (size_t j=0; j < cands.size(); j++){
+	  unsigned int c = cands[j];
+	  if (weld_close(v.x, out_vertices[c].x, tol) && weld_close(v.y, out_vertices[c].y, tol) &&
+	      weld_close(uv.x, out_uvs[c].x, tol) && weld_close(uv.y, out_uvs[c].y, tol) &&
+	      weld_close(col.r, out_colors[c].r, tol) && weld_close(col.g, out_colors[c].g, tol) &&
+	      weld_close(col.b, out_colors[c].b, tol) && weld_close(col.a, out_colors[c].a, tol)){
+	    found = c;
+	    break;
+	  }
+	}
+      }
+    }
+
+    if (found < 0){
+      found = out_vertices.size();
+      out_vertices.push_back(v);
+      out_uvs.push_back(uv);
+      out_colors.push_back(col);
+      cells[weld_cell_key(cx, cy)].push_back(found);
+    }
+    out_indices.push_back(found);
+  }
+}
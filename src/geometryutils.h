@@ -20,6 +20,9 @@ bool inside_triangle(float Ax, float Ay,
                     float Cx, float Cy,
                     float Px, float Py);
 
+// even-odd test of p against a closed contour, works for self intersecting ones
+bool inside_contour(const std::vector < glm::vec2 > &contour, glm::vec2 p);
+
 
 void con_poly_to_tris(std::vector<std::vector<glm::vec2> > & polygons, 
 		      std::vector< glm::vec4 > & polygon_colors,
@@ -47,5 +50,26 @@ void con_svg_to_polys(std::string fn, float tol,
 		      std::vector< glm::vec4 > & polygon_colors
 		      );
 
+void con_svg_string_to_polys(std::string svg_text, float tol,
+			     std::vector<std::vector<glm::vec2> > & polygons,
+			     std::vector< glm::vec4 > & polygon_colors
+			     );
+
+// uvs are the vertex positions scaled into the unit square
+void con_verts_to_uvs(const std::vector < glm::vec2 > & vertices,
+		      std::vector < glm::vec2 > & out_uvs);
+
 
 glm::vec2 transform_vec2(glm::vec2 in, glm::mat4 trans);
+
+
+// merges vertices that are within tol of each other in position, uv and color.
+// the out vectors hold the unique vertices and out_indices the triangle indices into them
+void weld_vertices(const std::vector < glm::vec2 > & in_vertices,
+		   const std::vector < glm::vec2 > & in_uvs,
+		   const std::vector < glm::vec4 > & in_colors,
+		   float tol,
+		   std::vector < glm::vec2 > & out_vertices,
+		   std::vector < glm::vec2 > & out_uvs,
+		   std::vector < glm::vec4 > & out_colors,
+		   std::vector < unsigned int > & out_indices);
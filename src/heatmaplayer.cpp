@@ -0,0 +1,277 @@
+#include "heatmaplayer.h"
+
+#include <math.h>
+#include <string>
+
+#include "shader.h"
+#include "equation.h"
+#include "genericutils.h"
+#include "logging.h"
+
+#define HEATMAP_LUT_SIZE 256
+
+using namespace std;
+
+HeatmapLayer::HeatmapLayer(grid_layer_desc desc){
+  if (desc.n_x <= 0 || desc.n_y <= 0) log_fatal("grid layer %s needs a positive size", desc.id.c_str());
+  if (desc.cmap_max == desc.cmap_min) log_fatal("grid layer %s has an empty color map range", desc.id.c_str());
+
+  id_ = desc.id;
+  origin_ = glm::vec2(desc.x_origin, desc.y_origin);
+  cell_size_ = glm::vec2(desc.cell_width, desc.cell_height);
+  n_x_ = desc.n_x;
+  n_y_ = desc.n_y;
+  layer_ = desc.layer;
+  aggregation_ = desc.aggregation;
+  cmap_min_ = desc.cmap_min;
+  cmap_max_ = desc.cmap_max;
+
+  values_ = vector<float>(n_x_ * n_y_, 0.0f);
+  is_drawn_ = vector<unsigned char>(n_x_ * n_y_, 0);
+
+  //the mip chain follows the gl convention of floor(size/2) per level
+  int w = n_x_;
+  int h = n_y_;
+  while (true){
+    level_w_.push_back(w);
+    level_h_.push_back(h);
+    levels_.push_back(vector<float>(w * h, NAN));
+    if (w == 1 && h == 1) break;
+    w = w/2 > 1 ? w/2 : 1;
+    h = h/2 > 1 ? h/2 : 1;
+  }
+  is_dirty_ = true;
+
+  string fragment_shader = R"(
+#version 330 core
+in vec2 cellUV;
+out vec4 color;
+uniform sampler2D values;
+uniform sampler2D cmapLUT;
+uniform float cmapMin;
+uniform float cmapMax;
+void main(){
+  float v = texture(values, cellUV).r;
+  if (isnan(v)) discard;
+  float t = clamp((v - cmapMin) / (cmapMax - cmapMin), 0.0, 1.0);
+  color = texture(cmapLUT, vec2(t, 0.5));
+}
+)";
+
+  string vertex_shader = R"(
+#version 330 core
+layout(location = 0) in vec2 quadPosition;
+out vec2 cellUV;
+uniform mat4 MP;
+uniform vec2 gridOrigin;
+uniform vec2 gridSize;
+uniform float gridDepth;
+void main(){
+  cellUV = quadPosition;
+  gl_Position = MP * vec4(gridOrigin + quadPosition * gridSize, gridDepth, 1);
+}
+)";
+
+  prog_id_ = LoadShadersDef(vertex_shader, fragment_shader);
+  vert_pos_id_ = glGetAttribLocation(prog_id_, "quadPosition");
+  view_mat_id_ = glGetUniformLocation(prog_id_, "MP");
+  origin_id_ = glGetUniformLocation(prog_id_, "gridOrigin");
+  size_id_ = glGetUniformLocation(prog_id_, "gridSize");
+  depth_id_ = glGetUniformLocation(prog_id_, "gridDepth");
+  values_tex_id_ = glGetUniformLocation(prog_id_, "values");
+  lut_tex_id_ = glGetUniformLocation(prog_id_, "cmapLUT");
+  cmap_min_id_ = glGetUniformLocation(prog_id_, "cmapMin");
+  cmap_max_id_ = glGetUniformLocation(prog_id_, "cmapMax");
+
+  float quad_verts[] = {0,0, 1,0, 0,1,
+			1,0, 0,1, 1,1};
+  glGenBuffers(1, &quad_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER, quad_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, 12 * sizeof(float), quad_verts, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+  //the layer's own color map until an equation is displayed on it
+  cmap_ = get_color_map(desc.cmap_id);
+  glGenTextures(1, &lut_texture_);
+  build_lut();
+
+  glGenTextures(1, &value_texture_);
+  glBindTexture(GL_TEXTURE_2D, value_texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t i=0; i < levels_.size(); i++){
+    glTexImage2D(GL_TEXTURE_2D, i, GL_R32F, level_w_[i], level_h_[i], 0, GL_RED, GL_FLOAT, &(levels_[i][0]));
+  }
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, levels_.size() - 1);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST_MIPMAP_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+HeatmapLayer::~HeatmapLayer(){
+}
+
+void HeatmapLayer::clean_out_buffers(){
+  glDeleteBuffers(1, &quad_buffer_);
+  glDeleteTextures(1, &value_texture_);
+  glDeleteTextures(1, &lut_texture_);
+  glDeleteProgram(prog_id_);
+}
+
+//bakes the color map into a lookup texture over [cmap_min, cmap_max]
+void HeatmapLayer::build_lut(){
+  vector<GLfloat> lut(4 * HEATMAP_LUT_SIZE);
+  for (int i=0; i < HEATMAP_LUT_SIZE; i++){
+    float v = cmap_min_ + (cmap_max_ - cmap_min_) * ((float)i) / (HEATMAP_LUT_SIZE - 1);
+    glm::vec4 col = cmap_(v);
+    for (int j=0; j < 4; j++) lut[4*i + j] = col[j];
+  }
+  glBindTexture(GL_TEXTURE_2D, lut_texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, HEATMAP_LUT_SIZE, 1, 0, GL_RGBA, GL_FLOAT, &lut[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void HeatmapLayer::set_cmap(color_map_t cmap){
+  if (cmap == cmap_ || cmap == NULL) return;
+  cmap_ = cmap;
+  build_lut();
+}
+
+void HeatmapLayer::set_value(int x, int y, float val){
+  if (x < 0 || x >= n_x_ || y < 0 || y >= n_y_) log_fatal("cell %d %d outside of grid layer %s", x, y, id_.c_str());
+  float & cv = values_[y * n_x_ + x];
+  if (cv == val) return;
+  cv = val;
+  is_dirty_ = true;
+}
+
+void HeatmapLayer::set_cell_drawn(int x, int y, bool drawn){
+  if (x < 0 || x >= n_x_ || y < 0 || y >= n_y_) log_fatal("cell %d %d outside of grid layer %s", x, y, id_.c_str());
+  is_drawn_[y * n_x_ + x] = drawn;
+  is_dirty_ = true;
+}
+
+bool HeatmapLayer::is_cell_drawn(int x, int y){
+  return is_drawn_[y * n_x_ + x];
+}
+
+bool HeatmapLayer::get_cell(glm::vec2 p, int & x, int & y){
+  glm::vec2 c = (p - origin_) / cell_size_;
+  if (c.x < 0 || c.y < 0) return false;
+  x = (int)c.x;
+  y = (int)c.y;
+  return x < n_x_ && y < n_y_;
+}
+
+glm::vec2 HeatmapLayer::get_cell_center(int x, int y){
+  return origin_ + (glm::vec2(x, y) + glm::vec2(0.5f, 0.5f)) * cell_size_;
+}
+
+bool HeatmapLayer::get_cell_range(glm::vec2 min_p, glm::vec2 max_p, int & x0, int & y0, int & x1, int & y1){
+  glm::vec2 lo = glm::ceil((min_p - origin_) / cell_size_ - glm::vec2(0.5f, 0.5f));
+  glm::vec2 hi = glm::floor((max_p - origin_) / cell_size_ - glm::vec2(0.5f, 0.5f));
+  x0 = lo.x < 0 ? 0 : (int)lo.x;
+  y0 = lo.y < 0 ? 0 : (int)lo.y;
+  x1 = hi.x > n_x_ - 1 ? n_x_ - 1 : (int)hi.x;
+  y1 = hi.y > n_y_ - 1 ? n_y_ - 1 : (int)hi.y;
+  return x0 <= x1 && y0 <= y1;
+}
+
+void HeatmapLayer::get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb){
+  min_aabb = origin_;
+  max_aabb = origin_ + glm::vec2(n_x_, n_y_) * cell_size_;
+}
+
+void HeatmapLayer::build_mip_levels(){
+  vector<float> & base = levels_[0];
+  for (size_t i=0; i < values_.size(); i++){
+    base[i] = is_drawn_[i] ? values_[i] : NAN;
+  }
+
+  //each coarse cell covers a 2x2 block of the finer level, the last row/column
+  //also picks up the leftover when the finer level has an odd size
+  for (size_t l=1; l < levels_.size(); l++){
+    const vector<float> & src = levels_[l-1];
+    vector<float> & dst = levels_[l];
+    int sw = level_w_[l-1];
+    int sh = level_h_[l-1];
+    int dw = level_w_[l];
+    int dh = level_h_[l];
+    for (int y=0; y < dh; y++){
+      int y0 = sh == 1 ? 0 : 2*y;
+      int y1 = (y == dh-1) ? sh : y0 + 2;
+      for (int x=0; x < dw; x++){
+	int x0 = sw == 1 ? 0 : 2*x;
+	int x1 = (x == dw-1) ? sw : x0 + 2;
+	float acc = aggregation_ == HEATMAP_AGG_MAX ? -INFINITY : 0;
+	int n = 0;
+	for (int sy=y0; sy < y1; sy++){
+	  for (int sx=x0; sx < x1; sx++){
+	    float v = src[sy * sw + sx];
+	    if (isnan(v)) continue;
+	    if (aggregation_ == HEATMAP_AGG_MAX) acc = v > acc ? v : acc;
+	    else acc += v;
+	    n++;
+	  }
+	}
+	if (n == 0) dst[y * dw + x] = NAN;
+	else if (aggregation_ == HEATMAP_AGG_MAX) dst[y * dw + x] = acc;
+	else dst[y * dw + x] = acc / n;
+      }
+    }
+  }
+}
+
+void HeatmapLayer::upload_texture(){
+  build_mip_levels();
+  glBindTexture(GL_TEXTURE_2D, value_texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  for (size_t i=0; i < levels_.size(); i++){
+    glTexSubImage2D(GL_TEXTURE_2D, i, 0, 0, level_w_[i], level_h_[i], GL_RED, GL_FLOAT, &(levels_[i][0]));
+  }
+  glBindTexture(GL_TEXTURE_2D, 0);
+  is_dirty_ = false;
+}
+
+void HeatmapLayer::draw(glm::mat4 view_matrix){
+  if (is_dirty_) upload_texture();
+
+  glUseProgram(prog_id_);
+  glUniformMatrix4fv(view_mat_id_, 1, GL_FALSE, &view_matrix[0][0]);
+  glm::vec2 grid_size = glm::vec2(n_x_, n_y_) * cell_size_;
+  glUniform2f(origin_id_, origin_.x, origin_.y);
+  glUniform2f(size_id_, grid_size.x, grid_size.y);
+  glUniform1f(depth_id_, 0.1 + ((float)layer_));
+  glUniform1f(cmap_min_id_, cmap_min_);
+  glUniform1f(cmap_max_id_, cmap_max_);
+
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, value_texture_);
+  glUniform1i(values_tex_id_, 0);
+  glActiveTexture(GL_TEXTURE1);
+  glBindTexture(GL_TEXTURE_2D, lut_texture_);
+  glUniform1i(lut_tex_id_, 1);
+
+  glEnableVertexAttribArray(vert_pos_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, quad_buffer_);
+  glVertexAttribPointer(vert_pos_id_,
+			2,                  // size
+			GL_FLOAT,           // type
+			GL_FALSE,           // normalized?
+			0,                  // stride
+			(void*)0            // array buffer offset
+			);
+  glDrawArrays(GL_TRIANGLES, 0, 6);
+
+  glDisableVertexAttribArray(vert_pos_id_);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D, 0);
+}
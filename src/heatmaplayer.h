@@ -0,0 +1,109 @@
+#pragma once
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+#include "equation.h"
+
+/**
+   A regular grid of cells drawn as a single textured quad.
+
+   The values of the cells are stored in a float texture and the color map is
+   applied in the fragment shader with a lookup texture, so a wafer with
+   thousands of cells is one draw call instead of one svg instance per cell.
+
+   The mip levels of the value texture are filled with either the mean or the
+   max of the cells below them so zoomed out views don't just alias.
+ **/
+
+#define HEATMAP_AGG_MEAN 0
+#define HEATMAP_AGG_MAX 1
+
+struct grid_layer_desc{
+  std::string id;
+
+  //lower left corner of the grid in model space
+  float x_origin;
+  float y_origin;
+
+  float cell_width;
+  float cell_height;
+
+  int n_x;
+  int n_y;
+
+  int layer;
+
+  std::string cmap_id;
+  float cmap_min;
+  float cmap_max;
+
+  int aggregation;
+};
+
+typedef struct grid_layer_desc grid_layer_desc;
+
+class HeatmapLayer{
+ public:
+  HeatmapLayer(grid_layer_desc desc);
+  ~HeatmapLayer();
+
+  void set_value(int x, int y, float val);
+  //the color map of the displayed equation, the lookup texture is rebuilt when it changes
+  void set_cmap(color_map_t cmap);
+  void set_cell_drawn(int x, int y, bool drawn);
+  bool is_cell_drawn(int x, int y);
+
+  //returns false if the point is outside of the grid
+  bool get_cell(glm::vec2 p, int & x, int & y);
+  glm::vec2 get_cell_center(int x, int y);
+  //the cells [x0, x1] x [y0, y1] whose centers can be in the box, false if none
+  bool get_cell_range(glm::vec2 min_p, glm::vec2 max_p, int & x0, int & y0, int & x1, int & y1);
+  void get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb);
+
+  int get_n_x(){return n_x_;}
+  int get_n_y(){return n_y_;}
+  int get_layer(){return layer_;}
+  std::string get_id(){return id_;}
+
+  void draw(glm::mat4 view_matrix);
+  void clean_out_buffers();
+
+ private:
+  HeatmapLayer(const HeatmapLayer&); //prevent copy construction
+  HeatmapLayer& operator=(const HeatmapLayer&); //prevent assignment
+
+  void build_mip_levels();
+  void build_lut();
+  void upload_texture();
+
+  std::string id_;
+  glm::vec2 origin_;
+  glm::vec2 cell_size_;
+  int n_x_, n_y_;
+  int layer_;
+  int aggregation_;
+
+  float cmap_min_, cmap_max_;
+  color_map_t cmap_;
+
+  //level 0 is the cell values, cells that aren't drawn are NaN
+  std::vector< std::vector<float> > levels_;
+  std::vector<int> level_w_;
+  std::vector<int> level_h_;
+
+  std::vector<float> values_;
+  std::vector<unsigned char> is_drawn_;
+  bool is_dirty_;
+
+  GLuint prog_id_;
+  GLuint vert_pos_id_;
+  GLuint view_mat_id_, origin_id_, size_id_, depth_id_;
+  GLuint values_tex_id_, lut_tex_id_, cmap_min_id_, cmap_max_id_;
+
+  GLuint quad_buffer_;
+  GLuint value_texture_;
+  GLuint lut_texture_;
+};
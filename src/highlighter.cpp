@@ -2,6 +2,9 @@
 
 #include "glm/gtx/color_space.hpp"
 #include <list>
+#include <algorithm>
+#include <unordered_set>
+#include <memory>
 #include "geometryutils.h"
 #include "genericutils.h"
 #include <unistd.h>
@@ -23,69 +26,220 @@ int Highlighter::get_clicked_elem(glm::vec2 click_point){
 	int is_set = 0;
 	int elem_id = -1;
 	int layer = -1;
-	for (size_t i=0; i < geo_polys_.size(); i++){
-		if (geo_polys_[i].is_inside(click_point) && ((*vis_elems_)[geo_ids_[i]]->is_drawn())){
-			if (!is_set){
-				elem_id = geo_ids_[i];
-				layer = geo_layer_[i];
-				is_set = 1;
-			}else{
-				if (geo_layer_[i] > layer){
-					layer = geo_layer_[i];
-					elem_id = geo_ids_[i];
-				}
-			}
+	if (!pick_grid_.is_built()) pick_grid_.build(inst_min_, inst_max_, inst_layer_);
+	const uint32_t * cand;
+	const uint32_t * cand_end;
+	pick_grid_.get_candidates(click_point, cand, cand_end);
+	//the candidates are front to back so the first hit is the one on top
+	for (; cand != cand_end; cand++){
+		if (is_inside_instance(*cand, click_point) && vis_elems_->is_drawn(inst_elem_[*cand])){
+			elem_id = inst_elem_[*cand];
+			layer = inst_layer_[*cand];
+			is_set = 1;
+			break;
+		}
+	}
+	for (size_t i=0; i < grid_layers_.size(); i++){
+		int x, y;
+		if (!grid_layers_[i]->get_cell(click_point, x, y)) continue;
+		int cell_elem = grid_cell_elems_[i][y * grid_layers_[i]->get_n_x() + x];
+		if (cell_elem < 0 || !grid_layers_[i]->is_cell_drawn(x, y)) continue;
+		if (!is_set || grid_layers_[i]->get_layer() > layer){
+			elem_id = cell_elem;
+			layer = grid_layers_[i]->get_layer();
+			is_set = 1;
 		}
 	}
 	return  elem_id;
 }
 
 
-void Highlighter::add_shape_definition(std::string id, std::string svg_path){
-  /**
-     void con_svg_to_polys(string fn, float tol,
-		      std::vector<std::vector<glm::vec2> > & polygons,
-		      std::vector< glm::vec4 > & polygon_colors
-		      );
-   **/
-	std::vector<std::vector<glm::vec2> > polygons;
-	std::vector< glm::vec4 > polygon_colors;
-	con_svg_to_polys(svg_path, .1, polygons, polygon_colors);
-	
-	vector<Polygon> pvec;
-	for (size_t i=0; i < polygons.size();i++){
-		pvec.push_back(Polygon(polygons[i]));
+bool Highlighter::is_inside_instance(size_t inst, glm::vec2 p){
+	if (p.x < inst_min_[inst].x || p.x > inst_max_[inst].x ||
+	    p.y < inst_min_[inst].y || p.y > inst_max_[inst].y) return false;
+	vec3 shape_p = inst_inverse_[inst] * vec3(p, 1);
+	vector<Polygon> & polys = shapes_[inst_shape_[inst]].polys;
+	for (size_t i=0; i < polys.size(); i++){
+		if (polys[i].is_inside(vec2(shape_p))) return true;
 	}
-	shape_polys_[id] = pvec;
+	return false;
 }
 
-void Highlighter::add_defined_shape(std::string id, glm::mat4 transform, int elem_id, int layer){
-	if ( shape_polys_.find(id) == shape_polys_.end()){
+void Highlighter::add_shape_definition(std::string id, std::string svg_path, GeometryCache & geo_cache){
+	const svg_geometry & geo = geo_cache.get_svg(svg_path);
+
+	pick_shape shape;
+	for (size_t i=0; i < geo.polygon_tris.size();i++){
+		const vector<glm::vec2> & tri_points = geo.polygon_tris[i];
+		if (tri_points.size() == 0) continue;
+		vector<Triangle> tris;
+		for (size_t j=0; j + 2 < tri_points.size(); j+=3){
+			tris.push_back(Triangle(tri_points[j], tri_points[j+1], tri_points[j+2]));
+		}
+		shape.polys.push_back(Polygon(tris));
+		vec2 min, max;
+		shape.polys.back().get_AABB(min, max);
+		shape.min_aabb = shape.polys.size() == 1 ? min : glm::min(shape.min_aabb, min);
+		shape.max_aabb = shape.polys.size() == 1 ? max : glm::max(shape.max_aabb, max);
+	}
+
+	//redefining a shape keeps its index so placed copies pick up the change
+	auto it = shape_inds_.find(id);
+	if (it != shape_inds_.end()){
+		shapes_[it->second] = shape;
+	} else {
+		shape_inds_[id] = shapes_.size();
+		shapes_.push_back(shape);
+	}
+	pick_grid_.clear();
+}
+
+static void set_instance(const glm::mat4 & trans, const glm::vec2 & shape_min, const glm::vec2 & shape_max,
+			 glm::mat3 & inverse, glm::vec2 & inst_min, glm::vec2 & inst_max){
+	//the 2d part of the transform, laid out like transform_vec2 uses it
+	glm::mat3 m(trans[0][0], trans[0][1], 0,
+		    trans[1][0], trans[1][1], 0,
+		    trans[3][0], trans[3][1], 1);
+	inverse = glm::inverse(m);
+	vec2 corners[4] = {shape_min, vec2(shape_min.x, shape_max.y),
+			   vec2(shape_max.x, shape_min.y), shape_max};
+	inst_min = inst_max = transform_vec2(corners[0], trans);
+	for (int i=1; i < 4; i++){
+		vec2 c = transform_vec2(corners[i], trans);
+		inst_min = glm::min(inst_min, c);
+		inst_max = glm::max(inst_max, c);
+	}
+}
+
+int Highlighter::add_instance(std::string id, int elem_id, int layer){
+	auto it = shape_inds_.find(id);
+	if ( it == shape_inds_.end()){
 		print_and_exit("trying to add unknown shape");
 	}
-	vector<Polygon> s_polys = shape_polys_[id];
-	
-	//cout<<"Found  s_polys.size() "<<s_polys.size()<<endl;
-	for (size_t i=0; i < s_polys.size(); i++){
-		geo_polys_.push_back(s_polys[i]);
-		geo_ids_.push_back(elem_id);
-		geo_polys_[geo_polys_.size()-1].apply_transform(transform);
-		geo_layer_.push_back(layer);
+	//shapes with no polygons can't be clicked
+	if (shapes_[it->second].polys.size() == 0) return -1;
+	pick_grid_.clear();
+	int inst = inst_shape_.size();
+	inst_shape_.push_back(it->second);
+	inst_elem_.push_back(elem_id);
+	inst_layer_.push_back(layer);
+	inst_inverse_.push_back(glm::mat3(1));
+	inst_min_.push_back(vec2(0));
+	inst_max_.push_back(vec2(0));
+	return inst;
+}
+
+void Highlighter::add_defined_shape(std::string id, glm::mat4 transform, int elem_id, int layer){
+	int inst = add_instance(id, elem_id, layer);
+	if (inst < 0) return;
+	const pick_shape & shape = shapes_[inst_shape_[inst]];
+	set_instance(transform, shape.min_aabb, shape.max_aabb,
+		     inst_inverse_[inst], inst_min_[inst], inst_max_[inst]);
+}
+
+void Highlighter::add_defined_shapes(const std::vector<std::string> & ids,
+				     const std::vector<glm::mat4> & transforms,
+				     const std::vector<int> & elem_ids,
+				     const std::vector<int> & layers,
+				     ThreadPool & pool){
+	//the instances are added in order here so only the inverses run in parallel
+	std::shared_ptr< vector<int> > insts(new vector<int>(ids.size()));
+	for (size_t i=0; i < ids.size(); i++){
+		(*insts)[i] = add_instance(ids[i], elem_ids[i], layers[i]);
+	}
+
+	Highlighter * hl = this;
+	pool.submit_range("place pick shapes", ids.size(), 2048,
+			  [hl, insts, &transforms](size_t begin, size_t end){
+				  for (size_t i=begin; i < end; i++){
+					  int inst = (*insts)[i];
+					  if (inst < 0) continue;
+					  const pick_shape & shape = hl->shapes_[hl->inst_shape_[inst]];
+					  set_instance(transforms[i], shape.min_aabb, shape.max_aabb,
+						       hl->inst_inverse_[inst], hl->inst_min_[inst], hl->inst_max_[inst]);
+				  }
+			  });
+}
+
+void Highlighter::add_grid_cell(HeatmapLayer * grid, int x, int y, int elem_id){
+	size_t ind = 0;
+	for (; ind < grid_layers_.size(); ind++){
+		if (grid_layers_[ind] == grid) break;
+	}
+	if (ind == grid_layers_.size()){
+		grid_layers_.push_back(grid);
+		grid_cell_elems_.push_back(vector<int>(grid->get_n_x() * grid->get_n_y(), -1));
+	}
+	grid_cell_elems_[ind][y * grid->get_n_x() + x] = elem_id;
+}
+
+void Highlighter::add_vis_elem_shapes(ThreadPool & pool){
+	std::vector<std::string> shape_ids;
+	std::vector<int> elem_ids;
+	std::vector<int> layers;
+	pick_transforms_.clear();
+	for (size_t i=0; i < vis_elems_->size(); i++){
+		if (vis_elems_->get_heatmap_layer(i) != NULL){
+			add_grid_cell(vis_elems_->get_heatmap_layer(i),
+				      vis_elems_->get_grid_x(i), vis_elems_->get_grid_y(i), i);
+			continue;
+		}
+		shape_ids.push_back(vis_elems_->get_geo_id(i));
+		pick_transforms_.push_back(vis_elems_->get_ms_transform(i));
+		elem_ids.push_back(i);
+		layers.push_back(vis_elems_->get_layer(i));
 	}
+	add_defined_shapes(shape_ids, pick_transforms_, elem_ids, layers, pool);
+}
+
+void Highlighter::clear_shapes(){
+	clear_hover();
+	pick_grid_.clear();
+	inst_shape_.clear();
+	inst_elem_.clear();
+	inst_layer_.clear();
+	inst_inverse_.clear();
+	inst_min_.clear();
+	inst_max_.clear();
+	grid_layers_.clear();
+	grid_cell_elems_.clear();
 }
+
 void Highlighter::set_AABB(){
-	if (geo_polys_.size() <1) print_and_exit("we have empty clickgeo");
+	size_t n_insts = inst_min_.size();
+	if (n_insts <1 && grid_layers_.size() < 1) print_and_exit("we have empty clickgeo");
 	vec2 min;
 	vec2 max;
-	geo_polys_[0].get_AABB(min_AABB_, max_AABB_);
-	for (size_t i=1; i < geo_polys_.size(); i++){
-		geo_polys_[i].get_AABB(min, max);
+	if (n_insts > 0){
+		min_AABB_ = inst_min_[0];
+		max_AABB_ = inst_max_[0];
+	}
+	else grid_layers_[0]->get_AABB(min_AABB_, max_AABB_);
+	for (size_t i=0; i < n_insts + grid_layers_.size(); i++){
+		if (i < n_insts){
+			min = inst_min_[i];
+			max = inst_max_[i];
+		}
+		else grid_layers_[i - n_insts]->get_AABB(min, max);
 		if (min.x < min_AABB_.x) min_AABB_.x = min.x;
 		if (min.y < min_AABB_.y) min_AABB_.y = min.y;
 		if (max.x > max_AABB_.x) max_AABB_.x = max.x;
 		if (max.y > max_AABB_.y) max_AABB_.y = max.y;
 	}
 }
+void Highlighter::get_drawn_boxes(std::vector<int> & elems, std::vector<glm::vec2> & mins,
+				  std::vector<glm::vec2> & maxs){
+	elems.clear();
+	mins.clear();
+	maxs.clear();
+	for (size_t i=0; i < inst_elem_.size(); i++){
+		if (!vis_elems_->is_drawn(inst_elem_[i])) continue;
+		elems.push_back(inst_elem_[i]);
+		mins.push_back(inst_min_[i]);
+		maxs.push_back(inst_max_[i]);
+	}
+}
+
 void Highlighter::get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb){
 	set_AABB();
 	min_aabb = min_AABB_;
@@ -95,37 +249,27 @@ void Highlighter::get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb){
 
 
 
-Highlighter::Highlighter(TwBar * info_bar, std::vector<VisElemPtr> * vis_elems, size_t num_info_bar_elems)
+Highlighter::Highlighter(TwBar * info_bar, VisElemStore * vis_elems, size_t num_info_bar_elems)
 	: num_info_bar_elems_(num_info_bar_elems)
 {
 	info_bar_ = info_bar;
 	vis_elems_ = vis_elems;
 	info_bar_index=-1;
-	
-	if (bind_udp_socket(listen_socket_, "127.0.0.1", 5555)){
-		listen_socket_ = -1;
-	}
-	send_socket_ = socket(AF_INET, SOCK_DGRAM, 0);
-	if ( fill_addr("127.0.0.1", 5556, send_addr_) ){
-		log_debug("issue with filling address");
-		send_socket_ = -1;
-	}
+	hover_bar_ = NULL;
+	hover_elem_ = -1;
+	hover_value_ = 0;
+	selection_epoch_ = 0;
+	announce_selection_ = false;
 }
 
-void Highlighter::check_socket(){
-	if (listen_socket_ < 0) return;
-	std::vector<std::string> strs;
-	if (get_string_list(listen_socket_, strs)) return;
-	bool fill_info = false;
-	for (size_t i=0; i < strs.size(); i++) {
-		if (strs[i].size() > 0) {
-			run_search(strs[i].c_str(), true, true, true);
-			fill_info = true;
-		}
-	}
-	if (fill_info)
-		fill_info_bar();
+void Highlighter::set_announce_selection(bool announce){
+	announce_selection_ = announce;
+	if (!announce) announced_labels_.clear();
+}
 
+void Highlighter::take_announced_labels(std::vector<std::string> & labels){
+	labels.clear();
+	labels.swap(announced_labels_);
 }
 
 //parsing inputs
@@ -141,24 +285,69 @@ void Highlighter::parse_click(glm::vec2 pos, int mod_key){
 	fill_info_bar();
 }
 
+void Highlighter::update_hover(glm::vec2 pos, int screen_x, int screen_y){
+	if (hover_bar_ == NULL) return;
+	int elem = get_clicked_elem(pos);
+	if (elem < 0){
+		clear_hover();
+		return;
+	}
+	if (elem != hover_elem_){
+		hover_elem_ = elem;
+		TwRemoveAllVars(hover_bar_);
+		hover_label_ = vis_elems_->get_label(elem, 0);
+		TwAddVarRO(hover_bar_, "hover_label", TW_TYPE_STDSTRING, &hover_label_, " label='id' ");
+		if (vis_elems_->get_num_eqs(elem) > 0){
+			std::string opts = std::string(" label='") +
+				vis_elems_->get_current_equation(elem).get_display_label() + std::string("' ");
+			TwAddVarRO(hover_bar_, "hover_value", TW_TYPE_FLOAT, &hover_value_, opts.c_str());
+		}
+	}
+	if (vis_elems_->get_num_eqs(elem) > 0)
+		hover_value_ = vis_elems_->get_current_equation(elem).get_value();
+
+	int hover_pos[2] = {screen_x + 16, screen_y + 16};
+	int visible = 1;
+	TwSetParam(hover_bar_, NULL, "position", TW_PARAM_INT32, 2, hover_pos);
+	TwSetParam(hover_bar_, NULL, "visible", TW_PARAM_INT32, 1, &visible);
+}
+
+void Highlighter::clear_hover(){
+	if (hover_bar_ == NULL || hover_elem_ < 0) return;
+	hover_elem_ = -1;
+	TwRemoveAllVars(hover_bar_);
+	int visible = 0;
+	TwSetParam(hover_bar_, NULL, "visible", TW_PARAM_INT32, 1, &visible);
+}
+
+void Highlighter::build_label_index(ThreadPool & pool){
+	LabelIndex * label_index = &label_index_;
+	VisElemStore * vis_elems = vis_elems_;
+	pool.submit("label index", [label_index, vis_elems](){ label_index->build(*vis_elems); });
+}
+
 void Highlighter::run_search(const char * search_str, bool no_send, bool no_clear, 
 			     bool quick){
 	if (! no_clear)
 		clear_hls();
 
+	if (!label_index_.is_built()) label_index_.build(*vis_elems_);
+	std::vector<int> matches;
 	if (quick) {
-		for (size_t i=0; i < vis_elems_->size(); i++){
-			if ((*vis_elems_)[i]->string_matches_labels_quick(search_str) && (*vis_elems_)[i]->is_drawn()){
-				add_hl(i, no_send);
+		label_index_.find_exact(search_str, matches);
+		for (size_t i=0; i < matches.size(); i++){
+			if (vis_elems_->is_drawn(matches[i])){
+				add_hl(matches[i], no_send);
 				break;
 			}
 		}
 	} else {
-		for (size_t i=0; i < vis_elems_->size(); i++){
-			if ((*vis_elems_)[i]->string_matches_labels(search_str) && (*vis_elems_)[i]->is_drawn()){
-				add_hl(i, no_send);
-			}
+		label_index_.find_glob(search_str, matches);
+		std::vector<int> drawn;
+		for (size_t i=0; i < matches.size(); i++){
+			if (vis_elems_->is_drawn(matches[i])) drawn.push_back(matches[i]);
 		}
+		add_hls(drawn, no_send);
 		fill_info_bar();
 	}
 }
@@ -177,13 +366,13 @@ void Highlighter::fill_info_bar(){
 		auto hl_colors_it = hl_colors_.begin();
 		for (auto hl_ind=hl_inds_.begin(); hl_ind != hl_inds_.end(); hl_ind++, hl_colors_it++, i++){
 			int el = *hl_ind;
-			(*vis_elems_)[el]->update_all_equations();
+			vis_elems_->update_all_equations(el);
 			std::vector<string> ai_labels;
 			std::vector<string> ai_tags;
 			std::vector<string*> ai_tag_vals;
 			std::vector<string> ai_eq_labels;
 			std::vector<float*> ai_eq_addrs;
-			(*vis_elems_)[el]->get_all_info(ai_labels, ai_tags, ai_tag_vals, ai_eq_labels, ai_eq_addrs);
+			vis_elems_->get_all_info(el, ai_labels, ai_tags, ai_tag_vals, ai_eq_labels, ai_eq_addrs);
 			
 			std::string group_label = std::string(" group=") + ai_labels[0] + std::string( " ");
 			
@@ -218,7 +407,7 @@ void Highlighter::update_info_bar(){
 		TwRefreshBar(info_bar_);
 		if (hl_inds_.size() < num_info_bar_elems_ && hl_inds_.size() > 0){
 			for (auto j=hl_inds_.begin(); j != hl_inds_.end(); j++){
-				(*vis_elems_)[*j]->update_all_equations();
+				vis_elems_->update_all_equations(*j);
 			}
 		}
 	}
@@ -232,30 +421,136 @@ void Highlighter::clear_hls(){
 	
 	while (!(hl_inds_.empty())){
 		int el = hl_inds_.front();
-		(*vis_elems_)[el]->set_not_highlighted();
+		vis_elems_->set_not_highlighted(el);
 		hl_inds_.pop_front();
 		hl_colors_.pop_front();
 	}
+	hl_set_.clear();
+	selection_epoch_++;
 }
 
 void Highlighter::add_hl(int index, bool no_send){
-	for (auto iter = hl_inds_.begin(); iter != hl_inds_.end(); ++iter) {
-		if (*iter == index) return;
-	}
+	if (hl_set_.count(index)) return;
+	add_new_hl(index, no_send);
+}
+
+void Highlighter::add_new_hl(int index, bool no_send){
 	glm::vec3 hcol =  get_hl_color(hl_inds_.size());
-	(*vis_elems_)[index]->set_highlighted(hcol);
+	vis_elems_->set_highlighted(index, hcol);
 	hl_inds_.push_back(index);
+	hl_set_.insert(index);
 	hl_colors_.push_back(hcol);
+	selection_epoch_++;
 	
-	if (! no_send || send_socket_ < 0) {
-		if ((*vis_elems_)[index]->labels.size()== 0) return;
-		std::string s( (*vis_elems_)[index]->labels[0] );
-		log_debug("sending %s\n", s.c_str());
-		sendto(send_socket_, 
-		       s.c_str(), s.size()+1,
-		       0, (struct sockaddr *)&send_addr_,
-		       sizeof(send_addr_));
+	if (! no_send && announce_selection_) {
+		if (vis_elems_->get_num_labels(index) == 0) return;
+		announced_labels_.push_back(vis_elems_->get_label(index, 0));
+	}
+}
+
+void Highlighter::add_hls(const std::vector<int> & inds, bool no_send){
+	for (size_t i=0; i < inds.size(); i++){
+		if (hl_set_.count(inds[i])) continue;
+		add_new_hl(inds[i], no_send);
+	}
+}
+
+void Highlighter::find_label(const std::string & label, std::vector<int> & elems){
+	if (!label_index_.is_built()) label_index_.build(*vis_elems_);
+	label_index_.find_exact(label, elems);
+}
+
+int Highlighter::select_labels(const std::vector<std::string> & labels, bool add_to_selection, bool no_send){
+	if (!add_to_selection) clear_hls();
+	if (!label_index_.is_built()) label_index_.build(*vis_elems_);
+	std::vector<int> matches;
+	std::vector<int> drawn;
+	for (size_t i=0; i < labels.size(); i++){
+		label_index_.find_exact(labels[i], matches);
+		for (size_t j=0; j < matches.size(); j++){
+			if (vis_elems_->is_drawn(matches[j])) drawn.push_back(matches[j]);
+		}
+	}
+	add_hls(drawn, no_send);
+	fill_info_bar();
+	return drawn.size();
+}
+
+void Highlighter::get_elems_in_region(glm::vec2 min_p, glm::vec2 max_p,
+				      const std::vector<glm::vec2> * lasso, std::vector<int> & elems){
+	elems.clear();
+	if (!pick_grid_.is_built()) pick_grid_.build(inst_min_, inst_max_, inst_layer_);
+
+	//an element can have several pick shapes, each element is tested once
+	std::vector<char> seen(vis_elems_->size(), 0);
+	std::vector<int> cands;
+	std::vector<uint32_t> insts;
+	pick_grid_.query_box(min_p, max_p, insts);
+	for (size_t i=0; i < insts.size(); i++){
+		int el = inst_elem_[insts[i]];
+		if (seen[el]) continue;
+		seen[el] = 1;
+		cands.push_back(el);
 	}
+	//grid elements sit at their cell centers, only the cells over the box are looked at
+	for (size_t i=0; i < grid_layers_.size(); i++){
+		int x0, y0, x1, y1;
+		if (!grid_layers_[i]->get_cell_range(min_p, max_p, x0, y0, x1, y1)) continue;
+		int n_x = grid_layers_[i]->get_n_x();
+		for (int y=y0; y <= y1; y++){
+			for (int x=x0; x <= x1; x++){
+				int el = grid_cell_elems_[i][y * n_x + x];
+				if (el < 0 || seen[el] || !vis_elems_->is_drawn(el)) continue;
+				seen[el] = 1;
+				if (lasso != NULL && !inside_contour(*lasso, grid_layers_[i]->get_cell_center(x, y))) continue;
+				elems.push_back(el);
+			}
+		}
+	}
+
+	for (size_t i=0; i < cands.size(); i++){
+		int el = cands[i];
+		if (!vis_elems_->is_drawn(el)) continue;
+		glm::mat4 trans = vis_elems_->get_ms_transform(el);
+		glm::vec2 center(trans[3][0], trans[3][1]);
+		if (center.x < min_p.x || center.x > max_p.x ||
+		    center.y < min_p.y || center.y > max_p.y) continue;
+		if (lasso != NULL && !inside_contour(*lasso, center)) continue;
+		elems.push_back(el);
+	}
+	std::sort(elems.begin(), elems.end());
+}
+
+void Highlighter::select_box(glm::vec2 corner_a, glm::vec2 corner_b, bool add_to_selection, bool no_send){
+	if (!add_to_selection) clear_hls();
+	std::vector<int> elems;
+	get_elems_in_region(glm::min(corner_a, corner_b), glm::max(corner_a, corner_b), NULL, elems);
+	add_hls(elems, no_send);
+	fill_info_bar();
+}
+
+void Highlighter::select_lasso(const std::vector<glm::vec2> & outline, bool add_to_selection, bool no_send){
+	if (!add_to_selection) clear_hls();
+	if (outline.size() < 3){
+		fill_info_bar();
+		return;
+	}
+	glm::vec2 min_p = outline[0];
+	glm::vec2 max_p = outline[0];
+	for (size_t i=1; i < outline.size(); i++){
+		min_p = glm::min(min_p, outline[i]);
+		max_p = glm::max(max_p, outline[i]);
+	}
+	std::vector<int> elems;
+	get_elems_in_region(min_p, max_p, &outline, elems);
+	add_hls(elems, no_send);
+	fill_info_bar();
+}
+
+void Highlighter::select_elems(const std::vector<int> & elems, bool add_to_selection, bool no_send){
+	if (!add_to_selection) clear_hls();
+	add_hls(elems, no_send);
+	fill_info_bar();
 }
 
 std::list<int> Highlighter::get_plot_inds(){
@@ -3,13 +3,17 @@
 #include <vector>
 #include <map>
 #include <list>
+#include <unordered_set>
 
 #include "glm/glm.hpp"
 #include <AntTweakBar.h>
 
 #include "polygon.h"
+#include "pickgrid.h"
+#include "labelindex.h"
+#include "geometrycache.h"
+#include "threadpool.h"
 #include "visualelement.h"
-#include "sockethelper.h"
 
 
 /**
@@ -20,54 +24,128 @@
 
 class Highlighter{
 public:
-	Highlighter(TwBar * info_bar, std::vector<VisElemPtr> * vis_elems, size_t num_info_bar_elems);
+	Highlighter(TwBar * info_bar, VisElemStore * vis_elems, size_t num_info_bar_elems);
   
 	//code for handling shape geometry
+	//the highest drawn element under the point, -1 if there is none
 	int get_clicked_elem(glm::vec2 click_point);
-	void add_shape_definition(std::string id, std::string svg_path);
+	void add_shape_definition(std::string id, std::string svg_path, GeometryCache & geo_cache);
 	void add_defined_shape(std::string id, glm::mat4 transform, int elem_id, int layer);
+	//same as add_defined_shape for every element, the transforms happen on the pool
+	//so transforms has to outlive pool.wait()
+	void add_defined_shapes(const std::vector<std::string> & ids,
+				const std::vector<glm::mat4> & transforms,
+				const std::vector<int> & elem_ids,
+				const std::vector<int> & layers,
+				ThreadPool & pool);
+	void add_grid_cell(HeatmapLayer * grid, int x, int y, int elem_id);
+	//adds the pick shape or grid cell of every visual element, the
+	//transforms run on the pool so call pool.wait() before picking
+	void add_vis_elem_shapes(ThreadPool & pool);
+	//drops the placed shapes and grid cells, the shape definitions are kept
+	void clear_shapes();
 	
 	void set_AABB();
 	void get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb);
+	//the model space boxes of the drawn svg elements, grid cells aren't included
+	void get_drawn_boxes(std::vector<int> & elems, std::vector<glm::vec2> & mins, std::vector<glm::vec2> & maxs);
 	
 	
+	//the search index is built on the pool, wait on it before searching
+	void build_label_index(ThreadPool & pool);
+
 	//code for parsing inputs
 	void parse_click(glm::vec2 pos, int mod_key);
+	//shows the element under the cursor in the hover bar next to it
+	void set_hover_bar(TwBar * hover_bar){hover_bar_ = hover_bar;}
+	void update_hover(glm::vec2 pos, int screen_x, int screen_y);
+	void clear_hover();
 	void run_search(const char * search_str, bool no_send = false, bool no_clear = false, bool quick = false);
 	void clear_hls();
 	void add_hl(int index, bool no_send = false);
+	void add_hls(const std::vector<int> & inds, bool no_send = false);
+	//every element with the label, drawn or not, in index order
+	void find_label(const std::string & label, std::vector<int> & elems);
+	//selects the drawn elements with any of the labels, returns how many
+	int select_labels(const std::vector<std::string> & labels, bool add_to_selection, bool no_send = false);
+
+	//selects the drawn elements whose centers are inside the box or the
+	//lasso, both given in model space
+	void select_box(glm::vec2 corner_a, glm::vec2 corner_b, bool add_to_selection, bool no_send = false);
+	void select_lasso(const std::vector<glm::vec2> & outline, bool add_to_selection, bool no_send = false);
+	//selects the given elements, like a bin of the histogram
+	void select_elems(const std::vector<int> & elems, bool add_to_selection, bool no_send = false);
 	void update_info_bar();
 	
+	bool has_highlights(){return !hl_inds_.empty();}
 	std::list<int> get_plot_inds();
 	std::list<glm::vec3> get_plot_colors();
 	glm::vec3 get_hl_color(int ind);
 	
 	void fill_info_bar();
-	
-	void check_socket();
+
+	//bumped whenever the selection changes
+	unsigned long get_selection_epoch(){return selection_epoch_;}
+	//while announcing, the labels of the highlights added without no_send
+	//are kept until they are taken
+	void set_announce_selection(bool announce);
+	void take_announced_labels(std::vector<std::string> & labels);
 private:
+	//the placed copy of a shape is set up by the caller
+	int add_instance(std::string id, int elem_id, int layer);
+	bool is_inside_instance(size_t inst, glm::vec2 p);
+	//add_hl without the check for an existing highlight
+	void add_new_hl(int index, bool no_send);
+	void get_elems_in_region(glm::vec2 min_p, glm::vec2 max_p,
+				 const std::vector<glm::vec2> * lasso, std::vector<int> & elems);
+
 	//used for shape geometry
 	glm::vec2 min_AABB_;
 	glm::vec2 max_AABB_;
-	std::vector<Polygon> geo_polys_;
-	std::vector<int> geo_ids_;
-	std::vector<int> geo_layer_;
-	
-	std::map< std::string, std::vector< Polygon > >  shape_polys_;
+	//every shape's polygons are kept once in shape space, an element only
+	//keeps the inverse of its transform and its bounds in model space
+	struct pick_shape{
+		std::vector<Polygon> polys;
+		glm::vec2 min_aabb;
+		glm::vec2 max_aabb;
+	};
+	std::vector<pick_shape> shapes_;
+	std::map<std::string, int> shape_inds_;
+
+	std::vector<int> inst_shape_;
+	std::vector<int> inst_elem_;
+	std::vector<int> inst_layer_;
+	std::vector<glm::mat3> inst_inverse_;
+	std::vector<glm::vec2> inst_min_;
+	std::vector<glm::vec2> inst_max_;
+	//rebuilt on the first pick after the shapes change
+	PickGrid pick_grid_;
+
+	std::vector<glm::mat4> pick_transforms_;
+
+	//grid layers are picked by cell index instead of polygons
+	std::vector<HeatmapLayer*> grid_layers_;
+	std::vector< std::vector<int> > grid_cell_elems_;
 	
 	std::list<int> hl_inds_;
+	std::unordered_set<int> hl_set_;
+	LabelIndex label_index_;
 	std::list<glm::vec3> hl_colors_;
 	
 	std::vector<uint32_t> atb_colors_;
-	std::vector<VisElemPtr> * vis_elems_;
+	VisElemStore * vis_elems_;
   
 	TwBar * info_bar_;
+	TwBar * hover_bar_;
+	int hover_elem_;
+	std::string hover_label_;
+	float hover_value_;
 	int info_bar_index;
 	int info_bar_is_visible_;
 	const size_t num_info_bar_elems_;
-	int listen_socket_;
-	int send_socket_;
-	sockaddr_in send_addr_;
+	unsigned long selection_epoch_;
+	bool announce_selection_;
+	std::vector<std::string> announced_labels_;
 	
 };
 
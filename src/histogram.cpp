@@ -0,0 +1,63 @@
+#include "histogram.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+ValueHistogram::ValueHistogram()
+  : n_bins_(64), pending_bins_(64), bin_min_(0), bin_scale_(0),
+    next_min_(INFINITY), next_max_(-INFINITY), shown_min_(0), shown_max_(0){
+  counts_ = vector<unsigned int>(n_bins_, 0);
+  shown_counts_ = counts_;
+}
+
+void ValueHistogram::set_num_bins(int n_bins){
+  pending_bins_ = n_bins < 1 ? 1 : n_bins;
+}
+
+void ValueHistogram::begin_pass(size_t n_elems){
+  n_bins_ = pending_bins_;
+  counts_.assign(n_bins_, 0);
+  elem_bin_.assign(n_elems, -1);
+
+  //bins over the range of the last pass, empty passes keep the old one
+  if (next_min_ <= next_max_){
+    bin_min_ = next_min_;
+    bin_scale_ = next_max_ > next_min_ ? n_bins_ / (next_max_ - next_min_) : 0.0f;
+  }
+  next_min_ = INFINITY;
+  next_max_ = -INFINITY;
+}
+
+void ValueHistogram::end_pass(){
+  shown_counts_.swap(counts_);
+  shown_min_ = bin_min_;
+  shown_max_ = bin_scale_ > 0 ? bin_min_ + n_bins_ / bin_scale_ : bin_min_;
+}
+
+void ValueHistogram::get_heights(bool log_y, std::vector<float> & heights) const{
+  heights.resize(shown_counts_.size());
+  unsigned int max_count = 0;
+  for (size_t i=0; i < shown_counts_.size(); i++) max_count = max(max_count, shown_counts_[i]);
+  if (max_count == 0){
+    fill(heights.begin(), heights.end(), 0.0f);
+    return;
+  }
+  float norm = log_y ? 1.0f / log10f(max_count + 1.0f) : 1.0f / max_count;
+  for (size_t i=0; i < shown_counts_.size(); i++){
+    heights[i] = (log_y ? log10f(shown_counts_[i] + 1.0f) : shown_counts_[i]) * norm;
+  }
+}
+
+int ValueHistogram::get_bin_at(float x) const{
+  if (x < 0 || x >= 1 || shown_counts_.size() == 0) return -1;
+  return x * shown_counts_.size();
+}
+
+void ValueHistogram::get_elems_in_bin(int bin, std::vector<int> & elems) const{
+  elems.clear();
+  for (size_t i=0; i < elem_bin_.size(); i++){
+    if (elem_bin_[i] == bin) elems.push_back(i);
+  }
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <vector>
+#include <stddef.h>
+#include <math.h>
+
+/**
+   A histogram of one value per element that is filled while the values are
+   computed for something else, the color pass adds each drawn element's
+   equation value as it goes.
+
+   The bins of a pass span the range of the values in the pass before it, so
+   it is one look at every value.  The range follows a changing display a
+   frame late.  The bin every element fell into is kept so a bin can be turned
+   back into its elements.
+ **/
+
+class ValueHistogram{
+ public:
+  ValueHistogram();
+
+  //takes effect at the next pass
+  void set_num_bins(int n_bins);
+  int get_num_bins() const {return n_bins_;}
+
+  void begin_pass(size_t n_elems);
+  void add(size_t elem, float val){
+    if (!isfinite(val)){
+      elem_bin_[elem] = -1;
+      return;
+    }
+    if (val < next_min_) next_min_ = val;
+    if (val > next_max_) next_max_ = val;
+    int b = (val - bin_min_) * bin_scale_;
+    if (b < 0) b = 0;
+    if (b >= n_bins_) b = n_bins_ - 1;
+    counts_[b]++;
+    elem_bin_[elem] = b;
+  }
+  void end_pass();
+
+  //the range of the bins of the last pass
+  float get_min() const {return shown_min_;}
+  float get_max() const {return shown_max_;}
+  //the range of the last pass, the pointers stay valid for the info bar
+  float * get_min_addr() {return &shown_min_;}
+  float * get_max_addr() {return &shown_max_;}
+
+  //bar heights from 0 to 1 of the last pass
+  void get_heights(bool log_y, std::vector<float> & heights) const;
+  //the bin under x, from 0 at the left edge to 1 at the right, or -1
+  int get_bin_at(float x) const;
+  void get_elems_in_bin(int bin, std::vector<int> & elems) const;
+
+ private:
+  int n_bins_;
+  int pending_bins_;
+
+  //what the current pass bins with
+  float bin_min_;
+  float bin_scale_;
+  //the range seen so far in the current pass
+  float next_min_;
+  float next_max_;
+
+  float shown_min_;
+  float shown_max_;
+
+  std::vector<unsigned int> counts_;
+  std::vector<unsigned int> shown_counts_;
+  std::vector<int> elem_bin_;
+};
@@ -0,0 +1,172 @@
+#include "labelindex.h"
+
+#include <fnmatch.h>
+#include <string.h>
+#include <algorithm>
+
+using namespace std;
+
+
+static uint32_t get_trigram(const char * s){
+  return ((uint32_t)(unsigned char)s[0] << 16) |
+    ((uint32_t)(unsigned char)s[1] << 8) | (uint32_t)(unsigned char)s[2];
+}
+
+static void add_trigrams(const string & run, vector<uint32_t> & trigrams){
+  for (size_t i=0; i + 3 <= run.size(); i++) trigrams.push_back(get_trigram(run.c_str() + i));
+}
+
+//splits a glob into the literal runs between wildcards and returns the
+//literal text before the first one
+static string get_literal_runs(const char * pattern, vector<string> & runs){
+  string prefix;
+  string run;
+  bool in_prefix = true;
+  for (const char * p = pattern; *p; p++){
+    if (*p == '*' || *p == '?' || *p == '['){
+      in_prefix = false;
+      if (run.size() > 0) runs.push_back(run);
+      run.clear();
+      if (*p == '['){
+	//skip the class, a ']' right after the '[' or '[!' is part of it
+	const char * q = p + 1;
+	if (*q == '!' || *q == '^') q++;
+	if (*q == ']') q++;
+	while (*q && *q != ']') q++;
+	if (!*q) break;
+	p = q;
+      }
+      continue;
+    }
+    if (*p == '\\'){
+      if (!p[1]) break;
+      p++;
+    }
+    run.push_back(*p);
+    if (in_prefix) prefix.push_back(*p);
+  }
+  if (run.size() > 0) runs.push_back(run);
+  return prefix;
+}
+
+
+LabelIndex::LabelIndex() : is_built_(false){}
+
+void LabelIndex::build(const VisElemStore & elems){
+  is_built_ = true;
+  labels_.clear();
+  label_slots_.clear();
+  trigrams_.clear();
+
+  vector< pair<string, int> > label_elems;
+  for (size_t i=0; i < elems.size(); i++){
+    for (size_t j=0; j < elems.get_num_labels(i); j++){
+      label_elems.push_back(make_pair(elems.get_label(i, j), (int)i));
+    }
+  }
+  sort(label_elems.begin(), label_elems.end());
+
+  elem_start_.clear();
+  elems_.clear();
+  for (size_t i=0; i < label_elems.size(); i++){
+    if (i > 0 && label_elems[i].first == label_elems[i-1].first){
+      if (label_elems[i].second != elems_.back()) elems_.push_back(label_elems[i].second);
+      continue;
+    }
+    label_slots_[label_elems[i].first] = labels_.size();
+    labels_.push_back(label_elems[i].first);
+    elem_start_.push_back(elems_.size());
+    elems_.push_back(label_elems[i].second);
+  }
+  elem_start_.push_back(elems_.size());
+
+  //the slots are visited in order so every posting list comes out sorted
+  vector<uint32_t> tgs;
+  for (size_t s=0; s < labels_.size(); s++){
+    tgs.clear();
+    add_trigrams(labels_[s], tgs);
+    sort(tgs.begin(), tgs.end());
+    tgs.erase(unique(tgs.begin(), tgs.end()), tgs.end());
+    for (size_t i=0; i < tgs.size(); i++) trigrams_[tgs[i]].push_back(s);
+  }
+}
+
+void LabelIndex::add_slot_elems(uint32_t slot, std::vector<int> & elems) const{
+  for (uint32_t k=elem_start_[slot]; k < elem_start_[slot+1]; k++) elems.push_back(elems_[k]);
+}
+
+void LabelIndex::find_exact(const std::string & label, std::vector<int> & elems) const{
+  elems.clear();
+  auto it = label_slots_.find(label);
+  if (it != label_slots_.end()) add_slot_elems(it->second, elems);
+}
+
+void LabelIndex::find_glob(const char * pattern, std::vector<int> & elems) const{
+  elems.clear();
+  if (strpbrk(pattern, "*?[\\") == NULL){
+    find_exact(pattern, elems);
+    return;
+  }
+
+  if (pattern[0] && strspn(pattern, "*") == strlen(pattern)){
+    elems = elems_;
+    sort(elems.begin(), elems.end());
+    elems.erase(unique(elems.begin(), elems.end()), elems.end());
+    return;
+  }
+
+  vector<string> runs;
+  string prefix = get_literal_runs(pattern, runs);
+  vector<uint32_t> tgs;
+  for (size_t i=0; i < runs.size(); i++) add_trigrams(runs[i], tgs);
+  sort(tgs.begin(), tgs.end());
+  tgs.erase(unique(tgs.begin(), tgs.end()), tgs.end());
+
+  //the sorted labels that start with the literal prefix
+  uint32_t lo = lower_bound(labels_.begin(), labels_.end(), prefix) - labels_.begin();
+  uint32_t hi = labels_.size();
+  if (prefix.size() > 0){
+    string prefix_end = prefix;
+    prefix_end.push_back((char)0xff);
+    hi = upper_bound(labels_.begin(), labels_.end(), prefix_end) - labels_.begin();
+  }
+
+  //labels with every trigram of the pattern
+  vector<uint32_t> cands;
+  bool have_cands = false;
+  if (tgs.size() > 0){
+    //the shortest posting lists go first so the candidate list shrinks fastest
+    vector<const vector<uint32_t>*> postings;
+    static const vector<uint32_t> empty_posting;
+    for (size_t i=0; i < tgs.size(); i++){
+      auto it = trigrams_.find(tgs[i]);
+      postings.push_back(it == trigrams_.end() ? &empty_posting : &it->second);
+    }
+    sort(postings.begin(), postings.end(),
+	 [](const vector<uint32_t> * a, const vector<uint32_t> * b){ return a->size() < b->size(); });
+
+    cands = *postings[0];
+    vector<uint32_t> narrowed;
+    for (size_t i=1; i < postings.size(); i++){
+      narrowed.clear();
+      set_intersection(cands.begin(), cands.end(), postings[i]->begin(), postings[i]->end(),
+		       back_inserter(narrowed));
+      cands.swap(narrowed);
+    }
+    have_cands = true;
+  }
+
+  if (have_cands){
+    for (size_t i=0; i < cands.size(); i++){
+      uint32_t s = cands[i];
+      if (s < lo || s >= hi) continue;
+      if (!fnmatch(pattern, labels_[s].c_str(), 0)) add_slot_elems(s, elems);
+    }
+  } else {
+    for (uint32_t s=lo; s < hi; s++){
+      if (!fnmatch(pattern, labels_[s].c_str(), 0)) add_slot_elems(s, elems);
+    }
+  }
+  sort(elems.begin(), elems.end());
+  elems.erase(unique(elems.begin(), elems.end()), elems.end());
+}
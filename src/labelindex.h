@@ -0,0 +1,44 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <stdint.h>
+
+#include "visualelement.h"
+
+/**
+   An index over the labels of the visual elements for the search box and the
+   selections sent over the socket.
+
+   The unique labels are kept sorted, with the elements that carry each one
+   stored as one flat array.  Exact lookups go through a hash of the labels.
+   Globs are narrowed with the literal text before the first wildcard (a range
+   of the sorted labels) and with the trigrams of every literal run (sorted
+   posting lists that are intersected), and only the survivors are checked
+   with fnmatch.
+ **/
+
+class LabelIndex{
+ public:
+  LabelIndex();
+
+  void build(const VisElemStore & elems);
+  bool is_built() const {return is_built_;}
+
+  //the elements with a label equal to label, in index order
+  void find_exact(const std::string & label, std::vector<int> & elems) const;
+  //the elements with a label matching the fnmatch pattern, in index order
+  void find_glob(const char * pattern, std::vector<int> & elems) const;
+
+ private:
+  void add_slot_elems(uint32_t slot, std::vector<int> & elems) const;
+
+  bool is_built_;
+
+  std::vector<std::string> labels_; //sorted and unique
+  std::unordered_map<std::string, uint32_t> label_slots_;
+  std::vector<uint32_t> elem_start_;
+  std::vector<int> elems_;
+
+  std::unordered_map<uint32_t, std::vector<uint32_t> > trigrams_;
+};
@@ -20,6 +20,7 @@
 #include "visualelement.h"
 #include "genericutils.h"
 #include "configparsing.h"
+#include "scenefile.h"
 #include "shader.h"
 #include "datastreamer.h"
 #include "datavals.h"
@@ -27,6 +28,16 @@
 #include "equation.h"
 #include "simplerender.h"
 #include "logging.h"
+#include "threadpool.h"
+#include "configreload.h"
+#include "controlserver.h"
+#include "fftplans.h"
+#include "spectralengine.h"
+#include "correlation.h"
+#include "histogram.h"
+#include "aggregate.h"
+#include "ranking.h"
+#include "sparklines.h"
 
 #include <list>
 #include <memory>
@@ -34,6 +45,9 @@
 #define SEARCH_STR_LEN 64
 #define MIN_INT -10000
 
+//redraw rate while something is highlighted so the blinking keeps going
+#define HIGHLIGHT_FRAME_TIME 0.05
+
 using namespace std;
 
 
@@ -46,10 +60,29 @@ using namespace std;
 CameraControl * global_camera   = NULL;
 Highlighter * global_highlighter = NULL;
 TwBar * global_info_bar = NULL;
+//set while the histogram panel is shown, so a click on it selects a bin
+ValueHistogram * global_histogram = NULL;
 DataVals * global_data_vals = NULL;
 bool global_mouse_is_handled = false;
 double global_wheel_pos = 0;
 
+//set by any input callback, the main loop only redraws when something changed
+bool global_needs_redraw = true;
+
+//a left drag on the focal plane selects a box, or a lasso with alt held
+#define SELECT_DRAG_MIN_PIXELS 4
+struct SelectDrag{
+  bool is_pressed;
+  bool is_dragging;
+  bool is_lasso;
+  int mod_key;
+  std::vector<glm::vec2> screen_points;
+};
+SelectDrag global_select_drag = {false, false, false, 0, std::vector<glm::vec2>()};
+
+//set by the reload button or when the config file is written
+bool global_reload_config = false;
+
 void TW_CALL toggle_data_vals_pause(void * d){
   int * ps = (int*)d;
   if (global_data_vals != NULL){
@@ -79,6 +112,11 @@ void TW_CALL toggle_plot_scale(void * d){
 
 
 
+void TW_CALL reload_config_callback(void * d){
+  global_reload_config = true;
+}
+
+
 void TW_CALL run_external_command(void * c){
 	char * command = (char *)c;
 	system(command);
@@ -94,7 +132,7 @@ void TW_CALL request_samples_callback(void * dsPointer){
 struct VisibilityInfo{
   int is_visible;
   std::string name;
-  std::vector<VisElemPtr> * visual_elements_ptr;
+  VisElemStore * visual_elements_ptr;
 };
 
 void TW_CALL visiblity_button_callback(void *vis_info){
@@ -103,16 +141,12 @@ void TW_CALL visiblity_button_callback(void *vis_info){
     std::string label_command = std::string("Main/Vis")+vi->name+std::string(" label='Show ")+vi->name+std::string("'");
     TwDefine(label_command.c_str());
     vi->is_visible = 0;
-    for (size_t i=0; i < vi->visual_elements_ptr->size(); i++)
-      if ( vi->visual_elements_ptr->at(i)->get_group() == vi->name)
-	vi->visual_elements_ptr->at(i)->set_not_drawn();
+    vi->visual_elements_ptr->set_group_drawn(vi->name, false);
   } else{
     std::string label_command = std::string("Main/Vis")+vi->name+std::string(" label='Hide ")+vi->name+std::string("'");
     TwDefine(label_command.c_str());
     vi->is_visible = 1;
-    for (size_t i=0; i < vi->visual_elements_ptr->size(); i++)
-      if ( vi->visual_elements_ptr->at(i)->get_group() == vi->name)
-	vi->visual_elements_ptr->at(i)->set_drawn();
+    vi->visual_elements_ptr->set_group_drawn(vi->name, true);
   }
 
   global_highlighter->clear_hls();
@@ -121,11 +155,86 @@ void TW_CALL visiblity_button_callback(void *vis_info){
 
 
 
+//the histogram panel, in the same units as prepare_plotting
+#define HISTOGRAM_PANEL_X -.7f
+#define HISTOGRAM_PANEL_Y -.1f
+#define HISTOGRAM_PANEL_SIZE .3f
+
+//selects the elements of the bin under the click, false if it missed the panel
+bool select_histogram_bin(GLFWwindow* window, glm::vec2 screen_pos, bool add_to_selection){
+  if (global_histogram == NULL) return false;
+  int win_w, win_h;
+  glfwGetWindowSize(window, &win_w, &win_h);
+  float x = 2 * screen_pos.x / win_w - 1;
+  float y = 1 - 2 * screen_pos.y / win_h;
+  if (fabsf(y - HISTOGRAM_PANEL_Y) > HISTOGRAM_PANEL_SIZE) return false;
+  int bin = global_histogram->get_bin_at((x - HISTOGRAM_PANEL_X + HISTOGRAM_PANEL_SIZE) / (2 * HISTOGRAM_PANEL_SIZE));
+  if (bin < 0) return false;
+  std::vector<int> elems;
+  global_histogram->get_elems_in_bin(bin, elems);
+  global_highlighter->select_elems(elems, add_to_selection);
+  return true;
+}
+
+//one button of the ranking bar per place
+#define RANKING_MAX_ROWS 32
+struct RankingRowInfo{
+  ValueRanking * ranking;
+  int row;
+};
+
+void TW_CALL ranking_row_callback(void * row_info){
+  RankingRowInfo * ri = (RankingRowInfo*) row_info;
+  if (global_highlighter == NULL || ri->row >= ri->ranking->get_num()) return;
+  std::vector<int> elems(1, ri->ranking->get_elem(ri->row));
+  global_highlighter->select_elems(elems, false);
+}
+
+void TW_CALL ranking_select_all_callback(void * ranking){
+  if (global_highlighter == NULL) return;
+  std::vector<int> elems;
+  ((ValueRanking*) ranking)->get_elems(elems);
+  global_highlighter->select_elems(elems, false);
+}
+
 static void error_callback(int error, const char* description){
   fputs(description, stderr);
 }
 
+void finish_select_drag(GLFWwindow* window){
+  SelectDrag & sd = global_select_drag;
+  sd.is_pressed = false;
+  if (global_highlighter == NULL || global_camera == NULL || sd.screen_points.size() == 0) return;
+
+  if (!sd.is_dragging){
+    if (select_histogram_bin(window, sd.screen_points[0], sd.mod_key)) return;
+    glm::vec2 pos = global_camera->con_screen_space_to_model_space(sd.screen_points[0]);
+    global_highlighter->parse_click(pos, sd.mod_key);
+    return;
+  }
+  sd.is_dragging = false;
+
+  double xpos, ypos;
+  glfwGetCursorPos(window, &xpos, &ypos);
+  if (sd.is_lasso){
+    std::vector<glm::vec2> outline(sd.screen_points.size());
+    for (size_t i=0; i < sd.screen_points.size(); i++)
+      outline[i] = global_camera->con_screen_space_to_model_space(sd.screen_points[i]);
+    global_highlighter->select_lasso(outline, sd.mod_key);
+  } else {
+    global_highlighter->select_box(global_camera->con_screen_space_to_model_space(sd.screen_points[0]),
+				   global_camera->con_screen_space_to_model_space(glm::vec2(xpos, ypos)),
+				   sd.mod_key);
+  }
+}
+
 inline void TwEventMouseButtonGLFW3(GLFWwindow* window, int button, int action, int mods){
+  global_needs_redraw = true;
+  //a drag that ends over a bar still has to finish
+  if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_RELEASE && global_select_drag.is_pressed){
+    finish_select_drag(window);
+    return;
+  }
   if (TwEventMouseButtonGLFW(button, action)) return;
   if (global_highlighter != NULL && global_camera != NULL){
     if (button == GLFW_MOUSE_BUTTON_1 && action == GLFW_PRESS ){ 
@@ -136,11 +245,15 @@ inline void TwEventMouseButtonGLFW3(GLFWwindow* window, int button, int action,
 			  ( glfwGetKey(window, GLFW_KEY_RIGHT_CONTROL ) == GLFW_PRESS));
       double xpos, ypos;
       glfwGetCursorPos(window, &xpos, &ypos);
-      glm::vec2 pos, pos2;
-      pos.x = xpos;
-      pos.y = ypos;
-      pos2 = global_camera->con_screen_space_to_model_space(pos);
-      global_highlighter->parse_click(pos2, modPressed);
+      //the click is handled on release, once it is known it wasn't a drag
+      SelectDrag & sd = global_select_drag;
+      sd.is_pressed = true;
+      sd.is_dragging = false;
+      sd.is_lasso = ( glfwGetKey(window, GLFW_KEY_LEFT_ALT ) == GLFW_PRESS ||
+		      glfwGetKey(window, GLFW_KEY_RIGHT_ALT ) == GLFW_PRESS );
+      sd.mod_key = modPressed;
+      sd.screen_points.clear();
+      sd.screen_points.push_back(glm::vec2(xpos, ypos));
     } else if (button == GLFW_MOUSE_BUTTON_2){
       double xpos, ypos;
       glfwGetCursorPos ( window, &xpos,&ypos);
@@ -154,6 +267,7 @@ inline void TwEventMouseButtonGLFW3(GLFWwindow* window, int button, int action,
 }
 
 void EventScrollWheel(GLFWwindow * window, double x_offset, double y_offset){
+  global_needs_redraw = true;
   global_wheel_pos+=y_offset;
   if (TwMouseWheel(global_wheel_pos)) return;
 
@@ -164,15 +278,32 @@ void EventScrollWheel(GLFWwindow * window, double x_offset, double y_offset){
 
 
 inline void TwEventMousePosGLFW3(GLFWwindow* window, double xpos, double ypos){
+  global_needs_redraw = true;
   if (global_camera && global_camera->is_mouse_moving()){
     global_camera->register_mouse_move(xpos, ypos);
     return;
   }
 
+  SelectDrag & sd = global_select_drag;
+  if (sd.is_pressed){
+    glm::vec2 pos(xpos, ypos);
+    if (!sd.is_dragging && glm::length(pos - sd.screen_points[0]) > SELECT_DRAG_MIN_PIXELS){
+      sd.is_dragging = true;
+      if (global_highlighter != NULL) global_highlighter->clear_hover();
+    }
+    if (sd.is_dragging && sd.is_lasso) sd.screen_points.push_back(pos);
+    return;
+  }
+
 
   if (TwMouseMotion(int(xpos), int(ypos))){
     global_mouse_is_handled = true;
+    if (global_highlighter != NULL) global_highlighter->clear_hover();
   }else{
+    if (global_highlighter != NULL && global_camera != NULL){
+      glm::vec2 pos = global_camera->con_screen_space_to_model_space(glm::vec2(xpos, ypos));
+      global_highlighter->update_hover(pos, xpos, ypos);
+    }
     TwMouseButton( TW_MOUSE_PRESSED, TW_MOUSE_LEFT);
     TwMouseButton( TW_MOUSE_RELEASED, TW_MOUSE_LEFT);
     global_mouse_is_handled = false;
@@ -181,17 +312,37 @@ inline void TwEventMousePosGLFW3(GLFWwindow* window, double xpos, double ypos){
 
 inline void TwEventMouseWheelGLFW3(GLFWwindow* window, double xoffset, double yoffset){TwEventMouseWheelGLFW(yoffset);}
 inline void TwEventKeyGLFW3(GLFWwindow* window, int key, int scancode, int action, int mods){
+  global_needs_redraw = true;
   if (action == GLFW_REPEAT) action = GLFW_PRESS;
   TwEventKeyGLFW(key, action);
 }
 
-inline void TwEventCharGLFW3(GLFWwindow* window, int codepoint){TwEventCharGLFW(codepoint, GLFW_PRESS);}
+inline void TwEventCharGLFW3(GLFWwindow* window, int codepoint){
+  global_needs_redraw = true;
+  TwEventCharGLFW(codepoint, GLFW_PRESS);
+}
+
+void WindowRefreshCB(GLFWwindow* window){
+  global_needs_redraw = true;
+}
+
+//keys that move the camera for as long as they are held down
+bool camera_keys_down(GLFWwindow* window){
+  const int keys[] = {GLFW_KEY_W, GLFW_KEY_UP, GLFW_KEY_S, GLFW_KEY_DOWN,
+		      GLFW_KEY_A, GLFW_KEY_LEFT, GLFW_KEY_D, GLFW_KEY_RIGHT,
+		      GLFW_KEY_Z, GLFW_KEY_X, GLFW_KEY_F, GLFW_KEY_B};
+  for (size_t i=0; i < sizeof(keys)/sizeof(keys[0]); i++){
+    if (glfwGetKey(window, keys[i]) == GLFW_PRESS) return true;
+  }
+  return false;
+}
 
 
 
 // Callback function called by GLFW when window size changes                                                                                                                                          
 void WindowSizeCB(GLFWwindow* window, int width, int height)
 {
+  global_needs_redraw = true;
   glViewport(0, 0,  width, height);
 
   if (global_camera != NULL){
@@ -204,9 +355,21 @@ int main(int argc, char * args[])
 {
   GetRootLogger()->SetLogLevel(L3LOG_DEBUG);
 
-  int dv_buffer_size = 512;
-
   std::string config_file;
+  if (argc >= 2 && string(args[1]) == "--compile-config"){
+    if (argc != 3){
+      cout<<"Usage: lyrebird --compile-config config_file.json"<<endl;
+      exit(1);
+    }
+    config_file = args[2];
+    if ( !file_exists( config_file )){
+      cout<<"Config file: "<< config_file <<" does not exist"<<endl;
+      exit(1);
+    }
+    compile_config_file(config_file, get_scene_file_path(config_file));
+    return 0;
+  }
+
   if (argc == 1) {
 	  config_file = "lyrebird_config_file.json";
   }else if (argc == 2){
@@ -222,46 +385,50 @@ int main(int argc, char * args[])
   }
   cout<<"Using config file: "<< config_file <<endl;
   
-  //init config file variables
-  int win_x_size;
-  int win_y_size;
-  int sub_sampling;
-  int num_layers;
-  int max_framerate;
+  //every stage of startup is timed and reported once the window is up
+  StageTimer startup_timer;
+  double stage_start = startup_timer.now();
+
+  //parse the config file, or read the compiled version of it
+  config_desc conf;
+  load_config(config_file, conf);
+
+  int win_x_size = conf.win_x_size;
+  int win_y_size = conf.win_y_size;
+  int sub_sampling = conf.sub_sampling;
+  int num_layers = conf.num_layers;
+  int max_framerate = conf.max_framerate;
+  int idle_framerate = conf.idle_framerate;
+  bool vsync = conf.vsync;
+  string geometry_cache_file = conf.geometry_cache_file;
   double frame_time;
-  int max_num_plotted;
-
-  size_t min_max_update_interval;
-
-  vector<vis_elem_repr> vis_elems;
-  vector<string> svg_paths;
-  vector<string> svg_ids;
-
-  vector<string> displayed_eq_labels;
-
-  std::vector<std::string> displayed_global_equations;
-  std::vector<std::string> modifiable_data_vals;
-  //std::vector<std::string> displayed_global_equations;
-
-  std::vector<datastreamer_desc> datastream_descs;
-  std::vector<dataval_desc> dataval_descs;
-  std::vector<equation_desc> eq_descs;
-
-  std::vector<std::string> command_lst;
-  std::vector<std::string> command_label;
-
-  //parse the config file
-  parse_config_file(config_file.c_str(), dataval_descs, datastream_descs, eq_descs, 
-		    vis_elems, svg_paths, svg_ids,
-		    displayed_global_equations, modifiable_data_vals,
-		    command_lst, command_label,
-		    win_x_size, win_y_size, sub_sampling, 
-		    num_layers, max_framerate, max_num_plotted,
-		    dv_buffer_size,
-		    min_max_update_interval,
-		    displayed_eq_labels
-		    );
+  double idle_frame_time;
+  int max_num_plotted = conf.max_num_plotted;
+  int dv_buffer_size = conf.dv_buffer_size;
+
+  size_t min_max_update_interval = conf.min_max_update_interval;
+
+  vector<vis_elem_repr> & vis_elems = conf.vis_elems;
+  vector<string> & svg_paths = conf.svg_paths;
+  vector<string> & svg_ids = conf.svg_ids;
+  vector<grid_layer_desc> & grid_layer_descs = conf.grid_layer_descs;
+
+  vector<string> & displayed_eq_labels = conf.displayed_eq_labels;
+
+  std::vector<std::string> & displayed_global_equations = conf.displayed_global_equations;
+  std::vector<std::string> & modifiable_data_vals = conf.modifiable_data_vals;
+
+  std::vector<datastreamer_desc> & datastream_descs = conf.datastream_descs;
+  std::vector<dataval_desc> & dataval_descs = conf.dataval_descs;
+  std::vector<equation_desc> & eq_descs = conf.equation_descs;
+
+  std::vector<std::string> & command_lst = conf.command_lst;
+  std::vector<std::string> & command_label = conf.command_label;
   log_debug("done parse_config_file");
+  startup_timer.record("parse config", stage_start, startup_timer.now());
+
+  //the cpu only parts of startup run here while the window and gl come up
+  ThreadPool startup_pool(0, &startup_timer);
 
   //create the window
   int width = win_x_size;
@@ -278,6 +445,7 @@ int main(int argc, char * args[])
   DataVals data_vals(dataval_descs.size() + 1, dv_buffer_size);
   vector<std::shared_ptr< DataStreamer> >data_streamers;
 
+  stage_start = startup_timer.now();
   log_debug("creating data_streamers");
   for (size_t i = 0; i < datastream_descs.size(); i++){
 	  std::shared_ptr< DataStreamer> ds_tmp  = NULL;
@@ -286,6 +454,8 @@ int main(int argc, char * args[])
 	  data_streamers.push_back(ds_tmp);
   }
   
+  //room for the spectral data vals of every value added up to here
+  data_vals.register_data_source(SpectralEngine::get_num_derived(conf.spectral_engine, data_vals.get_n_vals()));
   data_vals.initialize();
 
   for (size_t i=0; i < dataval_descs.size(); i++){
@@ -302,6 +472,27 @@ int main(int argc, char * args[])
   for (size_t i=0; i < data_streamers.size(); i++){
     data_streamers[i]->start_recording();
   }
+  startup_timer.record("data streamers", stage_start, startup_timer.now());
+
+  //the spectral data vals have to exist before the equations use them
+  FftPlanCache fft_plans(conf.fft_wisdom_file);
+  SpectralEngine spectral_engine(conf.spectral_engine, &data_vals, &fft_plans,
+				 conf.psd_segment_length, conf.psd_overlap);
+  if (SpectralEngine::is_enabled(conf.spectral_engine)){
+    spectral_engine.add_data_vals();
+    spectral_engine.start();
+  }
+
+  //the equations only need the data vals and the svgs only need their files
+  log_debug("adding equations");
+  EquationMap equation_map(eq_descs.size()+1, &data_vals);
+  equation_map.add_equations(eq_descs, startup_pool);
+
+  //the svgs are tesselated once and shared with the click geometry
+  GeometryCache geo_cache(geometry_cache_file, SVG_TESSELATION_TOL);
+  geo_cache.prefetch(svg_paths, startup_pool);
+
+  stage_start = startup_timer.now();
 
   //now we configure the window
   log_debug("setting up glfw");
@@ -312,6 +503,9 @@ int main(int argc, char * args[])
 
   if (max_framerate <= 0) max_framerate = 60;
   frame_time = 1.0/max_framerate;
+  if (idle_framerate <= 0) idle_framerate = 1;
+  if (idle_framerate > max_framerate) idle_framerate = max_framerate;
+  idle_frame_time = 1.0/idle_framerate;
 
   window = glfwCreateWindow(width, height, "Lyrebird", NULL, NULL);
   if (!window)
@@ -321,6 +515,7 @@ int main(int argc, char * args[])
     }
 
   glfwMakeContextCurrent(window);
+  glfwSwapInterval(vsync ? 1 : 0);
 
   // Initialize GLEW
   glewExperimental = true; // Needed for core profile
@@ -340,31 +535,37 @@ int main(int argc, char * args[])
   glfwSetKeyCallback(window, (GLFWkeyfun)TwEventKeyGLFW3);
   glfwSetCharCallback(window, (GLFWcharfun)TwEventCharGLFW3);
   glfwSetScrollCallback(window, (GLFWscrollfun) EventScrollWheel);
+  glfwSetWindowRefreshCallback(window, (GLFWwindowrefreshfun) WindowRefreshCB);
 
 
   glClearColor( 0.1,0.1,0.1,1.0);
 
   //create the renderer
   SimpleRen sren;
+  startup_timer.record("window and gl", stage_start, startup_timer.now());
+
+  stage_start = startup_timer.now();
+  startup_pool.wait();
+  startup_timer.record("waiting on eqs and svgs", stage_start, startup_timer.now());
+
+  stage_start = startup_timer.now();
   log_debug("loading geometry");
-  //load our geometry
   for (size_t i=0; i < svg_paths.size(); i++){
-   sren.load_svg_file(svg_ids[i], svg_paths[i]);
+   sren.load_svg_file(svg_ids[i], svg_paths[i], geo_cache);
   }
-
-  log_debug("adding equations");  
-  EquationMap equation_map(eq_descs.size()+1, &data_vals);
-  for (size_t i=0; i < eq_descs.size(); i++){
-    equation_map.add_equation(eq_descs[i]);
+  for (size_t i=0; i < grid_layer_descs.size(); i++){
+    sren.add_heatmap_layer(grid_layer_descs[i]);
   }
-  
+  startup_timer.record("upload geometry", stage_start, startup_timer.now());
 
+  stage_start = startup_timer.now();
   log_debug("adding visual elements");  
-  std::vector<VisElemPtr> visual_elements;  
+  VisElemStore visual_elements(&sren, &equation_map);
   for (size_t i=0; i<vis_elems.size(); i++){
-    visual_elements.emplace_back(new VisElem(&sren,  &equation_map, vis_elems[i]));
+    visual_elements.add(vis_elems[i]);
   }
   sren.precalc_ren();
+  startup_timer.record("visual elements", stage_start, startup_timer.now());
 
  
 
@@ -381,25 +582,36 @@ int main(int argc, char * args[])
   
   global_info_bar = info_bar;
 
+  TwBar * hover_bar = TwNewBar("Hover");
+  TwDefine("'Hover' alpha=200 size='200 60' visible=false iconifiable=false movable=false resizable=false");
+
 
   double current_time = glfwGetTime ();
   double last_time = current_time;
   
   //load the click geometry
 
+  stage_start = startup_timer.now();
   log_debug("setting up highlighter");  
   Highlighter highlight(info_bar, &visual_elements, max_num_plotted);
+  highlight.set_hover_bar(hover_bar);
   for (size_t i=0; i < svg_paths.size(); i++){
-    highlight.add_shape_definition(svg_ids[i], svg_paths[i]);
-  }
-
-  for (size_t i=0; i < visual_elements.size(); i++){
-    highlight.add_defined_shape( visual_elements[i]->get_geo_id(), 
-			      visual_elements[i]->get_ms_transform(), 
-			      i,
-			      visual_elements[i]->get_layer()
-			      );
+    highlight.add_shape_definition(svg_ids[i], svg_paths[i], geo_cache);
   }
+  highlight.add_vis_elem_shapes(startup_pool);
+  highlight.build_label_index(startup_pool);
+  startup_timer.record("click geometry", stage_start, startup_timer.now());
+
+  //the cache file is written while the pick polygons are transformed
+  stage_start = startup_timer.now();
+  geo_cache.save();
+  log_debug("tesselated %d svgs, %d came from the geometry cache",
+	    geo_cache.get_num_parsed(), geo_cache.get_num_cached());
+  startup_timer.record("write geometry cache", stage_start, startup_timer.now());
+
+  stage_start = startup_timer.now();
+  startup_pool.wait();
+  startup_timer.record("waiting on pick and label index", stage_start, startup_timer.now());
   global_highlighter = &highlight;
   
   glm::vec2 minAABB, maxAABB;
@@ -415,8 +627,11 @@ int main(int argc, char * args[])
   global_camera = &camera;
   
   log_debug("setting up plotter");  
-  Plotter p = Plotter(dv_buffer_size);
-  PlotBundler plot_bundler( max_num_plotted, dv_buffer_size, &visual_elements);
+  Plotter p(dv_buffer_size);
+  CorrelationMatrix correlation(dv_buffer_size, 0.25);
+  AggregatePlot aggregate_plot(dv_buffer_size, &fft_plans, conf.psd_segment_length, conf.psd_overlap, 0.1);
+  PlotBundler plot_bundler( max_num_plotted, dv_buffer_size, &visual_elements, &fft_plans,
+			    conf.psd_segment_length, conf.psd_overlap, conf.psd_averaging);
 
   //adds the search bar
 
@@ -448,6 +663,30 @@ int main(int argc, char * args[])
 
   int is_paused = 0;  
   int is_fixed_scaled = 0;
+  bool show_spectrogram = false;
+  bool show_coherence = false;
+  bool show_correlation = false;
+  bool show_histogram = false;
+  aggregate_mode aggregate = AGGREGATE_OFF;
+  bool histogram_log_y = false;
+  int histogram_bins = 64;
+  ValueHistogram histogram;
+  std::vector<float> histogram_heights;
+  bool show_ranking = false;
+  bool prev_show_ranking = false;
+  bool ranking_lowest = false;
+  int ranking_k = 10;
+  ValueRanking ranking;
+  bool show_sparklines = false;
+  int sparkline_min_pixels = 48;
+  Sparklines sparklines(0.05);
+  unsigned long sparkline_epoch = (unsigned long) -1;
+  std::vector<int> sparkline_elems;
+  std::vector<glm::vec2> sparkline_mins, sparkline_maxs;
+  unsigned long spectrogram_epoch = 0;
+  unsigned long spectrogram_source = 0;
+  unsigned long spectrogram_samples = 0;
+  float spectrogram_column_time = 0;
 
   float min_plot_val = 0;
   float max_plot_val = 1;
@@ -458,6 +697,37 @@ int main(int argc, char * args[])
 
   TwAddVarRW(main_bar, "Min Plot Val", TW_TYPE_FLOAT, &min_plot_val, "group='Fixed Plot Bounds' step=0.01");
   TwAddVarRW(main_bar, "Max Plot Val", TW_TYPE_FLOAT, &max_plot_val, "group='Fixed Plot Bounds' step=0.01");
+  TwAddVarRW(main_bar, "Spectrogram", TW_TYPE_BOOLCPP, &show_spectrogram, "help='Scrolling spectra of the first plotted element'");
+  TwAddVarRO(main_bar, "Spectrogram Column (s)", TW_TYPE_FLOAT, &spectrogram_column_time,
+	     "help='The stretch of data each spectrogram column stands for'");
+  TwAddVarRW(main_bar, "Coherence", TW_TYPE_BOOLCPP, &show_coherence, "help='Coherence of the other plotted elements with the first'");
+  TwAddVarRW(main_bar, "Correlation", TW_TYPE_BOOLCPP, &show_correlation, "help='Correlation matrix of every highlighted element'");
+  TwType aggregate_type = TwDefineEnumFromString("AggregateMode", "Off,Mean +- Std,Median 10-90");
+  TwAddVarRW(main_bar, "Aggregate", aggregate_type, &aggregate, "help='One trace and spectrum for every highlighted element instead of a line each'");
+  TwAddVarRW(main_bar, "Histogram", TW_TYPE_BOOLCPP, &show_histogram, "help='Displayed equation of every drawn element, click a bar to select its elements'");
+  TwAddVarRW(main_bar, "Histogram Bins", TW_TYPE_INT32, &histogram_bins, "group='Histogram' min=2 max=1024");
+  TwAddVarRW(main_bar, "Histogram Log Y", TW_TYPE_BOOLCPP, &histogram_log_y, "group='Histogram'");
+  TwAddVarRO(main_bar, "Histogram Min", TW_TYPE_FLOAT, histogram.get_min_addr(), "group='Histogram'");
+  TwAddVarRO(main_bar, "Histogram Max", TW_TYPE_FLOAT, histogram.get_max_addr(), "group='Histogram'");
+  TwAddVarRW(main_bar, "Sparklines", TW_TYPE_BOOLCPP, &show_sparklines, "help='Recent history of the color of every element inside its shape, once they are big enough on screen'");
+  TwAddVarRW(main_bar, "Sparkline Min Pixels", TW_TYPE_INT32, &sparkline_min_pixels, "group='Sparklines' min=8 max=1000 help='How wide the typical element has to be on screen to show the lines'");
+  TwAddVarRW(main_bar, "Ranking", TW_TYPE_BOOLCPP, &show_ranking, "help='Drawn elements with the highest values of the displayed equation, click one to select it'");
+  TwAddVarRW(main_bar, "Ranking Size", TW_TYPE_INT32, &ranking_k, "group='Ranking' min=1 max=32");
+  TwAddVarRW(main_bar, "Ranking Lowest", TW_TYPE_BOOLCPP, &ranking_lowest, "group='Ranking' help='Rank the lowest values instead'");
+
+  //the labels are filled in while the ranking is shown
+  TwBar * ranking_bar = TwNewBar("Ranking");
+  TwDefine("'Ranking' alpha=220 position='0 320' size='200 300' visible=false");
+  std::vector<RankingRowInfo> ranking_rows(RANKING_MAX_ROWS);
+  std::vector<std::string> ranking_row_labels(RANKING_MAX_ROWS);
+  TwAddButton(ranking_bar, "rank_all", ranking_select_all_callback, &ranking, "label='Select All'");
+  TwAddSeparator(ranking_bar, "rank_sep", NULL);
+  for (int i=0; i < RANKING_MAX_ROWS; i++){
+    ranking_rows[i].ranking = &ranking;
+    ranking_rows[i].row = i;
+    std::string name = "rank" + std::to_string(i);
+    TwAddButton(ranking_bar, name.c_str(), ranking_row_callback, &ranking_rows[i], "visible=false");
+  }
 
   TwAddSeparator(main_bar, "pasue_sep", NULL);
 
@@ -500,6 +770,7 @@ int main(int argc, char * args[])
 
 
   TwAddSeparator(main_bar, "command_sep", NULL);
+  TwAddButton(main_bar, "Reload Config", reload_config_callback, NULL, NULL);
 
   //char test_command[] = "echo hello";
   //TwAddButton(main_bar, "Run", run_external_command, test_command, NULL);
@@ -533,11 +804,7 @@ int main(int argc, char * args[])
 
   TwAddSeparator(main_bar, "vis_sep", NULL);
   /// Code for setting things visible
-  std::unordered_set<std::string> visual_element_groups;
-  for (size_t i=0; i < visual_elements.size(); i++){
-    std::string vgroup = visual_elements[i]->get_group();
-    visual_element_groups.insert(vgroup);
-  }  
+  std::vector<std::string> visual_element_groups = visual_elements.get_groups();
   std::vector<VisibilityInfo> vis_info;  
   for (auto it=visual_element_groups.begin(); it!= visual_element_groups.end(); it++){
     VisibilityInfo vi;
@@ -553,25 +820,64 @@ int main(int argc, char * args[])
 		&(vis_info[visibility_index]), (std::string("label='Hide ") + (*it) + std::string("'")).c_str());
     visibility_index++;
   }
-  size_t min_max_loop_index;
+  size_t min_max_loop_index = 0;
   size_t color_update_freq = 300;
+  unsigned long last_data_epoch = 0;
+  ConfigWatcher config_watcher(config_file);
+  ControlServer control_server(conf.control_socket, glfwPostEmptyEvent);
   log_debug("starting loop");
   //actual loop//
+  startup_timer.report();
+
   while (!glfwWindowShouldClose(window)) {
+	  if (config_watcher.has_changed()) global_reload_config = true;
+	  if (global_reload_config){
+		  global_reload_config = false;
+		  //the reload changes equations the aggregate worker may be evaluating
+		  aggregate_plot.wait_idle();
+		  if (reload_config(config_file, conf, &data_vals, equation_map, sren, geo_cache,
+				    visual_elements, highlight, displayed_eq, startup_pool)){
+			  //rebuilt elements come back drawn, hidden groups stay hidden
+			  for (size_t i=0; i < vis_info.size(); i++){
+				  if (!vis_info[i].is_visible)
+					  visual_elements.set_group_drawn(vis_info[i].name, false);
+			  }
+		  }
+		  global_needs_redraw = true;
+	  }
+
+	  if (control_server.process(highlight, visual_elements, displayed_eq,
+				     displayed_eq_labels, glfwGetTime()))
+		  global_needs_redraw = true;
+
+	  //only redraw if the data, the input or an animation changed something,
+	  //otherwise block until there are events or it is time to check again
+	  unsigned long data_epoch = data_vals.get_epoch();
+	  double since_last_draw = glfwGetTime() - last_time;
+	  double redraw_interval = idle_frame_time;
+	  if (highlight.has_highlights() && redraw_interval > HIGHLIGHT_FRAME_TIME)
+		  redraw_interval = HIGHLIGHT_FRAME_TIME;
+	  
+	  if (!global_needs_redraw && data_epoch == last_data_epoch &&
+	      since_last_draw < redraw_interval && !camera_keys_down(window) &&
+	      !control_server.has_commands()){
+		  double wait_time = redraw_interval - since_last_draw;
+		  glfwWaitEventsTimeout(wait_time < frame_time ? wait_time : frame_time);
+		  continue;
+	  }
+	  global_needs_redraw = false;
+	  last_data_epoch = data_epoch;
+
 	  min_max_loop_index++;
 	  min_max_loop_index = min_max_loop_index % color_update_freq;
 
 	  glClear(GL_COLOR_BUFFER_BIT);
 	  glClear(GL_DEPTH_BUFFER_BIT);
 	  
-	  usleep(10);
-	  
 	  //update the equations if possible
 	  if (prev_eq_val != displayed_eq) {
 		  prev_eq_val = displayed_eq;
-		  for (size_t i=0; i < visual_elements.size(); i++){
-			  visual_elements[i]->set_eq_ind( prev_eq_val );
-		  }
+		  visual_elements.set_eq_ind( prev_eq_val );
 		  strncpy(displayed_name, 
 			  displayed_eq_labels[prev_eq_val].c_str(), 
 			  display_buffer_size); 
@@ -579,7 +885,6 @@ int main(int argc, char * args[])
 	  
 	  //other things
 	  
-	  highlight.check_socket();
 	  for (int i = 0; i<num_data_sources; i++){
 		  if ( ds_index_variables[i] != ds_index_variables_prev_state[i]){
 			  data_streamers[i]->request_values(ds_index_variables[i]);
@@ -590,14 +895,62 @@ int main(int argc, char * args[])
 		  ds_index_variables_prev_state[i] = ds_index_variables[i];
 	  }
 
-	  for (size_t i=0; i < visual_elements.size(); i++) {
-		  size_t not_updated = !(min_max_loop_index == 
-					 ((i*color_update_freq)/visual_elements.size()));
-		  visual_elements[i]->update_color(not_updated);
+	  //the histogram is filled by the color pass
+	  histogram.set_num_bins(histogram_bins);
+	  visual_elements.set_histogram(show_histogram ? &histogram : NULL);
+	  ranking.set_k(ranking_k);
+	  ranking.set_lowest(ranking_lowest);
+	  visual_elements.set_ranking(show_ranking ? &ranking : NULL);
+	  //the boxes only change with the drawn elements, the lines only show zoomed in
+	  if (show_sparklines && visual_elements.get_drawn_epoch() != sparkline_epoch){
+		  sparkline_epoch = visual_elements.get_drawn_epoch();
+		  highlight.get_drawn_boxes(sparkline_elems, sparkline_mins, sparkline_maxs);
+		  sparklines.set_boxes(sparkline_elems, sparkline_mins, sparkline_maxs);
 	  }
+	  bool sparklines_shown = show_sparklines &&
+		  sparklines.get_typical_width() * camera.get_pixels_per_unit() >= sparkline_min_pixels;
+	  if (sparklines_shown) sparklines.start_frame(glfwGetTime());
+	  visual_elements.set_sparklines(sparklines_shown ? &sparklines : NULL);
+	  global_histogram = show_histogram ? &histogram : NULL;
+	  visual_elements.update_colors(min_max_loop_index, color_update_freq);
 	  
 	  sren.draw_ren_states(camera.get_view_mat());
+	  if (sparklines_shown) sparklines.draw(camera.get_view_mat(), glm::vec4(0.0, 0.0, 0.0, 1.0));
+
+	  //outline of a box or lasso selection in progress
+	  if (global_select_drag.is_dragging){
+		  int win_w, win_h;
+		  double xpos, ypos;
+		  glfwGetWindowSize(window, &win_w, &win_h);
+		  glfwGetCursorPos(window, &xpos, &ypos);
+		  std::vector<glm::vec2> outline;
+		  const std::vector<glm::vec2> & sp = global_select_drag.screen_points;
+		  if (global_select_drag.is_lasso){
+			  outline = sp;
+		  } else {
+			  outline.push_back(sp[0]);
+			  outline.push_back(glm::vec2(xpos, sp[0].y));
+			  outline.push_back(glm::vec2(xpos, ypos));
+			  outline.push_back(glm::vec2(sp[0].x, ypos));
+		  }
+		  for (size_t i=0; i < outline.size(); i++){
+			  outline[i] = glm::vec2(2 * outline[i].x / win_w - 1, 1 - 2 * outline[i].y / win_h);
+		  }
+		  p.prepare_plotting(glm::vec2(0, 0), glm::vec2(1, 1));
+		  p.draw_outline(outline, glm::vec4(1.0, 1.0, 1.0, 1.0));
+		  p.cleanup_plotting();
+	  }
 	  
+	  if (show_histogram){
+		  histogram.get_heights(histogram_log_y, histogram_heights);
+		  p.prepare_plotting(glm::vec2(HISTOGRAM_PANEL_X, HISTOGRAM_PANEL_Y),
+				     glm::vec2(HISTOGRAM_PANEL_SIZE, HISTOGRAM_PANEL_SIZE));
+		  p.plotBG(glm::vec4(0.0,0.0,0.0,0.9));
+		  p.plot_bars(&histogram_heights[0], histogram_heights.size(), glm::vec4(0.4,0.7,1.0,1.0));
+		  p.plotFG(glm::vec4(1.0,1.0,1.0,1.0));
+		  p.cleanup_plotting();
+	  }
+
 	  //handles the plotting
 	  
 	  list<int> plot_inds = highlight.get_plot_inds();
@@ -606,22 +959,44 @@ int main(int argc, char * args[])
 	  if (plot_inds.size() > 0){
 		  plot_bundler.update_plots(plot_inds, color_inds);
 		  int num_plots = plot_bundler.get_num_plots();
+		  int plot_win_w, plot_win_h;
+		  glfwGetWindowSize(window, &plot_win_w, &plot_win_h);
+		  p.set_viewport_width(plot_win_w);
 		  
+		  //every highlighted element, not just the plotted ones
+		  if (aggregate != AGGREGATE_OFF) aggregate_plot.update(&visual_elements, plot_inds, aggregate, glfwGetTime());
+
 		  p.prepare_plotting(glm::vec2(.7, -.7), glm::vec2(.3,.3));
 		  p.plotBG(glm::vec4(0.0,0.0,0.0,0.9));
-		  for (int i=num_plots-1; i >= 0; i--){
-			  glm::vec3 plotColor;
+		  if (aggregate != AGGREGATE_OFF){
+			  float * center, * lower, * upper;
 			  float minp,maxp;
-			  float * plotVals = plot_bundler.get_plot(i, plotColor);
-			  plot_bundler.get_plot_min_max(minp, maxp);
-			  
+			  aggregate_plot.get_plot(center, lower, upper);
+			  aggregate_plot.get_plot_min_max(minp, maxp);
 			  if (is_fixed_scaled) {
-				  minp = min_plot_val; 
+				  minp = min_plot_val;
 				  maxp = max_plot_val;
 			  }
-			  
-			  p.plot(plotVals, dv_buffer_size, minp, maxp, glm::vec4(plotColor,1), 0,
-				 1,1 );
+			  //the line goes first so the band doesn't cover it
+			  p.plot(center, dv_buffer_size, minp, maxp, glm::vec4(1.0,1.0,1.0,1.0), 0, 1, 1);
+			  p.plot_band(lower, upper, dv_buffer_size, minp, maxp, glm::vec4(0.3,0.5,0.8,1.0), 0);
+		  } else {
+			  for (int i=num_plots-1; i >= 0; i--){
+				  glm::vec3 plotColor;
+				  float minp,maxp;
+				  float * plotVals = plot_bundler.get_plot(i, plotColor);
+				  plot_bundler.get_plot_min_max(minp, maxp);
+
+				  if (is_fixed_scaled) {
+					  minp = min_plot_val;
+					  maxp = max_plot_val;
+				  }
+
+				  unsigned long plot_source, plot_samples;
+				  plot_bundler.get_plot_samples(i, plot_source, plot_samples);
+				  p.plot_history(i, plot_source, plot_samples, plotVals, dv_buffer_size, minp, maxp,
+						 glm::vec4(plotColor,1));
+			  }
 		  }
 		  p.plotFG(glm::vec4(1.0,1.0,1.0,1.0)); 
 		  
@@ -631,18 +1006,109 @@ int main(int argc, char * args[])
 		  float psd_0point;
 		  float psd_sep;
 		  plot_bundler.get_psd_start_and_sep(psd_0point, psd_sep);
-		  for (int i=num_plots-1; i >= 0; i--){
-			  glm::vec3 plotColor;
+		  if (aggregate != AGGREGATE_OFF){
+			  float * center, * lower, * upper;
 			  float minp,maxp;
-			  float * plotVals = plot_bundler.get_psd(i, plotColor);
-			  plot_bundler.get_psd_min_max(minp, maxp);
-			  p.plot(plotVals, dv_buffer_size/2+1, minp, maxp, glm::vec4(plotColor,1), 1,
-				 psd_sep, psd_sep);
+			  float agg_0point, agg_sep;
+			  aggregate_plot.get_psd(center, lower, upper);
+			  aggregate_plot.get_psd_min_max(minp, maxp);
+			  aggregate_plot.get_psd_start_and_sep(agg_0point, agg_sep);
+			  int n_bins = aggregate_plot.get_psd_buffer_size();
+			  p.plot(center, n_bins, minp, maxp, glm::vec4(1.0,1.0,1.0,1.0), 1, agg_0point, agg_sep);
+			  p.plot_band(lower, upper, n_bins, minp, maxp, glm::vec4(0.3,0.5,0.8,1.0), 1);
+		  } else {
+			  for (int i=num_plots-1; i >= 0; i--){
+				  glm::vec3 plotColor;
+				  float minp,maxp;
+				  float * plotVals = plot_bundler.get_psd(i, plotColor);
+				  plot_bundler.get_psd_min_max(minp, maxp);
+				  p.plot(plotVals, plot_bundler.get_psd_buffer_size(), minp, maxp, glm::vec4(plotColor,1), 1,
+					 psd_0point, psd_sep);
+			  }
 		  }
 		  //p.plotFG(glm::vec4(1.0,1.0,1.0,1.0)); 
+
+		  //a column for every segment length of new samples of the first element,
+		  //so time runs with the data and not with the frame rate
+		  if (plot_bundler.get_psd_epoch() != spectrogram_epoch && num_plots > 0){
+			  spectrogram_epoch = plot_bundler.get_psd_epoch();
+			  unsigned long source, n_samples;
+			  plot_bundler.get_plot_samples(0, source, n_samples);
+			  unsigned long hop = plot_bundler.get_psd_segment_length();
+			  unsigned long n_columns = 0;
+			  if (source != spectrogram_source || n_samples < spectrogram_samples){
+				  spectrogram_source = source;
+				  spectrogram_samples = n_samples;
+				  n_columns = 1;
+			  } else {
+				  n_columns = (n_samples - spectrogram_samples) / hop;
+				  spectrogram_samples += n_columns * hop;
+			  }
+			  //spectra that come in late stand for every segment they missed
+			  n_columns = std::min(n_columns, (unsigned long)SPECTROGRAM_COLUMNS);
+			  glm::vec3 plotColor;
+			  for (unsigned long c=0; c < n_columns; c++){
+				  p.add_spectrogram_column(plot_bundler.get_plot_element(0), plot_bundler.get_psd(0, plotColor),
+							   plot_bundler.get_psd_buffer_size());
+			  }
+			  //the bin spacing is sample_rate / segment_length
+			  if (psd_sep > 0) spectrogram_column_time = 1.0f / psd_sep;
+		  }
+		  if (show_coherence && num_plots > 1){
+			  p.prepare_plotting(glm::vec2(.1, -.1), glm::vec2(.3,.3));
+			  p.plotBG(glm::vec4(0.0,0.0,0.0,0.9));
+			  for (int i=num_plots-1; i >= 1; i--){
+				  glm::vec3 plotColor;
+				  float * plotVals = plot_bundler.get_coherence(i, plotColor);
+				  p.plot(plotVals, plot_bundler.get_psd_buffer_size(), 0, 1, glm::vec4(plotColor,1), 1,
+					 psd_0point, psd_sep);
+			  }
+		  }
+		  if (show_correlation){
+			  //every highlighted element, not just the plotted ones
+			  if (correlation.update(&visual_elements, plot_inds, glfwGetTime())){
+				  int n_corr;
+				  const float * corr = correlation.get_matrix(n_corr);
+				  p.set_matrix(corr, n_corr);
+			  }
+			  p.prepare_plotting(glm::vec2(-.7, -.7), glm::vec2(.3,.3));
+			  p.plotBG(glm::vec4(0.0,0.0,0.0,0.9));
+			  p.plot_matrix();
+			  p.plotFG(glm::vec4(1.0,1.0,1.0,1.0));
+		  }
+		  if (show_spectrogram){
+			  p.prepare_plotting(glm::vec2(.1, -.7), glm::vec2(.3,.3));
+			  p.plotBG(glm::vec4(0.0,0.0,0.0,0.9));
+			  p.plot_spectrogram();
+			  p.plotFG(glm::vec4(1.0,1.0,1.0,1.0));
+		  }
 		  p.cleanup_plotting();
 	  }
 	  
+	  if (show_ranking != prev_show_ranking){
+		  int visible = show_ranking;
+		  TwSetParam(ranking_bar, NULL, "visible", TW_PARAM_INT32, 1, &visible);
+		  prev_show_ranking = show_ranking;
+	  }
+	  if (show_ranking){
+		  //only the rows whose text changed are touched
+		  for (int i=0; i < RANKING_MAX_ROWS; i++){
+			  std::string label;
+			  if (i < ranking.get_num()){
+				  int elem = ranking.get_elem(i);
+				  char val_str[32];
+				  snprintf(val_str, sizeof(val_str), "%g  ", ranking.get_value(i));
+				  label = std::string(val_str) + visual_elements.get_label(elem, 0);
+			  }
+			  if (label == ranking_row_labels[i]) continue;
+			  std::string name = "rank" + std::to_string(i);
+			  int visible = !label.empty();
+			  TwSetParam(ranking_bar, name.c_str(), "visible", TW_PARAM_INT32, 1, &visible);
+			  if (visible) TwSetParam(ranking_bar, name.c_str(), "label", TW_PARAM_CSTRING, 1, label.c_str());
+			  ranking_row_labels[i] = label;
+		  }
+	  }
+
 	  //updates the info bar
 	  highlight.update_info_bar();
 	  
@@ -663,40 +1129,43 @@ int main(int argc, char * args[])
 	  double delta_time = current_time-last_time;
 	  
 	  
-	  // code for doing frame limitting
-	  if (delta_time < frame_time)
+	  // code for doing frame limitting, vsync already paces the swap
+	  if (!vsync && delta_time < frame_time)
 		  usleep( (frame_time - delta_time) * 1e6);
 	  current_time = glfwGetTime();
 	  delta_time = current_time-last_time;
 	  
 	  last_time = current_time;
+
+	  //after sitting idle the first frame would make the camera jump
+	  double move_time = delta_time < 2 * frame_time ? delta_time : frame_time;
 	  
 	  if (!global_mouse_is_handled){
 		  if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS ||
 		      glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS 
 			  ){
-			  camera.move_up(delta_time*2);
+			  camera.move_up(move_time*2);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_S) == GLFW_PRESS ||
 		      glfwGetKey(window, GLFW_KEY_DOWN) == GLFW_PRESS
 			  ){
-			  camera.move_down(delta_time*2);
+			  camera.move_down(move_time*2);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_A) == GLFW_PRESS ||
 		      glfwGetKey(window, GLFW_KEY_LEFT) == GLFW_PRESS	    
 			  ){
-			  camera.move_left(delta_time*2);
+			  camera.move_left(move_time*2);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_D) == GLFW_PRESS ||
 		      glfwGetKey(window, GLFW_KEY_RIGHT) == GLFW_PRESS 
 			  ){
-			  camera.move_right(delta_time*2);
+			  camera.move_right(move_time*2);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_Z) == GLFW_PRESS){
-			  camera.zoom(-1*delta_time);
+			  camera.zoom(-1*move_time);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_X) == GLFW_PRESS){
-			  camera.zoom(1*delta_time);
+			  camera.zoom(1*move_time);
 		  }
 		  if (glfwGetKey(window, GLFW_KEY_F) == GLFW_PRESS){ //scroll forward in history if we have that type of data streamer
 			  for (int i=0; i < num_data_sources; i++){ 
@@ -717,8 +1186,7 @@ int main(int argc, char * args[])
 	  }
 	  
 	  //animates the highlighting
-	  for (size_t i=0; i < visual_elements.size(); i++)
-		  visual_elements[i]->animate_highlight(delta_time);
+	  visual_elements.animate_highlights(delta_time);
 	  
 	  
 	  
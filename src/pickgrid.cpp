@@ -0,0 +1,115 @@
+#include "pickgrid.h"
+
+#include <math.h>
+#include <algorithm>
+
+using namespace std;
+
+#define PICK_GRID_MAX_DIM 1024
+
+PickGrid::PickGrid() : is_built_(false), n_x_(0), n_y_(0){}
+
+void PickGrid::clear(){
+  is_built_ = false;
+  n_x_ = 0;
+  n_y_ = 0;
+  cell_start_.clear();
+  cell_boxes_.clear();
+  box_min_.clear();
+  box_max_.clear();
+}
+
+int PickGrid::cell_x(float x) const{
+  int cx = floor((x - origin_.x) * inv_cell_size_.x);
+  return cx < 0 ? 0 : (cx >= n_x_ ? n_x_ - 1 : cx);
+}
+
+int PickGrid::cell_y(float y) const{
+  int cy = floor((y - origin_.y) * inv_cell_size_.y);
+  return cy < 0 ? 0 : (cy >= n_y_ ? n_y_ - 1 : cy);
+}
+
+void PickGrid::build(const std::vector<glm::vec2> & box_min, const std::vector<glm::vec2> & box_max,
+		     const std::vector<int> & layers){
+  clear();
+  is_built_ = true;
+  if (box_min.size() == 0) return;
+
+  size_t n = box_min.size();
+  box_min_ = box_min;
+  box_max_ = box_max;
+  glm::vec2 min_p = box_min_[0];
+  glm::vec2 max_p = box_max_[0];
+  for (size_t i=1; i < n; i++){
+    min_p = glm::min(min_p, box_min_[i]);
+    max_p = glm::max(max_p, box_max_[i]);
+  }
+
+  //about one cell per box with the aspect ratio of the scene
+  glm::vec2 extent = max_p - min_p;
+  if (extent.x <= 0) extent.x = 1;
+  if (extent.y <= 0) extent.y = 1;
+  n_x_ = ceil(sqrt(n * extent.x / extent.y));
+  n_x_ = n_x_ < 1 ? 1 : (n_x_ > PICK_GRID_MAX_DIM ? PICK_GRID_MAX_DIM : n_x_);
+  n_y_ = (n + n_x_ - 1) / n_x_;
+  n_y_ = n_y_ < 1 ? 1 : (n_y_ > PICK_GRID_MAX_DIM ? PICK_GRID_MAX_DIM : n_y_);
+  origin_ = min_p;
+  inv_cell_size_ = glm::vec2(n_x_ / extent.x, n_y_ / extent.y);
+
+  //counting pass then filling pass so the cells end up in one array
+  cell_start_ = vector<uint32_t>(n_x_ * n_y_ + 1, 0);
+  for (size_t i=0; i < n; i++){
+    int x0 = cell_x(box_min_[i].x), x1 = cell_x(box_max_[i].x);
+    int y0 = cell_y(box_min_[i].y), y1 = cell_y(box_max_[i].y);
+    for (int y=y0; y <= y1; y++)
+      for (int x=x0; x <= x1; x++)
+	cell_start_[y * n_x_ + x + 1]++;
+  }
+  for (size_t c=1; c < cell_start_.size(); c++) cell_start_[c] += cell_start_[c-1];
+
+  cell_boxes_.resize(cell_start_.back());
+  vector<uint32_t> fill(cell_start_.begin(), cell_start_.end() - 1);
+  for (size_t i=0; i < n; i++){
+    int x0 = cell_x(box_min_[i].x), x1 = cell_x(box_max_[i].x);
+    int y0 = cell_y(box_min_[i].y), y1 = cell_y(box_max_[i].y);
+    for (int y=y0; y <= y1; y++)
+      for (int x=x0; x <= x1; x++)
+	cell_boxes_[fill[y * n_x_ + x]++] = i;
+  }
+
+  //the boxes went in by index, a stable sort keeps that order within a layer
+  for (size_t c=0; c + 1 < cell_start_.size(); c++){
+    stable_sort(cell_boxes_.begin() + cell_start_[c], cell_boxes_.begin() + cell_start_[c+1],
+		[&layers](uint32_t a, uint32_t b){ return layers[a] > layers[b]; });
+  }
+}
+
+void PickGrid::get_candidates(glm::vec2 p, const uint32_t *& begin, const uint32_t *& end) const{
+  begin = end = NULL;
+  if (n_x_ == 0) return;
+  glm::vec2 cp = (p - origin_) * inv_cell_size_;
+  if (cp.x < 0 || cp.y < 0 || cp.x > n_x_ || cp.y > n_y_) return;
+  int c = cell_y(p.y) * n_x_ + cell_x(p.x);
+  begin = cell_boxes_.data() + cell_start_[c];
+  end = cell_boxes_.data() + cell_start_[c+1];
+}
+
+void PickGrid::query_box(glm::vec2 min_p, glm::vec2 max_p, std::vector<uint32_t> & out) const{
+  out.clear();
+  if (n_x_ == 0) return;
+  int x0 = cell_x(min_p.x), x1 = cell_x(max_p.x);
+  int y0 = cell_y(min_p.y), y1 = cell_y(max_p.y);
+  for (int y=y0; y <= y1; y++){
+    for (int x=x0; x <= x1; x++){
+      int c = y * n_x_ + x;
+      for (uint32_t k=cell_start_[c]; k < cell_start_[c+1]; k++){
+	uint32_t i = cell_boxes_[k];
+	if (box_max_[i].x < min_p.x || box_min_[i].x > max_p.x ||
+	    box_max_[i].y < min_p.y || box_min_[i].y > max_p.y) continue;
+	out.push_back(i);
+      }
+    }
+  }
+  sort(out.begin(), out.end());
+  out.erase(unique(out.begin(), out.end()), out.end());
+}
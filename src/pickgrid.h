@@ -0,0 +1,49 @@
+#pragma once
+#include <vector>
+#include <stdint.h>
+
+#include "glm/glm.hpp"
+
+/**
+   A uniform grid over the bounding boxes of the placed pick shapes.
+
+   Every cell lists the boxes that overlap it, sorted by layer from front to
+   back, so a point query walks one short list and can stop at the first shape
+   that contains the point.  The cells are stored as one flat index array with
+   an offset per cell.
+
+   The grid has about one cell per box, boxes that overlap many cells are
+   listed in each of them.
+ **/
+
+class PickGrid{
+ public:
+  PickGrid();
+
+  //the boxes and layers are indexed the same way, the grid stores those indices
+  void build(const std::vector<glm::vec2> & box_min, const std::vector<glm::vec2> & box_max,
+	     const std::vector<int> & layers);
+  void clear();
+  bool is_built() const {return is_built_;}
+
+  //the boxes listed in the cell under p, front layer first, ties in index order
+  void get_candidates(glm::vec2 p, const uint32_t *& begin, const uint32_t *& end) const;
+
+  //every box that overlaps the query box, each listed once in index order
+  void query_box(glm::vec2 min_p, glm::vec2 max_p, std::vector<uint32_t> & out) const;
+
+ private:
+  int cell_x(float x) const;
+  int cell_y(float y) const;
+
+  bool is_built_;
+  glm::vec2 origin_;
+  glm::vec2 inv_cell_size_;
+  int n_x_;
+  int n_y_;
+
+  std::vector<uint32_t> cell_start_;
+  std::vector<uint32_t> cell_boxes_;
+  std::vector<glm::vec2> box_min_;
+  std::vector<glm::vec2> box_max_;
+};
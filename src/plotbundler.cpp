@@ -2,6 +2,7 @@
 #include <assert.h>
 #include <iostream>
 #include <math.h>
+#include <algorithm>
 
 using namespace std;
 
@@ -10,44 +11,61 @@ void PlotBundler::get_psd_start_and_sep(float & start, float & sep) {
 	if (num_plots == 0) {
 		start = 0;
 		sep = 0;
+		return;
 	}
 	float sample_rate = sample_rate_buffer[0];
-	sep = sample_rate / buffer_size_;
+	sep = sample_rate / welch_.get_segment_length();
 	start = 0;
 }
 
 
-PlotBundler::PlotBundler(int max_num_plots, int buffer_size,  std::vector<VisElemPtr> * vis_elems){
+PlotBundler::PlotBundler(int max_num_plots, int buffer_size,  VisElemStore * vis_elems, FftPlanCache * fft_plans,
+			 int psd_segment_length, float psd_overlap, float psd_averaging)
+  : welch_(fft_plans, buffer_size,
+	   psd_segment_length > 0 ? psd_segment_length : buffer_size / 4,
+	   psd_overlap, max_num_plots){
   max_num_plots_ = max_num_plots;
   buffer_size_ = buffer_size;
   vis_elems_ = vis_elems;
+  psd_averaging_ = psd_averaging;
 
-  psd_buffer_size = buffer_size_/2+1;
+  psd_buffer_size = welch_.get_num_bins();
 
   plot_vals = new float[max_num_plots_*buffer_size_];
   color_vals = new glm::vec3[max_num_plots_];
-  last_updated = new int[max_num_plots_];
   previousVEInds = new int[max_num_plots_];
+  plot_eqs_ = vector<Equation*>(max_num_plots_, (Equation*)NULL);
+  plot_sources_ = vector<unsigned long>(max_num_plots_, 0);
+  plot_samples_ = vector<unsigned long>(max_num_plots_, 0);
+  //0 is never a source so an unused plotter slot always starts over
+  next_source_ = 1;
 
   psd_vals = new float[max_num_plots_*psd_buffer_size];
-  fft_out = fftw_alloc_complex(psd_buffer_size); 
-  psd_tmp_buffer = fftw_alloc_real(buffer_size_);
-  psd_hann_buffer = new double[buffer_size_];
+  coh_vals = new float[max_num_plots_*psd_buffer_size];
 
   sample_rate_buffer = new float[max_num_plots_];
 
   num_plots = 0;
   for (int i=0; i < max_num_plots_; i++){
     previousVEInds[i] = -1;
-    last_updated[i] = -1;
   }
+  for (int i=0; i < max_num_plots_*psd_buffer_size; i++) psd_vals[i] = 0;
+  for (int i=0; i < max_num_plots_*psd_buffer_size; i++) coh_vals[i] = 0;
 
-  fft_plan = fftw_plan_dft_r2c_1d(buffer_size_, psd_tmp_buffer, fft_out,FFTW_ESTIMATE);
-  //fft_plan = ffts_init_1d_real(buffer_size_, 1);
-
-  for (int i=0; i < buffer_size_; i++){
-    psd_hann_buffer[i] = 0.5 * (1.0 - cosf( (2 * 3.14159 * i)/((float) buffer_size_  - 1.0f )));
-  }
+  psd_in_ = new float[max_num_plots_*buffer_size_];
+  psd_sample_rates_ = new float[max_num_plots_];
+  psd_power_ = new float[max_num_plots_*psd_buffer_size];
+  psd_result_ = new float[max_num_plots_*psd_buffer_size];
+  psd_avg_ = new float[max_num_plots_*psd_buffer_size];
+  psd_csd_ = new float[2*psd_buffer_size];
+  psd_csd_avg_ = new float[2*max_num_plots_*psd_buffer_size];
+  psd_coh_result_ = new float[max_num_plots_*psd_buffer_size];
+  psd_is_queued_ = false;
+  psd_is_running_ = false;
+  psd_has_result_ = false;
+  psd_is_stopping_ = false;
+  psd_epoch_ = 0;
+  psd_thread_ = std::thread(&PlotBundler::psd_loop, this);
 }
 
 int PlotBundler::get_psd_buffer_size(){
@@ -55,18 +73,29 @@ int PlotBundler::get_psd_buffer_size(){
 }
 
 PlotBundler::~PlotBundler(){
+  {
+    std::lock_guard<std::mutex> lock(psd_mutex_);
+    psd_is_stopping_ = true;
+  }
+  psd_cv_.notify_all();
+  psd_thread_.join();
+
   delete [] plot_vals;
   delete [] psd_vals;
+  delete [] coh_vals;
   delete [] color_vals;
-  delete [] last_updated;
   delete [] previousVEInds;
-  delete [] psd_hann_buffer;
 
   delete [] sample_rate_buffer;
 
-  fftw_free(psd_tmp_buffer);
-  fftw_free(fft_out);
-  fftw_destroy_plan(fft_plan);
+  delete [] psd_in_;
+  delete [] psd_sample_rates_;
+  delete [] psd_power_;
+  delete [] psd_result_;
+  delete [] psd_avg_;
+  delete [] psd_csd_;
+  delete [] psd_csd_avg_;
+  delete [] psd_coh_result_;
 }
 
 
@@ -74,6 +103,84 @@ int PlotBundler::get_num_plots(){
   return num_plots;
 }
 
+void PlotBundler::psd_loop(){
+  while (true){
+    int n_plots;
+    {
+      std::unique_lock<std::mutex> lock(psd_mutex_);
+      psd_cv_.wait(lock, [this]{return psd_is_queued_ || psd_is_stopping_;});
+      if (psd_is_stopping_) return;
+      psd_is_queued_ = false;
+      psd_is_running_ = true;
+      n_plots = psd_job_inds_.size();
+    }
+
+    welch_.compute(psd_in_, n_plots, psd_sample_rates_, psd_power_);
+
+    //a slot keeps averaging while it shows the same element
+    psd_avg_inds_.resize(n_plots, -1);
+    for (int i=0; i < n_plots; i++){
+      float * power = psd_power_ + i * psd_buffer_size;
+      float * avg = psd_avg_ + i * psd_buffer_size;
+      float * asd = psd_result_ + i * psd_buffer_size;
+      if (psd_avg_inds_[i] != psd_job_inds_[i]){
+	psd_avg_inds_[i] = psd_job_inds_[i];
+	std::copy(power, power + psd_buffer_size, avg);
+      } else {
+	for (int j=0; j < psd_buffer_size; j++) avg[j] += psd_averaging_ * (power[j] - avg[j]);
+      }
+      for (int j=0; j < psd_buffer_size; j++) asd[j] = sqrtf(avg[j]);
+    }
+
+    //plot 0 against each of the others, one multiply accumulate per bin and segment
+    psd_csd_avg_inds_.resize(n_plots, std::make_pair(-1, -1));
+    for (int i=1; i < n_plots; i++){
+      float * avg = psd_csd_avg_ + 2 * i * psd_buffer_size;
+      float * coh = psd_coh_result_ + i * psd_buffer_size;
+      welch_.cross(0, i, psd_sample_rates_[0], psd_csd_);
+      std::pair<int, int> pair_inds(psd_job_inds_[0], psd_job_inds_[i]);
+      if (psd_csd_avg_inds_[i] != pair_inds){
+	psd_csd_avg_inds_[i] = pair_inds;
+	std::copy(psd_csd_, psd_csd_ + 2 * psd_buffer_size, avg);
+      } else {
+	for (int j=0; j < 2 * psd_buffer_size; j++) avg[j] += psd_averaging_ * (psd_csd_[j] - avg[j]);
+      }
+      const float * avg_a = psd_avg_;
+      const float * avg_b = psd_avg_ + i * psd_buffer_size;
+      for (int j=0; j < psd_buffer_size; j++){
+	float denom = avg_a[j] * avg_b[j];
+	float c = denom > 0 ? (avg[2*j] * avg[2*j] + avg[2*j+1] * avg[2*j+1]) / denom : 0.0f;
+	coh[j] = c < 1.0f ? c : 1.0f;
+      }
+    }
+
+    std::lock_guard<std::mutex> lock(psd_mutex_);
+    psd_result_inds_.swap(psd_job_inds_);
+    psd_is_running_ = false;
+    psd_has_result_ = true;
+  }
+}
+
+//call with psd_mutex_ held and the worker idle
+void PlotBundler::pick_up_psds(){
+  psd_has_result_ = false;
+  psd_epoch_++;
+  for (int i=0; i < num_plots; i++){
+    int k = -1;
+    if (i < (int)psd_result_inds_.size() && psd_result_inds_[i] == previousVEInds[i]) k = i;
+    for (size_t j=0; k < 0 && j < psd_result_inds_.size(); j++){
+      if (psd_result_inds_[j] == previousVEInds[i]) k = j;
+    }
+    if (k < 0) continue;
+    std::copy(psd_result_ + k * psd_buffer_size, psd_result_ + (k+1) * psd_buffer_size,
+	      psd_vals + i * psd_buffer_size);
+    //the coherence is only good if it was against the same first plot
+    if (i == 0 || k == 0 || psd_result_inds_[0] != previousVEInds[0]) continue;
+    std::copy(psd_coh_result_ + k * psd_buffer_size, psd_coh_result_ + (k+1) * psd_buffer_size,
+	      coh_vals + i * psd_buffer_size);
+  }
+}
+
 // pis = plot indices,  cis = color indices
 void PlotBundler::update_plots(std::list<int> & pis, std::list<glm::vec3> & cis){
   auto it1 = pis.begin();
@@ -83,14 +190,22 @@ void PlotBundler::update_plots(std::list<int> & pis, std::list<glm::vec3> & cis)
   for(; it1 != pis.end() && it2 != cis.end(); ++it1, ++it2){
     color_vals[num_plots] = *it2;
     //cout<< "Plot "<< num_plots<< " r" << (*it2).r<<"g"<<(*it2).g<<"b"<<(*it2).b<<endl;
-    (*vis_elems_)[*it1]->get_current_equation().get_bulk_value(&(plot_vals[num_plots * buffer_size_]));
+    Equation & eq = vis_elems_->get_current_equation(*it1);
+    eq.get_bulk_value(&(plot_vals[num_plots * buffer_size_]), &(plot_samples_[num_plots]));
+    if (plot_eqs_[num_plots] != &eq){
+	    plot_eqs_[num_plots] = &eq;
+	    plot_sources_[num_plots] = next_source_++;
+    }
     
-    sample_rate_buffer[num_plots] = (*vis_elems_)[*it1]->get_current_equation().get_sample_rate();
+    sample_rate_buffer[num_plots] = eq.get_sample_rate();
     
-    //check to see if the highlighted elements have changed
+    //a spectrum of whatever was plotted here before is blanked until the new one is done
     if (previousVEInds[num_plots] != *it1){
 	    previousVEInds[num_plots] = *it1;
-	    last_updated[num_plots] = -1;
+	    std::fill(psd_vals + num_plots * psd_buffer_size, psd_vals + (num_plots+1) * psd_buffer_size, 0.0f);
+	    //a new first plot changes every pair
+	    if (num_plots == 0) std::fill(coh_vals, coh_vals + max_num_plots_ * psd_buffer_size, 0.0f);
+	    else std::fill(coh_vals + num_plots * psd_buffer_size, coh_vals + (num_plots+1) * psd_buffer_size, 0.0f);
     }
     
     num_plots++;
@@ -109,30 +224,18 @@ void PlotBundler::update_plots(std::list<int> & pis, std::list<glm::vec3> & cis)
     if (plot_vals[i] > plot_max ) plot_max = plot_vals[i];
   }
 
-
-  for (int i=0; i < num_plots; i++){
-    if (last_updated[i] < 0 || last_updated[i] > max_num_plots_){
-      //cout<<"updating i "<<i<<endl;
-      //update the fft
-	    float mean_val = 0;
-	    for (int j=0; j<buffer_size_; j++) mean_val += plot_vals[i * buffer_size_ + j];
-	    mean_val /= (float) buffer_size_;
-
-
-	    for (int j=0; j<buffer_size_; j++) psd_tmp_buffer[j] = psd_hann_buffer[j] * (plot_vals[i * buffer_size_ + j] - mean_val);
-	    fftw_execute(fft_plan);
-	    for (int j=1; j < psd_buffer_size; j++){
-		    psd_vals[i*psd_buffer_size + j - 1] = sqrt( fft_out[j][0]*fft_out[j][0] + 
-								fft_out[j][1]*fft_out[j][1]);
-	    }
-	    //zeros the lowest bins because fuck it
-	    for (int j=0; j < 1; j++)
-		    psd_vals[i*psd_buffer_size+j] = 0;
-	    psd_vals[i*psd_buffer_size+psd_buffer_size-1]  = 0;
-	    
-	    last_updated[i] = 0;
-    }else{
-	    last_updated[i]++;
+  //takes the finished spectra and hands the worker the current histories
+  {
+    std::lock_guard<std::mutex> lock(psd_mutex_);
+    if (!psd_is_queued_ && !psd_is_running_){
+      if (psd_has_result_) pick_up_psds();
+      if (num_plots > 0){
+	std::copy(plot_vals, plot_vals + num_plots * buffer_size_, psd_in_);
+	std::copy(sample_rate_buffer, sample_rate_buffer + num_plots, psd_sample_rates_);
+	psd_job_inds_.assign(previousVEInds, previousVEInds + num_plots);
+	psd_is_queued_ = true;
+	psd_cv_.notify_one();
+      }
     }
   }
   
@@ -150,12 +253,24 @@ float * PlotBundler::get_plot(int index, glm::vec3 & plot_color){
   return plot_vals + buffer_size_ * index;
 }
 
+void PlotBundler::get_plot_samples(int index, unsigned long & source, unsigned long & n_samples){
+  assert(index < num_plots);
+  source = plot_sources_[index];
+  n_samples = plot_samples_[index];
+}
+
 float * PlotBundler::get_psd(int index, glm::vec3 & plot_color){
   assert(index < num_plots);
   plot_color = color_vals[index];
   return psd_vals + psd_buffer_size * index;
 }
 
+float * PlotBundler::get_coherence(int index, glm::vec3 & plot_color){
+  assert(index < num_plots);
+  plot_color = color_vals[index];
+  return coh_vals + psd_buffer_size * index;
+}
+
 void PlotBundler::get_plot_min_max(float & min, float & max){
   min = plot_min;
   max = plot_max;
@@ -1,49 +1,87 @@
 #pragma once
 #include <list>
 #include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 #include "glm/glm.hpp"
 #include <fftw3.h>
 
 #include "visualelement.h"
+#include "fftplans.h"
+#include "psd.h"
+
+/**
+   Collects the histories of the highlighted elements for the plots and takes
+   their spectra.
+
+   The spectra are taken on a worker thread.  Each update hands it a copy of
+   the plotted histories if it is free, and picks up whatever it finished
+   since, so the spectra are at most one update behind and the render thread
+   never waits on an FFT.
+
+   The spectra are Welch averaged and then averaged exponentially across
+   updates, with the newest one weighted by psd_averaging, and are shown as
+   amplitude spectral densities in units/sqrt(Hz).
+
+   The cross spectra of the first plot with each of the others come from the
+   same transforms and are averaged the same way, which gives the magnitude
+   squared coherence |Sab|^2 / (Saa Sbb) of each pair.
+ **/
 
 class PlotBundler{
 public:
-	PlotBundler(int max_num_plots, int buffer_size,  std::vector<VisElemPtr> * vis_elems);
+	PlotBundler(int max_num_plots, int buffer_size,  VisElemStore * vis_elems, FftPlanCache * fft_plans,
+		    int psd_segment_length, float psd_overlap, float psd_averaging);
 	~PlotBundler();
 	
 	int get_num_plots();  
 	void update_plots(std::list<int> & pis, std::list<glm::vec3> & cis);
 	//index is the plot num
 	float * get_plot(int pnum, glm::vec3 & plot_color);
+	//source changes whenever the slot shows a different history, n_samples
+	//is the sample count of the history from Equation::get_bulk_value
+	void get_plot_samples(int pnum, unsigned long & source, unsigned long & n_samples);
 	float * get_psd(int pnum, glm::vec3 & plot_color);
+	//the coherence of plot pnum with plot 0, from 0 to 1, for pnum > 0
+	float * get_coherence(int pnum, glm::vec3 & plot_color);
 	
 	void get_plot_min_max(float & min, float & max);
 	void get_psd_min_max(float & min, float & max);
 	
 	int get_psd_buffer_size();
+	int get_psd_segment_length(){return welch_.get_segment_length();}
 	
 	void get_psd_start_and_sep(float & start, float & sep);
 
+	//the visual element plotted in a slot
+	int get_plot_element(int pnum){return previousVEInds[pnum];}
+	//bumped every time finished spectra are picked up
+	unsigned long get_psd_epoch(){return psd_epoch_;}
+
 
 private:
 	PlotBundler(const PlotBundler&); //prevent copy construction      
 	PlotBundler& operator=(const PlotBundler&); //prevent assignment
-	std::vector<VisElemPtr> * vis_elems_;
+	void psd_loop();
+	void pick_up_psds();
+
+	VisElemStore * vis_elems_;
 	
 	float * plot_vals;
 	float * psd_vals;
+	float * coh_vals;
 	
-	double * psd_tmp_buffer;
-	double * psd_hann_buffer;
-
 	glm::vec3 * color_vals;
-	int * last_updated;
 	int * previousVEInds;
+	std::vector<Equation*> plot_eqs_;
+	std::vector<unsigned long> plot_sources_;
+	std::vector<unsigned long> plot_samples_;
+	unsigned long next_source_;
 
 	float * sample_rate_buffer;
 
-	fftw_complex * fft_out;  
 	int num_plots;  
 	int max_num_plots_;
 	int buffer_size_;
@@ -52,6 +90,31 @@ private:
 	
 	float plot_min, plot_max;
 	float psd_min, psd_max;
-	
-	fftw_plan fft_plan;
+
+	//owned by the worker while a job is queued or running
+	WelchPsd welch_;
+	float psd_averaging_;
+	float * psd_in_;
+	float * psd_sample_rates_;
+	float * psd_power_;
+	float * psd_result_;
+	std::vector<int> psd_job_inds_;
+	std::vector<int> psd_result_inds_;
+	//the running average of the power in each slot and what it was for
+	float * psd_avg_;
+	std::vector<int> psd_avg_inds_;
+	//the same for the cross spectra of plot 0 with plot i, as real, imag pairs
+	float * psd_csd_;
+	float * psd_csd_avg_;
+	std::vector< std::pair<int, int> > psd_csd_avg_inds_;
+	float * psd_coh_result_;
+
+	std::thread psd_thread_;
+	std::mutex psd_mutex_;
+	std::condition_variable psd_cv_;
+	bool psd_is_queued_;
+	bool psd_is_running_;
+	bool psd_has_result_;
+	bool psd_is_stopping_;
+	unsigned long psd_epoch_;
 };
@@ -2,6 +2,7 @@
 
 #include <assert.h>
 #include <math.h>
+#include <algorithm>
 
 #define GLM_FORCE_RADIANS
 #include "glm/glm.hpp"
@@ -12,12 +13,15 @@
 #include <math.h>
 
 #include "shader.h"
+#include "equation.h"
 
 using namespace std;
 
 
 Plotter::Plotter(int max_num_points){
   max_num_points_ = max_num_points;
+  viewport_width_ = 0;
+  n_columns_ = 0;
   plot_buffer_ = vector<float>(max_num_points * 3, 0.0);
 
   string fragment_shader = R"(#version 330 core
@@ -62,9 +66,114 @@ void main(){
   glBufferData(GL_ARRAY_BUFFER, 18 * sizeof(float), squareVerts, GL_STATIC_DRAW);
 
 
-  glGenBuffers(1, &simple_line_buffer_);
-  glBindBuffer(GL_ARRAY_BUFFER, simple_line_buffer_);
-  glBufferData(GL_ARRAY_BUFFER, 6 * sizeof(float), squareVerts, GL_STREAM_DRAW);
+  //the lines are scaled here so the buffers only hold raw values
+  string series_vertex_shader = R"(#version 330 core
+layout(location = 0) in vec2 sample;
+out vec4 fragColor;
+
+uniform mat4 MP;
+uniform vec4 color;
+uniform int is_ring;
+uniform int first;
+uniform float n_elems;
+uniform int is_log;
+uniform vec2 range;
+
+void main(){
+    float t = is_ring != 0 ? float(gl_VertexID - first) : sample.x;
+    float v = is_ring != 0 ? sample.x : sample.y;
+    float x = is_log != 0 ? log2(t + 1.0) / log2(n_elems) : t / n_elems;
+    float y = clamp((v - range.x) / (range.y - range.x) * 2.0 - 1.0, -1.0, 1.0);
+    gl_Position = MP * vec4(x * 2.0 - 1.0, y, -0.97, 1);
+    fragColor = color;
+}
+)";
+  series_program_ = LoadShadersDef(series_vertex_shader, fragment_shader);
+  series_sample_attrib_ = glGetAttribLocation(series_program_, "sample");
+  series_color_uniform_ = glGetUniformLocation(series_program_, "color");
+  series_view_matrix_uniform_ = glGetUniformLocation(series_program_, "MP");
+  series_is_ring_uniform_ = glGetUniformLocation(series_program_, "is_ring");
+  series_first_uniform_ = glGetUniformLocation(series_program_, "first");
+  series_n_elems_uniform_ = glGetUniformLocation(series_program_, "n_elems");
+  series_is_log_uniform_ = glGetUniformLocation(series_program_, "is_log");
+  series_range_uniform_ = glGetUniformLocation(series_program_, "range");
+
+  glGenBuffers(1, &series_vert_buffer_);
+  glBindBuffer(GL_ARRAY_BUFFER, series_vert_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, 2 * max_num_points_ * sizeof(float), NULL, GL_STREAM_DRAW);
+
+  string spec_vertex_shader = R"(#version 330 core
+layout(location = 0) in vec3 vertexPosition;
+out vec2 uv;
+
+uniform mat4 MP;
+
+void main(){
+    gl_Position = MP * vec4(vertexPosition.xy, -0.96, 1);
+    uv = (vertexPosition.xy + 1.0) * 0.5;
+}
+)";
+
+  string spec_fragment_shader = R"(#version 330 core
+in vec2 uv;
+out vec4 color;
+
+uniform sampler2D values;
+uniform sampler2D cmapLUT;
+uniform float offset;
+uniform float cmapMin;
+uniform float cmapMax;
+
+void main(){
+  float v = texture(values, vec2(uv.x + offset, uv.y)).r;
+  if (isnan(v)) discard;
+  float t = clamp((v - cmapMin) / (cmapMax - cmapMin), 0.0, 1.0);
+  color = texture(cmapLUT, vec2(t, 0.5));
+}
+)";
+  spec_program_ = LoadShadersDef(spec_vertex_shader, spec_fragment_shader);
+  spec_pos_attrib_ = glGetAttribLocation(spec_program_, "vertexPosition");
+  spec_view_matrix_uniform_ = glGetUniformLocation(spec_program_, "MP");
+  spec_values_uniform_ = glGetUniformLocation(spec_program_, "values");
+  spec_lut_uniform_ = glGetUniformLocation(spec_program_, "cmapLUT");
+  spec_offset_uniform_ = glGetUniformLocation(spec_program_, "offset");
+  spec_cmap_min_uniform_ = glGetUniformLocation(spec_program_, "cmapMin");
+  spec_cmap_max_uniform_ = glGetUniformLocation(spec_program_, "cmapMax");
+
+  //the rainbow over [0, 1], the shader scales to the range of the history
+  color_map_t cmap = get_color_map("rainbow_cmap");
+  int lut_size = 256;
+  vector<GLfloat> lut(4 * lut_size);
+  for (int i=0; i < lut_size; i++){
+    glm::vec4 col = cmap(((float)i) / (lut_size - 1));
+    for (int j=0; j < 4; j++) lut[4*i + j] = col[j];
+  }
+  glGenTextures(1, &spec_lut_texture_);
+  glBindTexture(GL_TEXTURE_2D, spec_lut_texture_);
+  glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA32F, lut_size, 1, 0, GL_RGBA, GL_FLOAT, &lut[0]);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+  glGenTextures(1, &spec_texture_);
+  glGenTextures(1, &matrix_texture_);
+  glBindTexture(GL_TEXTURE_2D, 0);
+  matrix_n_ = 0;
+  spec_elem_ = -1;
+  spec_n_bins_ = 0;
+  spec_head_ = 0;
+  spec_min_ = 0;
+  spec_max_ = 1;
+
+  glGenBuffers(1, &bar_vert_buffer_);
+  glGenBuffers(1, &band_vert_buffer_);
+
+  glGenBuffers(1, &tick_vert_buffer_);
+  n_tick_verts_ = -1;
+  tick_n_elems_ = 0;
+  tick_x_start_ = 0;
+  tick_x_sep_ = 0;
 
   
   float fgVerts[] = {-1,-1,-0.95,  -1,1,-0.95,
@@ -103,13 +212,29 @@ void main(){
 
 Plotter::~Plotter() {
 	glDeleteBuffers(1, &square_vert_buffer_);
-	glDeleteBuffers(1, &simple_line_buffer_);
+	glDeleteBuffers(1, &series_vert_buffer_);
+	glDeleteBuffers(1, &tick_vert_buffer_);
+	glDeleteBuffers(1, &bar_vert_buffer_);
+	glDeleteBuffers(1, &band_vert_buffer_);
+	for (size_t i=0; i < slots_.size(); i++) glDeleteBuffers(1, &slots_[i].buffer);
+	glDeleteProgram(series_program_);
+	glDeleteTextures(1, &spec_texture_);
+	glDeleteTextures(1, &spec_lut_texture_);
+	glDeleteTextures(1, &matrix_texture_);
+	glDeleteProgram(spec_program_);
 	glDeleteBuffers(1, &line_vert_buffer_);
 	glDeleteBuffers(1, &fg_vert_buffer_);
 }
 
 
+void Plotter::set_viewport_width(int width){
+	viewport_width_ = width;
+}
+
 void Plotter::prepare_plotting(glm::vec2 center, glm::vec2 size){
+	//the plot spans 2 * size.x of the 2 wide screen
+	n_columns_ = ceilf(size.x * viewport_width_);
+
 	view_transform_ = glm::mat4(1);
 	view_transform_[0][0] = size.x;
 	view_transform_[1][1] = size.y;
@@ -162,6 +287,165 @@ void Plotter::plotFG(glm::vec4 color){
   
 }
 
+void Plotter::draw_outline(const std::vector<glm::vec2> & points, glm::vec4 color){
+	if (points.size() < 2) return;
+	//long lassos are thinned out to fit the line buffer
+	int step = (points.size() + max_num_points_ - 1) / max_num_points_;
+	int n_points = 0;
+	for (size_t i=0; i < points.size(); i += step, n_points++){
+		plot_buffer_[n_points*3] = points[i].x;
+		plot_buffer_[n_points*3 + 1] = points[i].y;
+		plot_buffer_[n_points*3 + 2] = -0.99;
+	}
+
+	glUniformMatrix4fv(view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
+	glUniform4fv(vertex_color_shader_uniform_, 1, &( color[0]  ));
+	glEnableVertexAttribArray(vertex_pos_shader_attrib_);
+	glBindBuffer(GL_ARRAY_BUFFER, line_vert_buffer_);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, n_points * 3 * sizeof(GLfloat), &( plot_buffer_[0]));
+	glVertexAttribPointer(vertex_pos_shader_attrib_,
+			      3,                  // size
+			      GL_FLOAT,           // type
+			      GL_FALSE,           // normalized?
+			      0,                  // stride
+			      (void*)0            // array buffer offset
+		);
+	glDrawArrays(GL_LINE_LOOP, 0, n_points);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableVertexAttribArray(vertex_pos_shader_attrib_);
+}
+
+/**
+   Fills plot_buffer_ with (sample index, value) pairs of the line.  Lines with
+   more than two points a pixel column are reduced to the lowest and highest
+   point of every column they cross, in the order they come in, which covers
+   the same pixels.  The scaling to the plot is monotonic so the raw values
+   decide it.  Returns the number of pairs.
+ **/
+int Plotter::decimate_to_columns(const float * vals, int n_points, int is_log_scale){
+	float * b = &plot_buffer_[0];
+	if (n_columns_ <= 0 || n_points <= 2 * n_columns_){
+		for (int i=0; i < n_points; i++){
+			b[i*2] = i;
+			b[i*2+1] = vals[i];
+		}
+		return n_points;
+	}
+	//the same x as the shader, from 0 to 1
+	float log_n = log2f(n_points);
+	auto column = [&](int i){
+		float x = is_log_scale ? log2f(i + 1.0f) / log_n : ((float)i) / n_points;
+		return (int)(x * n_columns_);
+	};
+	int n_out = 0;
+	int col_start = 0;
+	while (col_start < n_points){
+		int col = column(col_start);
+		int min_ind = col_start;
+		int max_ind = col_start;
+		int i = col_start + 1;
+		for (; i < n_points && column(i) == col; i++){
+			if (vals[i] < vals[min_ind]) min_ind = i;
+			if (vals[i] > vals[max_ind]) max_ind = i;
+		}
+		int first = min_ind < max_ind ? min_ind : max_ind;
+		int second = min_ind < max_ind ? max_ind : min_ind;
+		b[n_out*2] = first;
+		b[n_out*2+1] = vals[first];
+		n_out++;
+		if (second != first){
+			b[n_out*2] = second;
+			b[n_out*2+1] = vals[second];
+			n_out++;
+		}
+		col_start = i;
+	}
+	return n_out;
+}
+
+void Plotter::draw_series(GLuint buffer, int is_ring, int first, int n_verts, int n_elems,
+			  float min, float max, glm::vec4 color, int is_log_scale, GLenum mode){
+	glUseProgram(series_program_);
+	glUniformMatrix4fv(series_view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
+	glUniform4fv(series_color_uniform_, 1, &( color[0]  ));
+	glUniform1i(series_is_ring_uniform_, is_ring);
+	glUniform1i(series_first_uniform_, first);
+	glUniform1f(series_n_elems_uniform_, n_elems);
+	glUniform1i(series_is_log_uniform_, is_log_scale);
+	glUniform2f(series_range_uniform_, min, max);
+
+	glEnableVertexAttribArray(series_sample_attrib_);
+	glBindBuffer(GL_ARRAY_BUFFER, buffer);
+	//a ring only holds the values, the sample index comes from gl_VertexID
+	glVertexAttribPointer(series_sample_attrib_,
+			      is_ring ? 1 : 2,    // size
+			      GL_FLOAT,           // type
+			      GL_FALSE,           // normalized?
+			      0,                  // stride
+			      (void*)0            // array buffer offset
+		);
+	glDrawArrays(mode, first, n_verts);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableVertexAttribArray(series_sample_attrib_);
+	glUseProgram(programID);
+}
+
+void Plotter::upload_ring(history_slot & s, int start, int count, int n_elems){
+	glBindBuffer(GL_ARRAY_BUFFER, s.buffer);
+	while (count > 0){
+		int c = std::min(count, n_elems - start);
+		glBufferSubData(GL_ARRAY_BUFFER, start * sizeof(GLfloat), c * sizeof(GLfloat), &(s.ring[start]));
+		glBufferSubData(GL_ARRAY_BUFFER, (start + n_elems) * sizeof(GLfloat), c * sizeof(GLfloat),
+				&(s.ring[start + n_elems]));
+		count -= c;
+		start = 0;
+	}
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Plotter::update_log_ticks(int n_elems, float x_start, float x_sep){
+	if (n_tick_verts_ >= 0 && n_elems == tick_n_elems_ && x_start == tick_x_start_ && x_sep == tick_x_sep_) return;
+	tick_n_elems_ = n_elems;
+	tick_x_start_ = x_start;
+	tick_x_sep_ = x_sep;
+
+	//bin 0 can be DC, so the decades start at the first bin above x_start,
+	//and bin t sits at log2(t + 1) like in the series shader
+	std::vector<GLfloat> verts;
+	int low_val = 0;
+	int high_val = -1;
+	if (x_sep > 0 && n_elems > 1){
+		low_val = ceilf(log10f(x_start + x_sep));
+		high_val = ceilf(log10f(x_start + x_sep * n_elems));
+	}
+	for (int j = 0; j < high_val-low_val + 1; j++){
+		for (int i=0; i<10; i++) {
+			float vline = (i + 1)  * powf(10.0, j + low_val);
+			float height =  0.5/ ((float) ( 1 + (i) % 10));
+			float x = (vline - x_start) / x_sep;
+			x = log2(x + 1.0f) /(log2(n_elems) - log2(1)) * 2 - 1;
+			GLfloat line[6] = {x, -1 + height, -0.99f, x, -1, -0.99f};
+			verts.insert(verts.end(), line, line + 6);
+		}
+	}
+
+	for (int pow = low_val; pow < high_val; pow++) {
+		float y_pos = -0.5;
+		float x_pos = powf(10, pow);
+		x_pos = (x_pos - x_start) / x_sep;
+		x_pos =  log2((float)x_pos+1.0f) /(log2(n_elems) - log2(1)) * 2 - 1;
+
+		std::vector<GLfloat> vs;
+		get_power_of_ten_number_lines(pow, 0.05, x_pos,y_pos,-0.99, vs);
+		verts.insert(verts.end(), vs.begin(), vs.end());
+	}
+
+	n_tick_verts_ = verts.size() / 3;
+	glBindBuffer(GL_ARRAY_BUFFER, tick_vert_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(GLfloat), verts.size() ? &(verts[0]) : NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
 void Plotter::plot(float * vals, int n_elems, 
 		   float min, float max, 
 		   glm::vec4 color, 
@@ -179,128 +463,259 @@ void Plotter::plot(float * vals, int n_elems,
 	}
 	#endif
 
-	int low_val = ceilf(logf(x_start)/logf(10));
-	int high_val = ceilf(logf(x_start + x_sep * n_elems)/logf(10));
-	int n_mags = high_val - low_val + 1;
-	
-	
-	int n_vlines = 10 * (1 + high_val-low_val);
-	float * vlines = NULL;
-	float * vline_height = NULL;
-	std::vector<float> vline_tmps(n_vlines, 0);
-		
+	int n_verts = decimate_to_columns(vals, n_elems, is_log_scale);
+	glBindBuffer(GL_ARRAY_BUFFER, series_vert_buffer_);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, n_verts * 2 * sizeof(GLfloat), &( plot_buffer_[0]));
+	draw_series(series_vert_buffer_, 0, 0, n_verts, n_elems, min, max, color, is_log_scale);
+
 	if (is_log_scale) {
-		vlines = new float[n_vlines];
-		vline_height = new float[n_vlines];
-		for (int j = 0; j < high_val-low_val + 1; j++){
-			for (int i=0; i<10; i++) {
-				vlines[i + j * 10] = (i + 1)  * powf(10.0, j + low_val);
-				vline_height[i + j * 10] =  0.5/ ((float) ( 1 + (i) % 10));
-			}
-		}
-		for (int i=0; i < n_vlines; i++) {
-			vline_tmps[i] = (vlines[i] - x_start) / x_sep;
-		}
+		update_log_ticks(n_elems, x_start, x_sep);
+		glm::vec4 col_line(1,1,1,1);
+		glUniformMatrix4fv(view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
+		glUniform4fv(vertex_color_shader_uniform_, 1, &( col_line[0]  ));
+		glEnableVertexAttribArray(vertex_pos_shader_attrib_);
+		glBindBuffer(GL_ARRAY_BUFFER, tick_vert_buffer_);
+		glVertexAttribPointer(vertex_pos_shader_attrib_, 3,GL_FLOAT,GL_FALSE,	0, (void*)0  );
+		glDrawArrays(GL_LINES, 0, n_tick_verts_);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glDisableVertexAttribArray(vertex_pos_shader_attrib_);
 	}
+	
+	glLineWidth(1);
+}
 
-	if (!is_log_scale){
-		//cout<<"in plotter min: "<< min << " max: "<< max <<endl;
-		for (int i=0; i < n_elems; i++){
-			plot_buffer_[i*3+1] = (vals[i]-min)/(max-min)*2 -1;
-			if (plot_buffer_[i*3+1] < -1) plot_buffer_[i*3+1] = -1;
-			if (plot_buffer_[i*3+1] > 1) plot_buffer_[i*3+1] = 1;
-			plot_buffer_[i*3] = ((float)i)/((float)n_elems) * 2 -1;
-			plot_buffer_[i*3 + 2] = -0.97;
-		}
-	}else{
-		for (int i=0; i < n_elems; i++){
-			//plot_buffer_[i*3+1] = (vals[i]-min)/(max-min);
-			plot_buffer_[i*3+1] = (vals[i]-min)/(max-min)*2 -1;
-			//plot_buffer_[i*3+1] = 2*(vals[i]/(max-min) + min) -1;
-			if (plot_buffer_[i*3+1] < -1) plot_buffer_[i*3+1] = -1;
-			if (plot_buffer_[i*3+1] > 1) plot_buffer_[i*3+1] = 1;
-			plot_buffer_[i*3] = log2((float)i+1.0f) /(log2(n_elems) - log2(1)) * 2 - 1;
-			plot_buffer_[i*3 + 2] = -0.97;
-		}
-		
-		for (int i=0; i < n_vlines; i++) {
-			vline_tmps[i] = log2((float)vline_tmps[i]+1.0f) /(log2(n_elems) - log2(1)) * 2 - 1; 
-		}
+static long long floor_div(long long a, long long b){
+	return a >= 0 ? a / b : -((-a + b - 1) / b);
+}
+
+void Plotter::fill_history_column(history_slot & s, long long col, const float * vals, int n_elems, long long first){
+	int verts = s.run > 1 ? 2 : 1;
+	int ring_verts = s.n_cols * verts;
+	int pos = (int)(((col % s.n_cols) + s.n_cols) % s.n_cols) * verts;
+	//the samples of the column that are in vals, the min and max go in the order they came
+	long long lo = std::max(col * s.run, first) - first;
+	long long hi = std::min((col + 1) * s.run, first + n_elems) - first;
+	if (lo >= hi) lo = hi = 0;
+	int min_ind = lo;
+	int max_ind = lo;
+	for (int i=lo + 1; i < hi; i++){
+		if (vals[i] < vals[min_ind]) min_ind = i;
+		if (vals[i] > vals[max_ind]) max_ind = i;
 	}
-	
-	glUniformMatrix4fv(view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
-	glUniform4fv(vertex_color_shader_uniform_, 1, &( color[0]  ));
-	
-	glEnableVertexAttribArray(vertex_pos_shader_attrib_);  
-	glBindBuffer(GL_ARRAY_BUFFER, line_vert_buffer_);
-	glBufferSubData(GL_ARRAY_BUFFER, 0, n_elems * 3 * sizeof(GLfloat), &( plot_buffer_[0]));
-	glVertexAttribPointer(vertex_pos_shader_attrib_,
-			      3,                  // size
-			      GL_FLOAT,           // type
-			      GL_FALSE,           // normalized?
-			      0,                  // stride
-			      (void*)0            // array buffer offset      
-		);
-	
-	glDrawArrays(GL_LINE_STRIP, 0, n_elems);
-	
-	if (is_log_scale) {
-	
-		for (int i=0; i < n_vlines; i++) {
-			float line_buff[6];
-			line_buff[0] = vline_tmps[i];
-			line_buff[3] = vline_tmps[i];
-			line_buff[1] = -1 + vline_height[i];
-			line_buff[4] = -1;
-			line_buff[2] = -0.99;
-			line_buff[5] = -0.99;
-			
-			glm::vec4 col_line(1,1,1,1);
-			
-			glUniform4fv(vertex_color_shader_uniform_, 1, &( col_line[0]  ));
-			glBindBuffer(GL_ARRAY_BUFFER, simple_line_buffer_);
-			glEnableVertexAttribArray(vertex_pos_shader_attrib_);
-			glVertexAttribPointer(vertex_pos_shader_attrib_, 3,GL_FLOAT,GL_FALSE,	
-					      0, (void*)0  );
-			glBufferSubData(GL_ARRAY_BUFFER, 0, 6 * sizeof(GLfloat), line_buff);
-			glDrawArrays(GL_LINE_STRIP, 0, 2);
-		}
+	s.ring[pos] = s.ring[pos + ring_verts] = vals[std::min(min_ind, max_ind)];
+	if (verts == 2) s.ring[pos + 1] = s.ring[pos + 1 + ring_verts] = vals[std::max(min_ind, max_ind)];
+}
 
+void Plotter::plot_history(int slot, unsigned long source, unsigned long n_samples, float * vals, int n_elems,
+			   float min, float max, glm::vec4 color){
+	assert(n_elems <= max_num_points_);
+	if (n_elems <= 0) return;
+
+	while ((int)slots_.size() <= slot){
+		history_slot hs;
+		glGenBuffers(1, &hs.buffer);
+		glBindBuffer(GL_ARRAY_BUFFER, hs.buffer);
+		glBufferData(GL_ARRAY_BUFFER, 2 * max_num_points_ * sizeof(float), NULL, GL_DYNAMIC_DRAW);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		hs.source = 0;
+		hs.n_samples = 0;
+		hs.run = 0;
+		hs.n_cols = 0;
+		slots_.push_back(hs);
+	}
+	history_slot & s = slots_[slot];
+
+	//longer than two points a pixel column, runs of samples go in as their min and max
+	int run = (n_columns_ > 0 && n_elems > 2 * n_columns_) ? (n_elems + n_columns_ - 1) / n_columns_ : 1;
+	int n_cols = (n_elems + run - 1) / run;
+	int verts = run > 1 ? 2 : 1;
+	int ring_verts = n_cols * verts;
+	long long first = (long long)n_samples - n_elems;
+	long long newest = floor_div((long long)n_samples - 1, run);
+	long long oldest = newest - n_cols + 1;
+
+	//before the first sample the history is a fill that the first sample replaces
+	bool is_new = s.source != source || s.run != run || s.n_cols != n_cols ||
+		s.n_samples == 0 || n_samples < s.n_samples || n_samples - s.n_samples >= (unsigned long)n_elems;
+	if (is_new){
+		s.source = source;
+		s.run = run;
+		s.n_cols = n_cols;
+		s.ring.resize(2 * ring_verts);
+		for (long long c=oldest; c <= newest; c++) fill_history_column(s, c, vals, n_elems, first);
+		glBindBuffer(GL_ARRAY_BUFFER, s.buffer);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, 2 * ring_verts * sizeof(GLfloat), &(s.ring[0]));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	} else if (n_samples > s.n_samples){
+		//the newest column of the last call is redone if it wasn't full yet,
+		//the oldest keeps the samples that have since left the history
+		long long from = std::max(floor_div((long long)s.n_samples, run), oldest);
+		for (long long c=from; c <= newest; c++) fill_history_column(s, c, vals, n_elems, first);
+		int start = (int)(((from % n_cols) + n_cols) % n_cols) * verts;
+		upload_ring(s, start, (int)(newest - from + 1) * verts, ring_verts);
+	}
+	s.n_samples = n_samples;
 
-		for (int pow = low_val; pow < high_val; pow++) {
-			float y_pos = -0.5;
-			float x_pos = powf(10, pow);
-			x_pos = (x_pos - x_start) / x_sep;
-			x_pos =  log2((float)x_pos+1.0f) /(log2(n_elems) - log2(1)) * 2 - 1;
-			
-			std::vector<GLfloat> vs;
-			get_power_of_ten_number_lines(pow, 0.05, x_pos,y_pos,-0.99, vs);
-			glm::vec4 col_line(1,1,1,1);
-
-			GLuint number_buffer;
-			glGenBuffers(1, &number_buffer);
-			glBindBuffer(GL_ARRAY_BUFFER, number_buffer);
-			glBufferData(GL_ARRAY_BUFFER, 3 * vs.size() * sizeof(GLfloat), 
-				     &(vs[0]), GL_STREAM_DRAW);
-			glUniform4fv(vertex_color_shader_uniform_, 1, &( col_line[0]  ));
-			glEnableVertexAttribArray(vertex_pos_shader_attrib_);
-			glVertexAttribPointer(vertex_pos_shader_attrib_, 3,GL_FLOAT,GL_FALSE,	0, (void*)0  );
-			glBindBuffer(GL_ARRAY_BUFFER, number_buffer);
-			glDrawArrays(GL_LINES, 0, vs.size()/3 );
-			glDeleteBuffers(1, &number_buffer);
+	int head = (int)(((oldest % n_cols) + n_cols) % n_cols) * verts;
+	draw_series(s.buffer, 1, head, ring_verts, ring_verts, min, max, color, 0);
+	glLineWidth(1);
+}
+
+void Plotter::add_spectrogram_column(int elem, const float * vals, int n_bins){
+	if (n_bins <= 0) return;
+	glBindTexture(GL_TEXTURE_2D, spec_texture_);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	if (elem != spec_elem_ || n_bins != spec_n_bins_){
+		spec_elem_ = elem;
+		spec_n_bins_ = n_bins;
+		spec_head_ = 0;
+		spec_col_min_.assign(SPECTROGRAM_COLUMNS, NAN);
+		spec_col_max_.assign(SPECTROGRAM_COLUMNS, NAN);
+		vector<float> empty((size_t)SPECTROGRAM_COLUMNS * n_bins, NAN);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, SPECTROGRAM_COLUMNS, n_bins, 0, GL_RED, GL_FLOAT, &empty[0]);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+
+	//log so the colors follow decades, bins with no power are left empty,
+	//the ranges start as NaN so the first value always replaces them
+	spec_column_.resize(n_bins);
+	float col_min = NAN;
+	float col_max = NAN;
+	for (int i=0; i < n_bins; i++){
+		spec_column_[i] = vals[i] > 0 ? log10f(vals[i]) : NAN;
+		if (isnan(spec_column_[i])) continue;
+		if (!(spec_column_[i] >= col_min)) col_min = spec_column_[i];
+		if (!(spec_column_[i] <= col_max)) col_max = spec_column_[i];
+	}
+	glTexSubImage2D(GL_TEXTURE_2D, 0, spec_head_, 0, 1, n_bins, GL_RED, GL_FLOAT, &spec_column_[0]);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	spec_col_min_[spec_head_] = col_min;
+	spec_col_max_[spec_head_] = col_max;
+	spec_head_ = (spec_head_ + 1) % SPECTROGRAM_COLUMNS;
+
+	spec_min_ = NAN;
+	spec_max_ = NAN;
+	for (int i=0; i < SPECTROGRAM_COLUMNS; i++){
+		if (isnan(spec_col_min_[i])) continue;
+		if (!(spec_col_min_[i] >= spec_min_)) spec_min_ = spec_col_min_[i];
+		if (!(spec_col_max_[i] <= spec_max_)) spec_max_ = spec_col_max_[i];
+	}
+}
+
+void Plotter::draw_value_texture(GLuint texture, float offset, float cmap_min, float cmap_max){
+	glUseProgram(spec_program_);
+	glUniformMatrix4fv(spec_view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
+	glUniform1f(spec_offset_uniform_, offset);
+	glUniform1f(spec_cmap_min_uniform_, cmap_min);
+	glUniform1f(spec_cmap_max_uniform_, cmap_max);
+
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, texture);
+	glUniform1i(spec_values_uniform_, 0);
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, spec_lut_texture_);
+	glUniform1i(spec_lut_uniform_, 1);
+
+	glEnableVertexAttribArray(spec_pos_attrib_);
+	glBindBuffer(GL_ARRAY_BUFFER, square_vert_buffer_);
+	glVertexAttribPointer(spec_pos_attrib_, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glDrawArrays(GL_TRIANGLES, 0, 6);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glDisableVertexAttribArray(spec_pos_attrib_);
+
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, 0);
+	glUseProgram(programID);
+}
+
+void Plotter::plot_spectrogram(){
+	if (spec_n_bins_ == 0 || isnan(spec_min_)) return;
+	float cmap_max = spec_max_ > spec_min_ ? spec_max_ : spec_min_ + 1;
+	//the oldest column is at the left edge
+	draw_value_texture(spec_texture_, ((float)spec_head_) / SPECTROGRAM_COLUMNS, spec_min_, cmap_max);
+}
+
+void Plotter::set_matrix(const float * vals, int n){
+	matrix_n_ = n;
+	if (n == 0) return;
+	glBindTexture(GL_TEXTURE_2D, matrix_texture_);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R32F, n, n, 0, GL_RED, GL_FLOAT, vals);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+}
+
+void Plotter::plot_matrix(){
+	if (matrix_n_ == 0) return;
+	draw_value_texture(matrix_texture_, 0, -1, 1);
+}
+
+void Plotter::plot_band(const float * lower, const float * upper, int n_elems, float min, float max,
+			glm::vec4 color, int is_log_scale){
+	if (n_elems <= 0) return;
+	//a strip of (sample, lower), (sample, upper) pairs, with more samples than
+	//pixel columns each column gets the widest span of the samples in it
+	float log_n = log2f(n_elems);
+	auto column = [&](int i){
+		float x = is_log_scale ? log2f(i + 1.0f) / log_n : ((float)i) / n_elems;
+		return (int)(x * n_columns_);
+	};
+	bool decimate = n_columns_ > 0 && n_elems > 2 * n_columns_;
+	band_verts_.clear();
+	int i = 0;
+	while (i < n_elems){
+		int start = i;
+		float lo = lower[i];
+		float hi = upper[i];
+		i++;
+		if (decimate){
+			int col = column(start);
+			for (; i < n_elems && column(i) == col; i++){
+				lo = std::min(lo, lower[i]);
+				hi = std::max(hi, upper[i]);
+			}
 		}
+		GLfloat pair[4] = {(float)start, lo, (float)start, hi};
+		band_verts_.insert(band_verts_.end(), pair, pair + 4);
 	}
-	
-	
-	if (is_log_scale) {
-		delete [] vlines;
-		delete [] vline_height;
+
+	glBindBuffer(GL_ARRAY_BUFFER, band_vert_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, band_verts_.size() * sizeof(GLfloat), &(band_verts_[0]), GL_STREAM_DRAW);
+	draw_series(band_vert_buffer_, 0, 0, band_verts_.size() / 2, n_elems, min, max, color, is_log_scale,
+		    GL_TRIANGLE_STRIP);
+}
+
+void Plotter::plot_bars(const float * heights, int n_bars, glm::vec4 color){
+	if (n_bars <= 0) return;
+	//two triangles a bar, empty bars stay in so the count never changes
+	bar_verts_.resize((size_t)n_bars * 18);
+	float w = 2.0f / n_bars;
+	for (int i=0; i < n_bars; i++){
+		float x0 = -1 + i * w;
+		float x1 = x0 + w;
+		float y1 = -1 + 2 * std::min(std::max(heights[i], 0.0f), 1.0f);
+		GLfloat bar[18] = {x0,-1,-0.97f,  x1,-1,-0.97f,  x0,y1,-0.97f,
+				   x1,-1,-0.97f,  x0,y1,-0.97f,  x1,y1,-0.97f};
+		std::copy(bar, bar + 18, bar_verts_.begin() + (size_t)i * 18);
 	}
 
+	glUniformMatrix4fv(view_matrix_uniform_,  1, GL_FALSE, &view_transform_[0][0]);
+	glUniform4fv(vertex_color_shader_uniform_, 1, &( color[0]  ));
+	glEnableVertexAttribArray(vertex_pos_shader_attrib_);
+	glBindBuffer(GL_ARRAY_BUFFER, bar_vert_buffer_);
+	glBufferData(GL_ARRAY_BUFFER, bar_verts_.size() * sizeof(GLfloat), &(bar_verts_[0]), GL_STREAM_DRAW);
+	glVertexAttribPointer(vertex_pos_shader_attrib_, 3, GL_FLOAT, GL_FALSE, 0, (void*)0);
+	glDrawArrays(GL_TRIANGLES, 0, n_bars * 6);
 	glBindBuffer(GL_ARRAY_BUFFER, 0);
 	glDisableVertexAttribArray(vertex_pos_shader_attrib_);
-	
-	glLineWidth(1);
 }
 
 void Plotter::cleanup_plotting(){
@@ -5,38 +5,149 @@
 #include <string>
 #include <vector>
 
+/**
+   Draws the plot panels.
+
+   The lines are scaled in the vertex shader, so only raw values go to the gpu.
+   A history plotted in a slot lives in a gpu ring buffer of columns: the
+   sample count passed in says how far the history moved since the last call,
+   and only the columns those samples fall in are uploaded.  A column is one
+   sample, or the min and max of a run of them when the history is longer
+   than two points a pixel column.  The runs are counted from the first sample
+   ever taken, so a column never changes once it is complete.
+
+   The tick marks and labels of the log scaled plot are kept in a buffer that is
+   rebuilt when its range changes.
+
+   The spectrogram keeps the last SPECTROGRAM_COLUMNS spectra of one element
+   as columns of a float texture used as a ring, each new spectrum replaces
+   the oldest column and the quad is drawn with the texture offset to the
+   oldest one, so nothing is redone for the rest of the history.
+ **/
+
+#define SPECTROGRAM_COLUMNS 256
+
 class Plotter{
 public:
 	Plotter(int max_num_points);
 	~Plotter();
+	//the width of the window in pixels, plots are decimated to the columns they cover
+	void set_viewport_width(int width);
 	void prepare_plotting(glm::vec2 center, glm::vec2 size);
 	void plotBG(glm::vec4 color);
 	void plotFG(glm::vec4 color);
-	
-	void plot(float * vals, int n_elems, float min, float max, 
-		  glm::vec4 color, int is_log_scale, 
+
+	void plot(float * vals, int n_elems, float min, float max,
+		  glm::vec4 color, int is_log_scale,
 		  float x_start, float x_sep
 	  );
+	//a history that is plotted in the same slot every frame, oldest sample
+	//first, the slot starts over when source changes, n_samples counts the
+	//samples that have ever gone into the history
+	void plot_history(int slot, unsigned long source, unsigned long n_samples, float * vals, int n_elems,
+			  float min, float max, glm::vec4 color);
+	//adds a spectrum of the element elem as the newest spectrogram column,
+	//the history starts over when the element or the number of bins changes
+	void add_spectrogram_column(int elem, const float * vals, int n_bins);
+	//time goes left to right, frequency bottom to top on a log color scale
+	void plot_spectrogram();
+	//uploads an n by n matrix of values from -1 to 1, row 0 at the bottom
+	void set_matrix(const float * vals, int n);
+	void plot_matrix();
+	//fills between lower and upper, scaled and laid out like plot
+	void plot_band(const float * lower, const float * upper, int n_elems, float min, float max,
+		       glm::vec4 color, int is_log_scale);
+	//n_bars side by side bars over the plot, heights from 0 to 1
+	void plot_bars(const float * heights, int n_bars, glm::vec4 color);
+	//a closed outline in the coordinates set by prepare_plotting
+	void draw_outline(const std::vector<glm::vec2> & points, glm::vec4 color);
 	void cleanup_plotting();
 
  private:
+	Plotter(const Plotter&); //prevent copy construction
+	Plotter& operator=(const Plotter&); //prevent assignment
+
+	struct history_slot{
+		GLuint buffer;
+		//the columns twice over so any n_cols long window of them is contiguous
+		std::vector<float> ring;
+		unsigned long source;
+		unsigned long n_samples;
+		//samples per column and the columns drawn
+		int run;
+		int n_cols;
+	};
+
+	int decimate_to_columns(const float * vals, int n_points, int is_log_scale);
+	void draw_series(GLuint buffer, int is_ring, int first, int n_verts, int n_elems,
+			 float min, float max, glm::vec4 color, int is_log_scale, GLenum mode = GL_LINE_STRIP);
+	void upload_ring(history_slot & s, int start, int count, int n_elems);
+	//computes column col of the history into the ring, first is the sample
+	//number of vals[0]
+	void fill_history_column(history_slot & s, long long col, const float * vals, int n_elems, long long first);
+	void update_log_ticks(int n_elems, float x_start, float x_sep);
+	void draw_value_texture(GLuint texture, float offset, float cmap_min, float cmap_max);
+
 	GLuint programID;
 	GLuint vertex_pos_shader_attrib_;
 	GLuint vertex_color_shader_uniform_;
 	GLuint view_matrix_uniform_;
-	
+
+	GLuint series_program_;
+	GLuint series_sample_attrib_;
+	GLuint series_color_uniform_;
+	GLuint series_view_matrix_uniform_;
+	GLuint series_is_ring_uniform_;
+	GLuint series_first_uniform_;
+	GLuint series_n_elems_uniform_;
+	GLuint series_is_log_uniform_;
+	GLuint series_range_uniform_;
+
 	GLuint square_vert_buffer_;
 	GLuint fg_vert_buffer_;
 
 	GLuint line_vert_buffer_;
-	
-	GLuint simple_line_buffer_;
-	
-	
+	GLuint series_vert_buffer_;
+
+	std::vector<history_slot> slots_;
+
+	GLuint tick_vert_buffer_;
+	int n_tick_verts_;
+	int tick_n_elems_;
+	float tick_x_start_;
+	float tick_x_sep_;
+
+	GLuint spec_program_;
+	GLuint spec_pos_attrib_;
+	GLuint spec_view_matrix_uniform_;
+	GLuint spec_values_uniform_;
+	GLuint spec_lut_uniform_;
+	GLuint spec_offset_uniform_;
+	GLuint spec_cmap_min_uniform_;
+	GLuint spec_cmap_max_uniform_;
+	GLuint spec_texture_;
+	GLuint spec_lut_texture_;
+	int spec_elem_;
+	int spec_n_bins_;
+	int spec_head_;
+	//the range of the log values in each column, NaN for empty columns
+	std::vector<float> spec_col_min_;
+	std::vector<float> spec_col_max_;
+	float spec_min_, spec_max_;
+	std::vector<float> spec_column_;
+	GLuint matrix_texture_;
+	int matrix_n_;
+	GLuint bar_vert_buffer_;
+	std::vector<float> bar_verts_;
+	GLuint band_vert_buffer_;
+	std::vector<float> band_verts_;
+
 	int max_num_points_;
 	std::vector<float> plot_buffer_;
-	
+
 	glm::mat4 view_transform_;
-	
+	int viewport_width_;
+	int n_columns_;
+
 	int n_fg_lines_;
 };
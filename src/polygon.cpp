@@ -13,6 +13,10 @@ Polygon::Polygon(std::vector<glm::vec2> points){
   set_AABB();
 }
 
+Polygon::Polygon(const std::vector<Triangle> & triangles) : tris(triangles){
+  set_AABB();
+}
+
 void Polygon::set_AABB(){
   if (tris.size() <1) print_and_exit("we have an empty triangle");
   vec2 min;
@@ -86,6 +90,20 @@ void Triangle::set_AABB(){
   if (ps[2].x > max_AABB.x) max_AABB.x = ps[2].x;
   if (ps[1].y > max_AABB.y) max_AABB.y = ps[1].y;
   if (ps[2].y > max_AABB.y) max_AABB.y = ps[2].y;
+
+  //the barycentric coordinates are linear in p, so the dot products that
+  //only depend on the corners are folded into two vectors once
+  vec2 v0 = ps[2] - ps[0];
+  vec2 v1 = ps[1] - ps[0];
+  float dot00 = dot(v0, v0);
+  float dot01 = dot(v0, v1);
+  float dot11 = dot(v1, v1);
+  float denom = dot00 * dot11 - dot01 * dot01;
+  is_degenerate = denom == 0;
+  if (is_degenerate) return;
+  float inv_denom = 1.0 / denom;
+  bary_u = (dot11 * v0 - dot01 * v1) * inv_denom;
+  bary_v = (dot00 * v1 - dot01 * v0) * inv_denom;
 }
 
 void Triangle::apply_transform(mat4 trans){
@@ -97,18 +115,10 @@ void Triangle::apply_transform(mat4 trans){
 bool Triangle::is_inside(vec2 p){
   if  (!((p.x >= min_AABB.x) && (p.x <= max_AABB.x) &&
 	 (p.y >= min_AABB.y) && (p.y <= max_AABB.y)) ) return false;
-  //return true;
-  vec2 v0 = ps[2] - ps[0];
-  vec2 v1 = ps[1] - ps[0];
+  if (is_degenerate) return false;
   vec2 v2 = p - ps[0];
-  float dot00 = dot(v0, v0);
-  float dot01 = dot(v0, v1);
-  float dot02 = dot(v0, v2);
-  float dot11 = dot(v1, v1);
-  float dot12 = dot(v1, v2);
-  float inv_denom = 1.0 / (dot00 * dot11 - dot01 * dot01);
-  float u = (dot11 * dot02 - dot01 * dot12) * inv_denom;
-  float v = (dot00 * dot12 - dot01 * dot02) * inv_denom;
+  float u = dot(bary_u, v2);
+  float v = dot(bary_v, v2);
   return (u >= 0) && (v >= 0) && (u + v < 1);
 }
 
@@ -20,12 +20,19 @@ class Triangle{
   
   glm::vec2 min_AABB;
   glm::vec2 max_AABB;
+
+  //u = dot(bary_u, p - ps[0]), v = dot(bary_v, p - ps[0])
+  glm::vec2 bary_u;
+  glm::vec2 bary_v;
+  bool is_degenerate;
 };
 
 
 class Polygon{
  public:
   Polygon(std::vector<glm::vec2> points);
+  //for outlines that have already been triangulated
+  Polygon(const std::vector<Triangle> & triangles);
   void get_AABB(glm::vec2 & min_aabb, glm::vec2 & max_aabb);
   void apply_transform(glm::mat4 trans);
   bool is_inside(glm::vec2 p);
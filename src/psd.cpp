@@ -0,0 +1,99 @@
+#include "psd.h"
+
+#include <math.h>
+
+#include "logging.h"
+
+using namespace std;
+
+
+WelchPsd::WelchPsd(FftPlanCache * fft_plans, int buffer_size, int segment_length, float overlap, int max_series)
+  : fft_plans_(fft_plans), buffer_size_(buffer_size), max_series_(max_series){
+  if (segment_length < 2 || segment_length > buffer_size) segment_length = buffer_size;
+  segment_length_ = segment_length;
+  hop_ = segment_length_ * (1.0f - overlap) + 0.5f;
+  if (hop_ < 1) hop_ = 1;
+  n_segments_ = 1 + (buffer_size_ - segment_length_) / hop_;
+  num_bins_ = segment_length_ / 2 + 1;
+
+  window_ = vector<float>(segment_length_);
+  window_power_ = 0;
+  for (int i=0; i < segment_length_; i++){
+    window_[i] = 0.5 * (1.0 - cos( (2 * M_PI * i) / segment_length_));
+    window_power_ += window_[i] * window_[i];
+  }
+
+  //64 bytes of floats and of complex values
+  series_in_stride_ = ((size_t)n_segments_ * segment_length_ + 15) / 16 * 16;
+  series_out_stride_ = ((size_t)n_segments_ * num_bins_ + 7) / 8 * 8;
+  seg_in_ = fftwf_alloc_real(max_series_ * series_in_stride_);
+  seg_out_ = fftwf_alloc_complex(max_series_ * series_out_stride_);
+  n_computed_ = 0;
+  plan_ = fft_plans_->get_r2c_plan(segment_length_, n_segments_);
+}
+
+WelchPsd::~WelchPsd(){
+  fftwf_free(seg_in_);
+  fftwf_free(seg_out_);
+}
+
+void WelchPsd::compute(const float * series, int n_series, const float * sample_rates, float * psd){
+  l3_assert(n_series <= max_series_);
+  if (n_series == 0) return;
+
+  //the segments end on the newest sample, any left over samples are the oldest
+  int first_start = buffer_size_ - segment_length_ - (n_segments_ - 1) * hop_;
+  for (int i=0; i < n_series; i++){
+    for (int s=0; s < n_segments_; s++){
+      const float * in = series + (size_t)i * buffer_size_ + first_start + s * hop_;
+      float * seg = seg_in_ + i * series_in_stride_ + (size_t)s * segment_length_;
+      float mean_val = 0;
+      for (int j=0; j < segment_length_; j++) mean_val += in[j];
+      mean_val /= segment_length_;
+      for (int j=0; j < segment_length_; j++) seg[j] = window_[j] * (in[j] - mean_val);
+    }
+  }
+
+  for (int i=0; i < n_series; i++){
+    fftwf_execute_dft_r2c(plan_, seg_in_ + i * series_in_stride_, seg_out_ + i * series_out_stride_);
+  }
+  n_computed_ = n_series;
+
+  for (int i=0; i < n_series; i++){
+    float sample_rate = sample_rates[i] > 0 ? sample_rates[i] : 1.0f;
+    //the one sided bins hold the power of the negative frequencies too,
+    //except for DC and Nyquist which have no mirror
+    float scale = 2.0f / (sample_rate * window_power_ * n_segments_);
+    float * out = psd + (size_t)i * num_bins_;
+    for (int k=0; k < num_bins_; k++) out[k] = 0;
+    for (int s=0; s < n_segments_; s++){
+      const fftwf_complex * spec = seg_out_ + i * series_out_stride_ + (size_t)s * num_bins_;
+      for (int k=0; k < num_bins_; k++) out[k] += spec[k][0] * spec[k][0] + spec[k][1] * spec[k][1];
+    }
+    for (int k=0; k < num_bins_; k++) out[k] *= scale;
+    out[0] *= 0.5f;
+    if (segment_length_ % 2 == 0) out[num_bins_ - 1] *= 0.5f;
+  }
+}
+
+void WelchPsd::cross(int a, int b, float sample_rate, float * csd){
+  l3_assert(a < n_computed_ && b < n_computed_);
+  if (sample_rate <= 0) sample_rate = 1.0f;
+  float scale = 2.0f / (sample_rate * window_power_ * n_segments_);
+  for (int k=0; k < 2 * num_bins_; k++) csd[k] = 0;
+  for (int s=0; s < n_segments_; s++){
+    const fftwf_complex * sa = seg_out_ + a * series_out_stride_ + (size_t)s * num_bins_;
+    const fftwf_complex * sb = seg_out_ + b * series_out_stride_ + (size_t)s * num_bins_;
+    for (int k=0; k < num_bins_; k++){
+      csd[2*k] += sa[k][0] * sb[k][0] + sa[k][1] * sb[k][1];
+      csd[2*k+1] += sa[k][0] * sb[k][1] - sa[k][1] * sb[k][0];
+    }
+  }
+  for (int k=0; k < 2 * num_bins_; k++) csd[k] *= scale;
+  csd[0] *= 0.5f;
+  csd[1] *= 0.5f;
+  if (segment_length_ % 2 == 0){
+    csd[2 * num_bins_ - 2] *= 0.5f;
+    csd[2 * num_bins_ - 1] *= 0.5f;
+  }
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <vector>
+
+#include "fftplans.h"
+
+/**
+   Welch averaged power spectral densities.
+
+   A history is cut into segments of segment_length samples that overlap by
+   the overlap fraction, lined up with the newest sample.  Each segment has its
+   mean taken out and a Hann window applied, and the squared transforms are
+   averaged.  The result is one sided and scaled by the sample rate so it is in
+   units^2/Hz, the square root is the amplitude spectral density.
+
+   The segments of a history go through one batched plan from the plan cache
+   that is fetched when the instance is made, and it is run once per history,
+   so the number of histories never asks for a new plan.  Each history's
+   segments start on a cache line so the plan can run on any of them.  The
+   scratch buffers belong to the instance so every thread needs its own.  The transforms of the last compute stay in them, so cross spectra
+   of those histories only cost a multiply per bin and segment.
+ **/
+
+class WelchPsd{
+ public:
+  WelchPsd(FftPlanCache * fft_plans, int buffer_size, int segment_length, float overlap, int max_series);
+  ~WelchPsd();
+
+  int get_num_bins(){return num_bins_;}
+  int get_segment_length(){return segment_length_;}
+  int get_num_segments(){return n_segments_;}
+
+  //series holds n_series histories of buffer_size samples back to back and
+  //psd gets n_series spectra of get_num_bins() values, bin k is at
+  //k * sample_rate / segment_length
+  void compute(const float * series, int n_series, const float * sample_rates, float * psd);
+
+  //the cross spectral density conj(A) B of histories a and b of the last
+  //compute, scaled like the psd, csd gets get_num_bins() real, imag pairs
+  void cross(int a, int b, float sample_rate, float * csd);
+
+ private:
+  WelchPsd(const WelchPsd&); //prevent copy construction
+  WelchPsd& operator=(const WelchPsd&); //prevent assignment
+
+  FftPlanCache * fft_plans_;
+  int buffer_size_;
+  int segment_length_;
+  int hop_;
+  int n_segments_;
+  int num_bins_;
+  int max_series_;
+  //floats and complex values between the segments of consecutive histories
+  size_t series_in_stride_;
+  size_t series_out_stride_;
+  fftwf_plan plan_;
+
+  std::vector<float> window_;
+  float window_power_;
+
+  float * seg_in_;
+  fftwf_complex * seg_out_;
+  int n_computed_;
+};
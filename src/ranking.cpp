@@ -0,0 +1,41 @@
+#include "ranking.h"
+
+#include <algorithm>
+
+using namespace std;
+
+
+ValueRanking::ValueRanking() : k_(10), lowest_(false), worst_(0){}
+
+//ties go to the lower index so the list doesn't flicker between them
+bool ValueRanking::is_better(const std::pair<float, int> & a, const std::pair<float, int> & b) const{
+  if (a.first != b.first) return lowest_ ? a.first < b.first : a.first > b.first;
+  return a.second < b.second;
+}
+
+void ValueRanking::begin_pass(size_t n_elems){
+  heap_.clear();
+}
+
+void ValueRanking::push(size_t elem, float val){
+  auto better = [this](const pair<float, int> & a, const pair<float, int> & b){return is_better(a, b);};
+  if ((int)heap_.size() == k_){
+    pop_heap(heap_.begin(), heap_.end(), better);
+    heap_.back() = make_pair(val, (int)elem);
+  } else {
+    heap_.push_back(make_pair(val, (int)elem));
+  }
+  push_heap(heap_.begin(), heap_.end(), better);
+  worst_ = heap_.front().first;
+}
+
+void ValueRanking::end_pass(){
+  auto better = [this](const pair<float, int> & a, const pair<float, int> & b){return is_better(a, b);};
+  top_ = heap_;
+  sort(top_.begin(), top_.end(), better);
+}
+
+void ValueRanking::get_elems(std::vector<int> & elems) const{
+  elems.resize(top_.size());
+  for (size_t i=0; i < top_.size(); i++) elems[i] = top_[i].second;
+}
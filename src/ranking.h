@@ -0,0 +1,46 @@
+#pragma once
+#include <vector>
+#include <utility>
+#include <stddef.h>
+#include <math.h>
+
+/**
+   The k elements with the highest, or lowest, value of the displayed
+   equation.  Filled by the color pass like the histogram, so no equation is
+   evaluated for it.  The best k of a pass are kept in a heap with the worst of
+   them on top, so once it is full almost every value is turned away by one
+   compare with that, and only the k kept are sorted at the end.
+ **/
+
+class ValueRanking{
+ public:
+  ValueRanking();
+
+  void set_k(int k){k_ = k < 1 ? 1 : k;}
+  void set_lowest(bool lowest){lowest_ = lowest;}
+
+  void begin_pass(size_t n_elems);
+  void add(size_t elem, float val){
+    if (!isfinite(val)) return;
+    //the elements come in index order, so a tie with the worst kept loses
+    if ((int)heap_.size() == k_ && !(lowest_ ? val < worst_ : val > worst_)) return;
+    push(elem, val);
+  }
+  void end_pass();
+
+  //the ranking of the last pass, best first
+  int get_num() const {return top_.size();}
+  int get_elem(int i) const {return top_[i].second;}
+  float get_value(int i) const {return top_[i].first;}
+  void get_elems(std::vector<int> & elems) const;
+
+ private:
+  void push(size_t elem, float val);
+  bool is_better(const std::pair<float, int> & a, const std::pair<float, int> & b) const;
+
+  int k_;
+  bool lowest_;
+  float worst_;
+  std::vector< std::pair<float, int> > heap_;
+  std::vector< std::pair<float, int> > top_;
+};
@@ -0,0 +1,596 @@
+#include "scenefile.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unordered_map>
+#include <vector>
+
+#include "json/json.h"
+#include "genericutils.h"
+#include "logging.h"
+
+using namespace std;
+
+static const char SCENE_FILE_MAGIC[8] = {'L','Y','R','S','C','N','0','5'};
+
+#define SCENE_NO_STRING 0xffffffff
+
+static bool get_file_stamp(std::string path, int64_t & mtime, int64_t & size){
+  struct stat st;
+  if (stat(path.c_str(), &st)) return false;
+  mtime = st.st_mtime;
+  size = st.st_size;
+  return true;
+}
+
+
+/////////////////////
+// writing
+/////////////////////
+
+class SceneWriter{
+ public:
+  uint32_t str(const std::string & s){
+    auto it = string_ids_.find(s);
+    if (it != string_ids_.end()) return it->second;
+    uint32_t id = strings_.size();
+    strings_.push_back(s);
+    string_ids_[s] = id;
+    return id;
+  }
+
+  template <class T> void put(T v){
+    const char * p = (const char *) &v;
+    body_.insert(body_.end(), p, p + sizeof(T));
+  }
+
+  template <class T> void put_vec(const std::vector<T> & v){
+    put<uint32_t>(v.size());
+    if (v.size() == 0) return;
+    const char * p = (const char *) &v[0];
+    body_.insert(body_.end(), p, p + sizeof(T) * v.size());
+  }
+
+  void put_str_vec(const std::vector<std::string> & v){
+    vector<uint32_t> ids(v.size());
+    for (size_t i=0; i < v.size(); i++) ids[i] = str(v[i]);
+    put_vec(ids);
+  }
+
+  //one list of strings per element, stored as offsets into a flat list
+  void put_str_lists(const std::vector< const std::vector<std::string> * > & lists){
+    vector<uint32_t> offsets(1, 0);
+    vector<uint32_t> ids;
+    for (size_t i=0; i < lists.size(); i++){
+      for (size_t j=0; j < lists[i]->size(); j++) ids.push_back(str((*lists[i])[j]));
+      offsets.push_back(ids.size());
+    }
+    put_vec(offsets);
+    put_vec(ids);
+  }
+
+  bool write(std::string path, int64_t source_mtime, int64_t source_size){
+    vector<uint32_t> offsets(1, 0);
+    for (size_t i=0; i < strings_.size(); i++) offsets.push_back(offsets.back() + strings_[i].size());
+
+    string tmp_path = path + ".tmp";
+    FILE * f = fopen(tmp_path.c_str(), "wb");
+    if (f == NULL) return false;
+    fwrite(SCENE_FILE_MAGIC, 1, 8, f);
+    fwrite(&source_mtime, sizeof(source_mtime), 1, f);
+    fwrite(&source_size, sizeof(source_size), 1, f);
+    uint32_t n_strings = strings_.size();
+    fwrite(&n_strings, sizeof(n_strings), 1, f);
+    fwrite(&offsets[0], sizeof(uint32_t), offsets.size(), f);
+    for (size_t i=0; i < strings_.size(); i++) fwrite(strings_[i].data(), 1, strings_[i].size(), f);
+    if (body_.size() > 0) fwrite(&body_[0], 1, body_.size(), f);
+    bool write_failed = ferror(f);
+    fclose(f);
+    if (write_failed || rename(tmp_path.c_str(), path.c_str())){
+      remove(tmp_path.c_str());
+      return false;
+    }
+    return true;
+  }
+
+ private:
+  std::vector<char> body_;
+  std::vector<std::string> strings_;
+  std::unordered_map<std::string, uint32_t> string_ids_;
+};
+
+template <class T, class F> static std::vector<T> gather(size_t n, F f){
+  std::vector<T> v(n);
+  for (size_t i=0; i < n; i++) v[i] = f(i);
+  return v;
+}
+
+
+void compile_config_file(std::string config_file, std::string scene_file){
+  config_desc conf;
+  parse_config_file(config_file, conf);
+
+  int64_t source_mtime, source_size;
+  if (!get_file_stamp(config_file, source_mtime, source_size)) log_fatal("could not stat %s", config_file.c_str());
+
+  SceneWriter w;
+
+  //settings
+  w.put<int32_t>(conf.win_x_size);
+  w.put<int32_t>(conf.win_y_size);
+  w.put<int32_t>(conf.sub_sampling);
+  w.put<int32_t>(conf.num_layers);
+  w.put<int32_t>(conf.max_framerate);
+  w.put<int32_t>(conf.idle_framerate);
+  w.put<uint8_t>(conf.vsync);
+  w.put<uint32_t>(w.str(conf.geometry_cache_file));
+  w.put<uint32_t>(w.str(conf.control_socket));
+  w.put<uint32_t>(w.str(conf.fft_wisdom_file));
+  w.put<int32_t>(conf.max_num_plotted);
+  w.put<int32_t>(conf.dv_buffer_size);
+  w.put<int32_t>(conf.psd_segment_length);
+  w.put<float>(conf.psd_overlap);
+  w.put<float>(conf.psd_averaging);
+  w.put<uint64_t>(conf.min_max_update_interval);
+
+  //data vals
+  const vector<dataval_desc> & dvs = conf.dataval_descs;
+  w.put_vec(gather<uint32_t>(dvs.size(), [&](size_t i){return w.str(dvs[i].id);}));
+  w.put_vec(gather<float>(dvs.size(), [&](size_t i){return dvs[i].init_val;}));
+  w.put_vec(gather<uint8_t>(dvs.size(), [&](size_t i){return (uint8_t)dvs[i].is_buffered;}));
+
+  //data streamers, their descriptions are free form so they stay json
+  const vector<datastreamer_desc> & dss = conf.datastream_descs;
+  Json::FastWriter json_writer;
+  w.put_vec(gather<uint32_t>(dss.size(), [&](size_t i){return w.str(dss[i].tag);}));
+  w.put_vec(gather<uint32_t>(dss.size(), [&](size_t i){return w.str(dss[i].tp);}));
+  w.put_vec(gather<uint32_t>(dss.size(), [&](size_t i){return w.str(json_writer.write(dss[i].streamer_json_desc));}));
+  w.put_vec(gather<int32_t>(dss.size(), [&](size_t i){return dss[i].us_update_time;}));
+
+  //equations, compiling them here also checks them
+  vector<equation_desc> & eqs = conf.equation_descs;
+  vector<uint32_t> op_offsets(1, 0);
+  vector<uint8_t> op_kinds;
+  vector<int8_t> op_funcs;
+  vector<float> op_vals;
+  vector<uint32_t> op_dv_ids;
+  for (size_t i=0; i < eqs.size(); i++){
+    compile_equation_or_die(eqs[i].eq.c_str(), eqs[i].ops);
+    for (size_t j=0; j < eqs[i].ops.size(); j++){
+      const eq_op & op = eqs[i].ops[j];
+      op_kinds.push_back(op.kind);
+      op_funcs.push_back(op.func);
+      op_vals.push_back(op.val);
+      op_dv_ids.push_back(op.kind == EQ_OP_DATA_VAL ? w.str(op.dv_id) : SCENE_NO_STRING);
+    }
+    op_offsets.push_back(op_kinds.size());
+  }
+  w.put_vec(gather<uint32_t>(eqs.size(), [&](size_t i){return w.str(eqs[i].eq);}));
+  w.put_vec(gather<uint32_t>(eqs.size(), [&](size_t i){return w.str(eqs[i].cmap_id);}));
+  w.put_vec(gather<uint32_t>(eqs.size(), [&](size_t i){return w.str(eqs[i].label);}));
+  w.put_vec(gather<uint32_t>(eqs.size(), [&](size_t i){return w.str(eqs[i].display_label);}));
+  w.put_vec(gather<uint32_t>(eqs.size(), [&](size_t i){return w.str(eqs[i].sample_rate_id);}));
+  w.put_vec(gather<uint8_t>(eqs.size(), [&](size_t i){return (uint8_t)eqs[i].display_in_info_bar;}));
+  w.put_vec(gather<uint8_t>(eqs.size(), [&](size_t i){return (uint8_t)eqs[i].color_is_dynamic;}));
+  w.put_vec(op_offsets);
+  w.put_vec(op_kinds);
+  w.put_vec(op_funcs);
+  w.put_vec(op_vals);
+  w.put_vec(op_dv_ids);
+
+  //grid layers
+  const vector<grid_layer_desc> & gls = conf.grid_layer_descs;
+  w.put_vec(gather<uint32_t>(gls.size(), [&](size_t i){return w.str(gls[i].id);}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].x_origin;}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].y_origin;}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].cell_width;}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].cell_height;}));
+  w.put_vec(gather<int32_t>(gls.size(), [&](size_t i){return gls[i].n_x;}));
+  w.put_vec(gather<int32_t>(gls.size(), [&](size_t i){return gls[i].n_y;}));
+  w.put_vec(gather<int32_t>(gls.size(), [&](size_t i){return gls[i].layer;}));
+  w.put_vec(gather<uint32_t>(gls.size(), [&](size_t i){return w.str(gls[i].cmap_id);}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].cmap_min;}));
+  w.put_vec(gather<float>(gls.size(), [&](size_t i){return gls[i].cmap_max;}));
+  w.put_vec(gather<int32_t>(gls.size(), [&](size_t i){return gls[i].aggregation;}));
+
+  //spectral engine
+  const vector<spectral_band_desc> & sbs = conf.spectral_engine.bands;
+  w.put_vec(gather<uint32_t>(sbs.size(), [&](size_t i){return w.str(sbs[i].name);}));
+  w.put_vec(gather<float>(sbs.size(), [&](size_t i){return sbs[i].min_freq;}));
+  w.put_vec(gather<float>(sbs.size(), [&](size_t i){return sbs[i].max_freq;}));
+  w.put<uint8_t>(conf.spectral_engine.peak_freq);
+  w.put<float>(conf.spectral_engine.update_time);
+  w.put<int32_t>(conf.spectral_engine.n_threads);
+
+  //visual elements
+  const vector<vis_elem_repr> & ves = conf.vis_elems;
+  size_t n_ves = ves.size();
+  w.put_vec(gather<float>(n_ves, [&](size_t i){return ves[i].x_center;}));
+  w.put_vec(gather<float>(n_ves, [&](size_t i){return ves[i].y_center;}));
+  w.put_vec(gather<float>(n_ves, [&](size_t i){return ves[i].x_scale;}));
+  w.put_vec(gather<float>(n_ves, [&](size_t i){return ves[i].y_scale;}));
+  w.put_vec(gather<float>(n_ves, [&](size_t i){return ves[i].rotation;}));
+  w.put_vec(gather<int32_t>(n_ves, [&](size_t i){return ves[i].layer;}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].svg_path);}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].highlight_svg_path);}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].geo_id);}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].highlight_geo_id);}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].group);}));
+  w.put_vec(gather<uint32_t>(n_ves, [&](size_t i){return w.str(ves[i].grid_layer);}));
+  w.put_vec(gather<int32_t>(n_ves, [&](size_t i){return ves[i].grid_x;}));
+  w.put_vec(gather<int32_t>(n_ves, [&](size_t i){return ves[i].grid_y;}));
+  w.put_str_lists(gather<const vector<string>*>(n_ves, [&](size_t i){return &ves[i].labels;}));
+  w.put_str_lists(gather<const vector<string>*>(n_ves, [&](size_t i){return &ves[i].equations;}));
+  w.put_str_lists(gather<const vector<string>*>(n_ves, [&](size_t i){return &ves[i].labelled_data;}));
+  w.put_str_lists(gather<const vector<string>*>(n_ves, [&](size_t i){return &ves[i].labelled_data_vs;}));
+
+  //geometry references and the remaining lists
+  w.put_str_vec(conf.svg_ids);
+  w.put_str_vec(conf.svg_paths);
+  w.put_str_vec(conf.displayed_global_equations);
+  w.put_str_vec(conf.modifiable_data_vals);
+  w.put_str_vec(conf.command_lst);
+  w.put_str_vec(conf.command_label);
+  w.put_str_vec(conf.displayed_eq_labels);
+
+  if (!w.write(scene_file, source_mtime, source_size)) log_fatal("could not write scene file %s", scene_file.c_str());
+  log_notice("compiled %s into %s: %zu visual elements, %zu equations",
+	     config_file.c_str(), scene_file.c_str(), ves.size(), eqs.size());
+}
+
+
+/////////////////////
+// reading
+/////////////////////
+
+//every read is bounds checked, once one fails everything after it is zeroed
+class SceneReader{
+ public:
+  SceneReader(const char * data, size_t size) : data_(data), size_(size), pos_(0), ok_(true){}
+
+  bool ok(){return ok_;}
+
+  template <class T> T get(){
+    T v;
+    memset(&v, 0, sizeof(T));
+    if (!ok_ || size_ - pos_ < sizeof(T)){
+      ok_ = false;
+      return v;
+    }
+    memcpy(&v, data_ + pos_, sizeof(T));
+    pos_ += sizeof(T);
+    return v;
+  }
+
+  template <class T> void get_vec(std::vector<T> & v){
+    uint32_t n = get<uint32_t>();
+    if (!ok_ || (size_ - pos_) / sizeof(T) < n){
+      ok_ = false;
+      v.clear();
+      return;
+    }
+    v.resize(n);
+    if (n > 0) memcpy(&v[0], data_ + pos_, sizeof(T) * n);
+    pos_ += sizeof(T) * n;
+  }
+
+  //like get_vec but the length has to match a section read before
+  template <class T> void get_vec(std::vector<T> & v, size_t n){
+    get_vec(v);
+    if (v.size() != n){
+      ok_ = false;
+      v = std::vector<T>(n);
+    }
+  }
+
+  bool read_string_table(){
+    uint32_t n_strings = get<uint32_t>();
+    if (!ok_ || (size_ - pos_) / sizeof(uint32_t) <= n_strings) return ok_ = false;
+    offsets_.resize(n_strings + 1);
+    memcpy(&offsets_[0], data_ + pos_, sizeof(uint32_t) * (n_strings + 1));
+    pos_ += sizeof(uint32_t) * (n_strings + 1);
+    for (size_t i=0; i < n_strings; i++) if (offsets_[i] > offsets_[i+1]) return ok_ = false;
+    blob_ = data_ + pos_;
+    if (size_ - pos_ < offsets_.back()) return ok_ = false;
+    pos_ += offsets_.back();
+    return true;
+  }
+
+  std::string str(uint32_t id){
+    if ((size_t)id + 1 >= offsets_.size()){
+      ok_ = false;
+      return std::string();
+    }
+    return std::string(blob_ + offsets_[id], offsets_[id+1] - offsets_[id]);
+  }
+
+  std::string get_str(){return str(get<uint32_t>());}
+
+  void get_str_vec(std::vector<std::string> & v){
+    vector<uint32_t> ids;
+    get_vec(ids);
+    v.resize(ids.size());
+    for (size_t i=0; i < ids.size(); i++) v[i] = str(ids[i]);
+  }
+
+  void get_str_vec(std::vector<std::string> & v, size_t n){
+    get_str_vec(v);
+    if (v.size() != n){
+      ok_ = false;
+      v.resize(n);
+    }
+  }
+
+  void get_str_lists(std::vector< std::vector<std::string> * > lists){
+    vector<uint32_t> offsets;
+    vector<uint32_t> ids;
+    get_vec(offsets, lists.size() + 1);
+    get_vec(ids);
+    if (!ok_) return;
+    for (size_t i=0; i < lists.size(); i++){
+      if (offsets[i] > offsets[i+1] || offsets[i+1] > ids.size()){
+	ok_ = false;
+	return;
+      }
+      lists[i]->clear();
+      for (uint32_t j=offsets[i]; j < offsets[i+1]; j++) lists[i]->push_back(str(ids[j]));
+    }
+  }
+
+ private:
+  const char * data_;
+  size_t size_;
+  size_t pos_;
+  bool ok_;
+
+  std::vector<uint32_t> offsets_;
+  const char * blob_;
+};
+
+
+static bool read_scene(SceneReader & r, config_desc & conf){
+  //settings
+  conf.win_x_size = r.get<int32_t>();
+  conf.win_y_size = r.get<int32_t>();
+  conf.sub_sampling = r.get<int32_t>();
+  conf.num_layers = r.get<int32_t>();
+  conf.max_framerate = r.get<int32_t>();
+  conf.idle_framerate = r.get<int32_t>();
+  conf.vsync = r.get<uint8_t>();
+  conf.geometry_cache_file = r.get_str();
+  conf.control_socket = r.get_str();
+  conf.fft_wisdom_file = r.get_str();
+  conf.max_num_plotted = r.get<int32_t>();
+  conf.dv_buffer_size = r.get<int32_t>();
+  conf.psd_segment_length = r.get<int32_t>();
+  conf.psd_overlap = r.get<float>();
+  conf.psd_averaging = r.get<float>();
+  conf.min_max_update_interval = r.get<uint64_t>();
+
+  //data vals
+  vector<uint32_t> ids;
+  vector<float> fvals;
+  vector<uint8_t> flags;
+  r.get_vec(ids);
+  size_t n = ids.size();
+  conf.dataval_descs = vector<dataval_desc>(n);
+  for (size_t i=0; i < n; i++) conf.dataval_descs[i].id = r.str(ids[i]);
+  r.get_vec(fvals, n);
+  for (size_t i=0; i < n; i++) conf.dataval_descs[i].init_val = fvals[i];
+  r.get_vec(flags, n);
+  for (size_t i=0; i < n; i++) conf.dataval_descs[i].is_buffered = flags[i];
+
+  //data streamers
+  vector<uint32_t> ids2, ids3;
+  vector<int32_t> ivals;
+  r.get_vec(ids);
+  n = ids.size();
+  r.get_vec(ids2, n);
+  r.get_vec(ids3, n);
+  r.get_vec(ivals, n);
+  if (!r.ok()) return false;
+  conf.datastream_descs = vector<datastreamer_desc>(n);
+  Json::Reader json_reader;
+  for (size_t i=0; i < n; i++){
+    datastreamer_desc & dd = conf.datastream_descs[i];
+    dd.tag = r.str(ids[i]);
+    dd.tp = r.str(ids2[i]);
+    if (!json_reader.parse(r.str(ids3[i]), dd.streamer_json_desc)) return false;
+    dd.us_update_time = ivals[i];
+  }
+
+  //equations
+  vector< vector<uint32_t> > eq_strs(5);
+  r.get_vec(eq_strs[0]);
+  n = eq_strs[0].size();
+  for (size_t j=1; j < 5; j++) r.get_vec(eq_strs[j], n);
+  vector<uint8_t> flags2;
+  r.get_vec(flags, n);
+  r.get_vec(flags2, n);
+  vector<uint32_t> op_offsets;
+  vector<uint8_t> op_kinds;
+  vector<int8_t> op_funcs;
+  vector<float> op_vals;
+  vector<uint32_t> op_dv_ids;
+  r.get_vec(op_offsets, n + 1);
+  r.get_vec(op_kinds);
+  size_t n_ops = op_kinds.size();
+  r.get_vec(op_funcs, n_ops);
+  r.get_vec(op_vals, n_ops);
+  r.get_vec(op_dv_ids, n_ops);
+  if (!r.ok()) return false;
+  conf.equation_descs = vector<equation_desc>(n);
+  for (size_t i=0; i < n; i++){
+    equation_desc & ed = conf.equation_descs[i];
+    ed.eq = r.str(eq_strs[0][i]);
+    ed.cmap_id = r.str(eq_strs[1][i]);
+    ed.label = r.str(eq_strs[2][i]);
+    ed.display_label = r.str(eq_strs[3][i]);
+    ed.sample_rate_id = r.str(eq_strs[4][i]);
+    ed.display_in_info_bar = flags[i];
+    ed.color_is_dynamic = flags2[i];
+    if (op_offsets[i] > op_offsets[i+1] || op_offsets[i+1] > n_ops) return false;
+    for (uint32_t j=op_offsets[i]; j < op_offsets[i+1]; j++){
+      eq_op op;
+      op.kind = op_kinds[j];
+      op.func = op_funcs[j];
+      op.val = op_vals[j];
+      if (op.kind == EQ_OP_DATA_VAL) op.dv_id = r.str(op_dv_ids[j]);
+      ed.ops.push_back(op);
+    }
+  }
+
+  //grid layers
+  vector<float> fv[6];
+  vector<int32_t> iv[4];
+  r.get_vec(ids);
+  n = ids.size();
+  for (int j=0; j < 4; j++) r.get_vec(fv[j], n);
+  for (int j=0; j < 3; j++) r.get_vec(iv[j], n);
+  r.get_vec(ids2, n);
+  r.get_vec(fv[4], n);
+  r.get_vec(fv[5], n);
+  r.get_vec(iv[3], n);
+  if (!r.ok()) return false;
+  conf.grid_layer_descs = vector<grid_layer_desc>(n);
+  for (size_t i=0; i < n; i++){
+    grid_layer_desc & gd = conf.grid_layer_descs[i];
+    gd.id = r.str(ids[i]);
+    gd.x_origin = fv[0][i];
+    gd.y_origin = fv[1][i];
+    gd.cell_width = fv[2][i];
+    gd.cell_height = fv[3][i];
+    gd.n_x = iv[0][i];
+    gd.n_y = iv[1][i];
+    gd.layer = iv[2][i];
+    gd.cmap_id = r.str(ids2[i]);
+    gd.cmap_min = fv[4][i];
+    gd.cmap_max = fv[5][i];
+    gd.aggregation = iv[3][i];
+  }
+
+  //spectral engine
+  r.get_vec(ids);
+  n = ids.size();
+  r.get_vec(fv[0], n);
+  r.get_vec(fv[1], n);
+  if (!r.ok()) return false;
+  conf.spectral_engine.bands = vector<spectral_band_desc>(n);
+  for (size_t i=0; i < n; i++){
+    spectral_band_desc & sb = conf.spectral_engine.bands[i];
+    sb.name = r.str(ids[i]);
+    sb.min_freq = fv[0][i];
+    sb.max_freq = fv[1][i];
+  }
+  conf.spectral_engine.peak_freq = r.get<uint8_t>();
+  conf.spectral_engine.update_time = r.get<float>();
+  conf.spectral_engine.n_threads = r.get<int32_t>();
+
+  //visual elements
+  vector<float> vf[5];
+  vector<int32_t> vi[3];
+  vector<uint32_t> vs[6];
+  r.get_vec(vf[0]);
+  n = vf[0].size();
+  for (int j=1; j < 5; j++) r.get_vec(vf[j], n);
+  r.get_vec(vi[0], n);
+  for (int j=0; j < 6; j++) r.get_vec(vs[j], n);
+  r.get_vec(vi[1], n);
+  r.get_vec(vi[2], n);
+  if (!r.ok()) return false;
+  conf.vis_elems = vector<vis_elem_repr>(n);
+  for (size_t i=0; i < n; i++){
+    vis_elem_repr & ve = conf.vis_elems[i];
+    ve.x_center = vf[0][i];
+    ve.y_center = vf[1][i];
+    ve.x_scale = vf[2][i];
+    ve.y_scale = vf[3][i];
+    ve.rotation = vf[4][i];
+    ve.layer = vi[0][i];
+    ve.svg_path = r.str(vs[0][i]);
+    ve.highlight_svg_path = r.str(vs[1][i]);
+    ve.geo_id = r.str(vs[2][i]);
+    ve.highlight_geo_id = r.str(vs[3][i]);
+    ve.group = r.str(vs[4][i]);
+    ve.grid_layer = r.str(vs[5][i]);
+    ve.grid_x = vi[1][i];
+    ve.grid_y = vi[2][i];
+  }
+  r.get_str_lists(gather< vector<string>* >(n, [&](size_t i){return &conf.vis_elems[i].labels;}));
+  r.get_str_lists(gather< vector<string>* >(n, [&](size_t i){return &conf.vis_elems[i].equations;}));
+  r.get_str_lists(gather< vector<string>* >(n, [&](size_t i){return &conf.vis_elems[i].labelled_data;}));
+  r.get_str_lists(gather< vector<string>* >(n, [&](size_t i){return &conf.vis_elems[i].labelled_data_vs;}));
+
+  r.get_str_vec(conf.svg_ids);
+  r.get_str_vec(conf.svg_paths, conf.svg_ids.size());
+  r.get_str_vec(conf.displayed_global_equations);
+  r.get_str_vec(conf.modifiable_data_vals);
+  r.get_str_vec(conf.command_lst);
+  r.get_str_vec(conf.command_label, conf.command_lst.size());
+  r.get_str_vec(conf.displayed_eq_labels);
+  return r.ok();
+}
+
+
+bool read_scene_file(std::string scene_file, std::string config_file, config_desc & conf){
+  int fd = open(scene_file.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  struct stat st;
+  if (fstat(fd, &st) || st.st_size == 0){
+    close(fd);
+    return false;
+  }
+  size_t size = st.st_size;
+  void * mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (mapped == MAP_FAILED) return false;
+
+  SceneReader r((const char *) mapped, size);
+  bool ok = true;
+
+  char magic[8];
+  for (int i=0; i < 8; i++) magic[i] = r.get<char>();
+  int64_t source_mtime = r.get<int64_t>();
+  int64_t source_size = r.get<int64_t>();
+  if (!r.ok() || memcmp(magic, SCENE_FILE_MAGIC, 8)){
+    log_warn("%s is not a lyrebird scene file", scene_file.c_str());
+    ok = false;
+  }
+
+  int64_t cur_mtime, cur_size;
+  if (ok && get_file_stamp(config_file, cur_mtime, cur_size) &&
+      (cur_mtime != source_mtime || cur_size != source_size)){
+    log_notice("%s changed since %s was compiled, parsing the json", config_file.c_str(), scene_file.c_str());
+    ok = false;
+  }
+
+  if (ok && !(r.read_string_table() && read_scene(r, conf))){
+    log_warn("scene file %s is corrupt, parsing the json", scene_file.c_str());
+    ok = false;
+  }
+  munmap(mapped, size);
+  return ok;
+}
+
+
+std::string get_scene_file_path(std::string config_file){
+  return config_file + ".scene";
+}
+
+void load_config(std::string config_file, config_desc & conf){
+  std::string scene_file = get_scene_file_path(config_file);
+  if (file_exists(scene_file)){
+    config_desc scene_conf;
+    if (read_scene_file(scene_file, config_file, scene_conf)){
+      log_debug("using compiled scene file %s", scene_file.c_str());
+      conf = std::move(scene_conf);
+      return;
+    }
+  }
+  parse_config_file(config_file, conf);
+}
@@ -0,0 +1,29 @@
+#pragma once
+#include <string>
+
+#include "configparsing.h"
+
+/**
+   A compiled form of a json config made with lyrebird --compile-config.
+
+   The file is one string table that every name and path points into, followed
+   by the data vals, streamers, equations (already split and checked), grid
+   layers and visual elements stored as one array per field, and the unique
+   svg ids and paths.  It is mmapped and read straight into a config_desc so
+   startup skips jsoncpp and the per field validation.
+
+   The size and modification time of the json it came from are stored in it,
+   if the json no longer matches it is ignored and the json is parsed.
+ **/
+
+//the scene file that goes with a config, config.json -> config.json.scene
+std::string get_scene_file_path(std::string config_file);
+
+//parses config_file, compiles its equations and writes the scene file
+void compile_config_file(std::string config_file, std::string scene_file);
+
+//returns false if the scene file is missing, stale or unreadable
+bool read_scene_file(std::string scene_file, std::string config_file, config_desc & conf);
+
+//uses the scene file next to config_file when it is current, otherwise parses the json
+void load_config(std::string config_file, config_desc & conf);
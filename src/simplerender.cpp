@@ -14,6 +14,9 @@
 
 using namespace std;
 
+//vertices closer than this in position, uv and color get merged
+#define VERTEX_WELD_TOL 0.0005f
+
 
 glm::mat4 get_m_transmat(float x_center, float y_center, 
 			 float x_scale, float y_scale,
@@ -110,7 +113,12 @@ void main(){
 
 
 void SimpleRen::precalc_ren(){
-  l3_assert(!ren_precalced);
+  //called again after a config reload adds render states
+  if (ren_precalced){
+    glDeleteBuffers(4, elem_trans_gpu_buffer);
+    glDeleteBuffers(1, &elem_color_gpu_buffer);
+    unique_geos.clear();
+  }
   ren_precalced = true;
   n_ren_states = ren_wraps.size();
 
@@ -154,11 +162,22 @@ int SimpleRen::add_ren_state(render_state rs){
 				 rs.x_scale, rs.y_scale,
 				 rs.rotation, rs.layer);
   rw.color = glm::vec4(rs.col_r, rs.col_g, rs.col_b, rs.col_a );
+  if (free_ren_states_.size() > 0){
+    int ci = free_ren_states_.back();
+    free_ren_states_.pop_back();
+    ren_wraps[ci] = rw;
+    return ci;
+  }
   int ci = ren_wraps.size();
   ren_wraps.push_back(rw);
   return ci;
 }
 
+void SimpleRen::remove_ren_state(int ind){
+  ren_wraps[ind].is_drawn = false;
+  free_ren_states_.push_back(ind);
+}
+
 
 glm::mat4 SimpleRen::get_ms_transform(int ind){
   return ren_wraps[ind].m_transmat;
@@ -209,6 +228,11 @@ void SimpleRen::draw_ren_states(glm::mat4 view_matrix){
 		print_and_exit("after adding render state you need to cal precalcRen");
 	}
 	
+	//the grids go first so the highlights on top of them blend with their colors
+	for (size_t i = 0; i < heatmap_layers_.size(); i++){
+		heatmap_layers_[i]->draw(view_matrix);
+	}
+
 	glUseProgram(s_progID);
 	glUniformMatrix4fv(s_view_matID,  1, GL_FALSE, &view_matrix[0][0]);
 	
@@ -229,8 +253,9 @@ void SimpleRen::draw_ren_states(glm::mat4 view_matrix){
 				curInd++;
 			}
 		}
+		if (curInd == 0) continue;
 		//bind the vertices
-		int nverts = bind_buffer( cur_geo_id );
+		int nindices = bind_buffer( cur_geo_id );
 		
 		for (int taco = 0; taco<4; taco++){
 			glBindBuffer(GL_ARRAY_BUFFER, elem_trans_gpu_buffer[taco]);
@@ -278,7 +303,7 @@ void SimpleRen::draw_ren_states(glm::mat4 view_matrix){
 		glVertexAttribDivisor(s_mod_matID[3], 1);
 		
 		glVertexAttribDivisor(s_uni_colID, 1);
-		glDrawArraysInstanced(GL_TRIANGLES, 0, nverts, curInd);
+		glDrawElementsInstanced(GL_TRIANGLES, nindices, geo_info[cur_geo_id].index_type, (void*)0, curInd);
 		
 	}	 
 	unbind_buffer();
@@ -287,48 +312,47 @@ void SimpleRen::draw_ren_states(glm::mat4 view_matrix){
 
 
 int SimpleRen::load_def_geo(std::string id,
-				 std::vector < glm::vec2 > & in_vertices,
-				 std::vector < glm::vec2 > & uv_coordinates,
-				 std::vector < glm::vec4 > & color
+				 const std::vector < glm::vec2 > & in_vertices,
+				 const std::vector < glm::vec2 > & uv_coordinates,
+				 const std::vector < glm::vec4 > & color
 				 ){
 
-  if (in_vertices.size() != uv_coordinates.size() && in_vertices.size() != color.size() ){
+  if (in_vertices.size() != uv_coordinates.size() || in_vertices.size() != color.size() ){
     print_and_exit("SimpleRen::load_def_geo all vectors need to be the same size");
   }
-  std::vector< GLfloat > vertex_positions;
-  std::vector< GLfloat > uvs;
-  std::vector < GLfloat > colors;
-  std::vector < unsigned int > indices;
-  unsigned int cur_index = 0;
+  if (in_vertices.size() == 0){
+    log_fatal("SimpleRen::load_def_geo %s has no vertices", id.c_str());
+  }
 
-  //Load the data into a convenient format
   //check for redundant vertices
-  for(unsigned int i=0; i < in_vertices.size(); i++){
-    int vert_ind = get_vertex_index(vertex_positions, uvs, colors, 
-				    in_vertices[i], uv_coordinates[i],color[i]);
-
-    if (vert_ind == -1){
-      //cout<<"Xv: "<<in_vertices[i].x<<"  Yv: "<<in_vertices[i].y<<endl;
-
-      vertex_positions.push_back( in_vertices[i].x);
-      vertex_positions.push_back( in_vertices[i].y);
-      vertex_positions.push_back( 0.0f);
-
-      uvs.push_back(uv_coordinates[i].x);
-      uvs.push_back(uv_coordinates[i].y);
-
-      colors.push_back(color[i].r);
-      colors.push_back(color[i].g);
-      colors.push_back(color[i].b);
-      colors.push_back(color[i].a);
+  std::vector < glm::vec2 > welded_verts;
+  std::vector < glm::vec2 > welded_uvs;
+  std::vector < glm::vec4 > welded_colors;
+  std::vector < unsigned int > indices;
+  weld_vertices(in_vertices, uv_coordinates, color, VERTEX_WELD_TOL,
+		welded_verts, welded_uvs, welded_colors, indices);
 
-      indices.push_back(cur_index);
-      cur_index++;
-    } else{
-      indices.push_back(vert_ind);
-    }
+  //Load the data into a convenient format
+  std::vector< GLfloat > vertex_positions(3 * welded_verts.size());
+  std::vector< GLfloat > uvs(2 * welded_verts.size());
+  std::vector < GLfloat > colors(4 * welded_verts.size());
+  for (size_t i=0; i < welded_verts.size(); i++){
+    vertex_positions[3*i + 0] = welded_verts[i].x;
+    vertex_positions[3*i + 1] = welded_verts[i].y;
+    vertex_positions[3*i + 2] = 0.0f;
+    uvs[2*i + 0] = welded_uvs[i].x;
+    uvs[2*i + 1] = welded_uvs[i].y;
+    for (int j=0; j < 4; j++) colors[4*i + j] = welded_colors[i][j];
   }
 
+  //most shapes fit in 16 bit indices which halves the index bandwidth
+  GLenum index_type = GL_UNSIGNED_SHORT;
+  std::vector < GLushort > short_indices;
+  if (welded_verts.size() <= 0xffff){
+    short_indices = std::vector < GLushort >(indices.begin(), indices.end());
+  } else {
+    index_type = GL_UNSIGNED_INT;
+  }
 
   //Bind the buffer
   GLuint vertexArrayID;
@@ -342,7 +366,11 @@ int SimpleRen::load_def_geo(std::string id,
 
   glGenBuffers(1, &elementbuffer);
   glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, elementbuffer);
-  glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+  if (index_type == GL_UNSIGNED_SHORT){
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, short_indices.size() * sizeof(GLushort), &short_indices[0], GL_STATIC_DRAW);
+  } else {
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(unsigned int), &indices[0], GL_STATIC_DRAW);
+  }
 
   glGenBuffers(1, &vertexbuffer);
   glBindBuffer(GL_ARRAY_BUFFER, vertexbuffer);
@@ -369,10 +397,19 @@ int SimpleRen::load_def_geo(std::string id,
   store_info.vertexbuffer = vertexbuffer;
   store_info.colbuffer = colbuffer;
   store_info.elementbuffer = elementbuffer;
-  store_info.n_verts = indices.size();
+  store_info.n_indices = indices.size();
+  store_info.index_type = index_type;
     
 
-  int return_ind = geo_info.size();
+  //reloading a shape keeps its index so the render states using it stay valid
+  int return_ind = get_geo_index(id);
+  if (return_ind >= 0){
+    delete_buffer(return_ind);
+    geo_info[return_ind] = store_info;
+    return return_ind;
+  }
+
+  return_ind = geo_info.size();
   geo_info.push_back(store_info);
   geo_ids.push_back(id);
   geo_is_valid.push_back(true);
@@ -419,7 +456,7 @@ int SimpleRen::bind_buffer(int ind){
 			(void*)0            // array buffer offset 
 			);
 
-  return gi.n_verts;
+  return gi.n_indices;
 
 }
 
@@ -435,6 +472,7 @@ void SimpleRen::unbind_buffer(){
 void SimpleRen::delete_buffer(int ind)
 {
   geo_info_t gi = geo_info[ind];
+  glDeleteBuffers(1, &(gi.elementbuffer));
   glDeleteBuffers(1, &(gi.uvbuffer));
   glDeleteBuffers(1, &(gi.vertexbuffer));
   glDeleteBuffers(1, &(gi.colbuffer));
@@ -444,6 +482,8 @@ void SimpleRen::delete_buffer(int ind)
 void SimpleRen::clean_out_buffers(){
   for (size_t i=0; i < geo_info.size(); i++)
     delete_buffer(i);
+  for (size_t i=0; i < heatmap_layers_.size(); i++)
+    heatmap_layers_[i]->clean_out_buffers();
 }
 
 
@@ -475,34 +515,36 @@ int SimpleRen::load_square(){
 }
 
 
-int SimpleRen::get_vertex_index(vector<GLfloat> vertex_positions,
-				       vector<GLfloat> uvs,
-				       vector<GLfloat> colors,
-				       glm::vec2 vert, glm::vec2 uv, glm::vec4 color){
+int SimpleRen::load_svg_file(std::string id, std::string path, GeometryCache & geo_cache){
+  const svg_geometry & geo = geo_cache.get_svg(path);
+  return load_def_geo(id, geo.vertices, geo.uvs, geo.colors);
+}
 
-  for (unsigned int i = 0; i < uvs.size()/2; i++){
-    bool vert_eq = sloppy_eq( vert.x, vertex_positions[i*3]) && sloppy_eq( vert.y, vertex_positions[i*3+1]);
-    bool uv_eq = sloppy_eq( uv.x, uvs[i*2]) && sloppy_eq( uv.y, uvs[i*2+1]);
-    bool col_eq = ( sloppy_eq( color[0], colors[i*4]) && sloppy_eq( color[1], colors[i*4+1]) &&
-		    sloppy_eq( color[2], colors[i*4+2]) && sloppy_eq( color[3], colors[i*4+3]));
-    if (vert_eq && uv_eq && col_eq) return i;
-  }
+
+int SimpleRen::get_geo_index(std::string id){
+  for (size_t i = 0; i<geo_ids.size(); i++)
+    if (geo_ids[i] == id) return i;
   return -1;
+
 }
 
 
-int SimpleRen::load_svg_file(std::string id, std::string path){
-  std::vector < glm::vec2 > out_vertices;
-  std::vector < glm::vec2 > out_uvs;
-  std::vector < glm::vec4 > out_color;
-  con_svg_to_geo(path, 0.1,out_vertices,out_uvs, out_color );
-  return load_def_geo(id, out_vertices, out_uvs, out_color);
+int SimpleRen::add_heatmap_layer(grid_layer_desc desc){
+  if (get_heatmap_layer(desc.id) != NULL) log_fatal("grid layer %s added twice", desc.id.c_str());
+  heatmap_layers_.push_back(std::shared_ptr<HeatmapLayer>(new HeatmapLayer(desc)));
+  return heatmap_layers_.size() - 1;
 }
 
+HeatmapLayer * SimpleRen::get_heatmap_layer(std::string id){
+  for (size_t i = 0; i < heatmap_layers_.size(); i++)
+    if (heatmap_layers_[i]->get_id() == id) return heatmap_layers_[i].get();
+  return NULL;
+}
 
-int SimpleRen::get_geo_index(std::string id){
-  for (size_t i = 0; i<geo_ids.size(); i++)
-    if (geo_ids[i] == id) return i;
-  return -1;
+int SimpleRen::get_num_heatmap_layers(){
+  return heatmap_layers_.size();
+}
 
+HeatmapLayer * SimpleRen::get_heatmap_layer(int ind){
+  return heatmap_layers_[ind].get();
 }
@@ -3,10 +3,14 @@
 #include <vector>
 #include <unordered_map>
 #include <map>
+#include <memory>
 
 #include <GL/glew.h>
 #include "glm/glm.hpp"
 
+#include "heatmaplayer.h"
+#include "geometrycache.h"
+
 //stores all the addresses on the graphics card for things
 struct geo_info_t{
   GLuint vertex_arrayID;
@@ -14,7 +18,8 @@ struct geo_info_t{
   GLuint vertexbuffer;
   GLuint colbuffer;
   GLuint elementbuffer;
-  GLuint n_verts;
+  GLuint n_indices;
+  GLenum index_type;
 };
 
 
@@ -58,6 +63,8 @@ class SimpleRen{
   SimpleRen();
 
   int add_ren_state(render_state rs);
+  //the slot is reused by the next add_ren_state
+  void remove_ren_state(int ind);
 
   render_state get_ren_state(int ind);
   
@@ -84,11 +91,16 @@ class SimpleRen{
 
 
   int load_def_geo(std::string id,
-		 std::vector < glm::vec2 > & in_vertices,
-		 std::vector < glm::vec2 > & uv_coordinates,
-		 std::vector < glm::vec4 > & colors);
+		 const std::vector < glm::vec2 > & in_vertices,
+		 const std::vector < glm::vec2 > & uv_coordinates,
+		 const std::vector < glm::vec4 > & colors);
   int load_square();
-  int load_svg_file(std::string id, std::string path);
+  int load_svg_file(std::string id, std::string path, GeometryCache & geo_cache);
+
+  int add_heatmap_layer(grid_layer_desc desc);
+  HeatmapLayer * get_heatmap_layer(std::string id);
+  int get_num_heatmap_layers();
+  HeatmapLayer * get_heatmap_layer(int ind);
 
 
  private:
@@ -97,15 +109,14 @@ class SimpleRen{
 
 
   std::vector<ren_wrap> ren_wraps;
+  std::vector<int> free_ren_states_;
 
-  int get_vertex_index(std::vector<GLfloat> vertex_positions,
-		       std::vector<GLfloat> uvs,
-		       std::vector<GLfloat> colors,
-		       glm::vec2 vert, glm::vec2 uv, glm::vec4 color);
   std::vector<geo_info_t> geo_info;
   std::vector<std::string> geo_ids;
   std::vector<bool> geo_is_valid;
 
+  std::vector< std::shared_ptr<HeatmapLayer> > heatmap_layers_;
+
   bool ren_precalced;
 
   GLuint s_progID;
@@ -34,6 +34,8 @@
 #include <sys/socket.h>
 #include <netinet/in.h>
 #include <netdb.h> 
+#include <sys/un.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <fcntl.h>
 #include <stdlib.h>
@@ -158,6 +160,81 @@ cleanup_connect:
 
 
 
+int listen_on_address(const char * address, int & sockfd, std::string & unix_path) {
+	std::string addr_str(address);
+	unix_path.clear();
+	if (addr_str.compare(0, 5, "unix:") == 0) {
+		struct sockaddr_un serv_addr;
+		std::string path = addr_str.substr(5);
+		if (path.size() == 0 || path.size() >= sizeof(serv_addr.sun_path)) {
+			fprintf(stderr, "bad unix socket path %s\n", path.c_str());
+			return 1;
+		}
+		if ((sockfd = socket(AF_UNIX, SOCK_STREAM, 0)) < 0) {
+			perror("cannot create socket"); return 1;
+		}
+		memset(&serv_addr, 0, sizeof(serv_addr));
+		serv_addr.sun_family = AF_UNIX;
+		strncpy(serv_addr.sun_path, path.c_str(), sizeof(serv_addr.sun_path) - 1);
+		//a socket file left behind by an earlier run, anything else at the path is left alone
+		struct stat st;
+		if (lstat(path.c_str(), &st) == 0) {
+			if (!S_ISSOCK(st.st_mode)) {
+				fprintf(stderr, "%s exists and is not a socket\n", path.c_str());
+				goto cleanup_listen;
+			}
+			unlink(path.c_str());
+		}
+		if (bind(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+			perror("bind failed");
+			goto cleanup_listen;
+		}
+		unix_path = path;
+	} else if (addr_str.compare(0, 4, "tcp:") == 0) {
+		struct sockaddr_in serv_addr;
+		int reuse = 1;
+		size_t colon = addr_str.rfind(':');
+		if (colon <= 4) {
+			fprintf(stderr, "tcp address %s needs a port\n", address);
+			return 1;
+		}
+		std::string host = addr_str.substr(4, colon - 4);
+		int portno = atoi(addr_str.c_str() + colon + 1);
+		if ((sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
+			perror("cannot create socket"); return 1;
+		}
+		setsockopt(sockfd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+		if (fill_addr(host.c_str(), portno, serv_addr)) {
+			perror("ERROR getting hostname");
+			goto cleanup_listen;
+		}
+		if (bind(sockfd, (struct sockaddr *)&serv_addr, sizeof(serv_addr)) < 0) {
+			perror("bind failed");
+			goto cleanup_listen;
+		}
+	} else {
+		fprintf(stderr, "socket address %s does not start with unix: or tcp:\n", address);
+		return 1;
+	}
+
+	if (listen(sockfd, SOMAXCONN) < 0) {
+		perror("listen failed");
+		goto cleanup_listen;
+	}
+	if (fcntl(sockfd, F_SETFL, fcntl(sockfd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+		perror("fcntl failed");
+		goto cleanup_listen;
+	}
+	return 0;
+cleanup_listen:
+	close(sockfd);
+	if (unix_path.size() > 0) unlink(unix_path.c_str());
+	unix_path.clear();
+	return 1;
+}
+
+
+
 int initialize_socket_connection(const char * hostname, int portno, int timeout_us, int & sockfd) {
 	int return_val = 1;		
 	struct sockaddr_in serv_addr;
@@ -10,3 +10,6 @@ int initialize_socket_connection(const char * hostname, int portno,
 				 int timeout_us, int & sockfd);
 int get_string_list(int sockfd, std::vector<std::string> & strs);
 int bind_udp_socket(int & sockfd, const char * hostname, int portno);
+//address is unix:path or tcp:host:port, the socket is non blocking and
+//unix_path is set for unix sockets so the caller can unlink it
+int listen_on_address(const char * address, int & sockfd, std::string & unix_path);
@@ -0,0 +1,173 @@
+#include "sparklines.h"
+
+#include <math.h>
+#include <string>
+#include <algorithm>
+
+#include "shader.h"
+
+using namespace std;
+
+
+Sparklines::Sparklines(float sample_period)
+  : sample_period_(sample_period), next_sample_time_(0), is_sampling_(false),
+    n_tex_elems_(0), tex_rows_(0), head_(0), n_instances_(0), typical_width_(0){
+
+  string vertex_shader = R"(#version 330 core
+layout(location = 0) in vec4 box;
+layout(location = 1) in int elem;
+out float isSet;
+
+uniform mat4 MP;
+uniform sampler2DArray values;
+uniform int head;
+
+void main(){
+    //the oldest sample is at head, the line runs left to right inside the box
+    int layer = (head + gl_VertexID) % )" + to_string(SPARKLINE_SAMPLES) + R"(;
+    ivec3 texel = ivec3(elem % )" + to_string(SPARKLINE_TEX_WIDTH) + R"(, elem / )"
+    + to_string(SPARKLINE_TEX_WIDTH) + R"(, layer);
+    float v = texelFetch(values, texel, 0).r;
+    isSet = isnan(v) ? 0.0 : 1.0;
+    float t = float(gl_VertexID) / float()" + to_string(SPARKLINE_SAMPLES - 1) + R"();
+    vec2 p = vec2(t * 2.0 - 1.0, clamp(v, 0.0, 1.0) * 2.0 - 1.0) * 0.8;
+    gl_Position = MP * vec4(box.xy + box.zw * p, 0, 1);
+}
+)";
+
+  string fragment_shader = R"(#version 330 core
+in float isSet;
+out vec4 fragColor;
+uniform vec4 color;
+void main(){
+  if (isSet < 1.0) discard;
+  fragColor = color;
+}
+)";
+
+  prog_id_ = LoadShadersDef(vertex_shader, fragment_shader);
+  view_mat_id_ = glGetUniformLocation(prog_id_, "MP");
+  values_id_ = glGetUniformLocation(prog_id_, "values");
+  head_id_ = glGetUniformLocation(prog_id_, "head");
+  color_id_ = glGetUniformLocation(prog_id_, "color");
+  box_attrib_ = glGetAttribLocation(prog_id_, "box");
+  elem_attrib_ = glGetAttribLocation(prog_id_, "elem");
+
+  glGenBuffers(1, &box_buffer_);
+  glGenBuffers(1, &elem_buffer_);
+  glGenTextures(1, &value_texture_);
+
+  //the instance attributes live in their own vertex array so the others never see the divisors
+  GLint prev_vao;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prev_vao);
+  glGenVertexArrays(1, &vao_);
+  glBindVertexArray(vao_);
+  glEnableVertexAttribArray(box_attrib_);
+  glBindBuffer(GL_ARRAY_BUFFER, box_buffer_);
+  glVertexAttribPointer(box_attrib_, 4, GL_FLOAT, GL_FALSE, 0, (void*)0);
+  glVertexAttribDivisor(box_attrib_, 1);
+  glEnableVertexAttribArray(elem_attrib_);
+  glBindBuffer(GL_ARRAY_BUFFER, elem_buffer_);
+  glVertexAttribIPointer(elem_attrib_, 1, GL_INT, 0, (void*)0);
+  glVertexAttribDivisor(elem_attrib_, 1);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+  glBindVertexArray(prev_vao);
+}
+
+Sparklines::~Sparklines(){
+  glDeleteBuffers(1, &box_buffer_);
+  glDeleteBuffers(1, &elem_buffer_);
+  glDeleteTextures(1, &value_texture_);
+  glDeleteVertexArrays(1, &vao_);
+  glDeleteProgram(prog_id_);
+}
+
+void Sparklines::set_boxes(const std::vector<int> & elems, const std::vector<glm::vec2> & mins,
+			   const std::vector<glm::vec2> & maxs){
+  n_instances_ = elems.size();
+  instance_data_.resize(4 * n_instances_);
+  vector<float> widths(n_instances_);
+  for (int i=0; i < n_instances_; i++){
+    glm::vec2 c = (mins[i] + maxs[i]) * 0.5f;
+    glm::vec2 h = (maxs[i] - mins[i]) * 0.5f;
+    instance_data_[4*i] = c.x;
+    instance_data_[4*i + 1] = c.y;
+    instance_data_[4*i + 2] = h.x;
+    instance_data_[4*i + 3] = h.y;
+    widths[i] = 2 * h.x;
+  }
+  typical_width_ = 0;
+  if (n_instances_ > 0){
+    nth_element(widths.begin(), widths.begin() + n_instances_ / 2, widths.end());
+    typical_width_ = widths[n_instances_ / 2];
+  }
+
+  glBindBuffer(GL_ARRAY_BUFFER, box_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, instance_data_.size() * sizeof(GLfloat),
+	       n_instances_ ? &(instance_data_[0]) : NULL, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, elem_buffer_);
+  glBufferData(GL_ARRAY_BUFFER, elems.size() * sizeof(GLint), n_instances_ ? &(elems[0]) : NULL, GL_STATIC_DRAW);
+  glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void Sparklines::allocate_texture(size_t n_elems){
+  n_tex_elems_ = n_elems;
+  tex_rows_ = max((size_t)1, (n_elems + SPARKLINE_TEX_WIDTH - 1) / SPARKLINE_TEX_WIDTH);
+  head_ = 0;
+  //an empty history draws nothing until it fills in
+  vector<float> empty((size_t)SPARKLINE_TEX_WIDTH * tex_rows_ * SPARKLINE_SAMPLES, NAN);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, value_texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_R32F, SPARKLINE_TEX_WIDTH, tex_rows_, SPARKLINE_SAMPLES, 0,
+	       GL_RED, GL_FLOAT, &empty[0]);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+}
+
+void Sparklines::start_frame(double time){
+  is_sampling_ = time >= next_sample_time_;
+  if (is_sampling_) next_sample_time_ = time + sample_period_;
+}
+
+void Sparklines::begin_pass(size_t n_elems){
+  if (!is_sampling_) return;
+  if (n_elems != n_tex_elems_) allocate_texture(n_elems);
+  column_.assign((size_t)SPARKLINE_TEX_WIDTH * tex_rows_, NAN);
+}
+
+void Sparklines::end_pass(){
+  if (!is_sampling_) return;
+  is_sampling_ = false;
+  glBindTexture(GL_TEXTURE_2D_ARRAY, value_texture_);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+  glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, head_, SPARKLINE_TEX_WIDTH, tex_rows_, 1,
+		  GL_RED, GL_FLOAT, &column_[0]);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  head_ = (head_ + 1) % SPARKLINE_SAMPLES;
+}
+
+void Sparklines::draw(glm::mat4 view_matrix, glm::vec4 color){
+  if (n_instances_ == 0 || n_tex_elems_ == 0) return;
+  GLint prev_vao;
+  glGetIntegerv(GL_VERTEX_ARRAY_BINDING, &prev_vao);
+
+  glUseProgram(prog_id_);
+  glUniformMatrix4fv(view_mat_id_, 1, GL_FALSE, &view_matrix[0][0]);
+  glUniform4fv(color_id_, 1, &(color[0]));
+  //head_ is where the next sample goes, which is the oldest one
+  glUniform1i(head_id_, head_);
+  glActiveTexture(GL_TEXTURE0);
+  glBindTexture(GL_TEXTURE_2D_ARRAY, value_texture_);
+  glUniform1i(values_id_, 0);
+
+  //on top of the shapes they are drawn in
+  glDisable(GL_DEPTH_TEST);
+  glBindVertexArray(vao_);
+  glDrawArraysInstanced(GL_LINE_STRIP, 0, SPARKLINE_SAMPLES, n_instances_);
+  glBindVertexArray(prev_vao);
+  glEnable(GL_DEPTH_TEST);
+
+  glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+  glUseProgram(0);
+}
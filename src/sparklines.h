@@ -0,0 +1,77 @@
+#pragma once
+#include <vector>
+
+#include <GL/glew.h>
+#include "glm/glm.hpp"
+
+/**
+   A small line of the recent history of every drawn element inside its
+   shape, for when the view is zoomed in far enough for it to be read.
+
+   The history is the value the color map gets, so a line spans the shape from
+   the bottom of the color map range to the top.  Every sample_period seconds
+   the color pass hands over the values of every element, which go up as one
+   layer of an array texture.  The layers are a ring of SPARKLINE_SAMPLES, so
+   a new sample is one upload whatever the number of elements, and element i
+   sits at texel (i % SPARKLINE_TEX_WIDTH, i / SPARKLINE_TEX_WIDTH) of every
+   layer.
+
+   The boxes of the elements are a per instance buffer that only changes with
+   the set of drawn elements, and all the lines are one instanced draw of line
+   strips, the vertex shader looks its sample up in the ring.
+ **/
+
+#define SPARKLINE_SAMPLES 64
+#define SPARKLINE_TEX_WIDTH 1024
+
+class Sparklines{
+ public:
+  Sparklines(float sample_period);
+  ~Sparklines();
+
+  //the elements and their model space boxes, only changes to these are uploaded
+  void set_boxes(const std::vector<int> & elems, const std::vector<glm::vec2> & mins,
+		 const std::vector<glm::vec2> & maxs);
+  //the width of the boxes that half of them are narrower than
+  float get_typical_width(){return typical_width_;}
+
+  //decides whether the next color pass takes a sample
+  void start_frame(double time);
+
+  //called by the color pass
+  void begin_pass(size_t n_elems);
+  void add(size_t elem, float normalized_val){
+    if (is_sampling_) column_[elem] = normalized_val;
+  }
+  void end_pass();
+
+  void draw(glm::mat4 view_matrix, glm::vec4 color);
+
+ private:
+  Sparklines(const Sparklines&); //prevent copy construction
+  Sparklines& operator=(const Sparklines&); //prevent assignment
+
+  void allocate_texture(size_t n_elems);
+
+  float sample_period_;
+  double next_sample_time_;
+  bool is_sampling_;
+
+  std::vector<float> column_;
+  size_t n_tex_elems_;
+  int tex_rows_;
+  int head_;
+
+  int n_instances_;
+  float typical_width_;
+  std::vector<float> instance_data_;
+
+  GLuint prog_id_;
+  GLuint view_mat_id_, values_id_, head_id_, color_id_;
+  GLuint box_attrib_, elem_attrib_;
+
+  GLuint vao_;
+  GLuint box_buffer_;
+  GLuint elem_buffer_;
+  GLuint value_texture_;
+};
@@ -0,0 +1,135 @@
+#include "spectralengine.h"
+
+#include "psd.h"
+#include "logging.h"
+
+using namespace std;
+
+#define SPECTRAL_BATCH_SIZE 64
+
+
+int SpectralEngine::get_num_derived(const spectral_engine_desc & desc, int n_channels){
+  if (!is_enabled(desc)) return 0;
+  return n_channels * (desc.bands.size() + (desc.peak_freq ? 1 : 0));
+}
+
+SpectralEngine::SpectralEngine(const spectral_engine_desc & desc, DataVals * data_vals, FftPlanCache * fft_plans,
+			       int psd_segment_length, float psd_overlap)
+  : desc_(desc), data_vals_(data_vals), fft_plans_(fft_plans),
+    n_derived_(desc.bands.size() + (desc.peak_freq ? 1 : 0)), n_batches_(0),
+    next_batch_(0), n_busy_(0), is_stopping_(false){
+  int buffer_size = data_vals_->get_buffer_size();
+  segment_length_ = psd_segment_length > 0 ? psd_segment_length : buffer_size / 4;
+  overlap_ = psd_overlap;
+}
+
+SpectralEngine::~SpectralEngine(){
+  {
+    lock_guard<mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  cv_.notify_all();
+  for (size_t i=0; i < threads_.size(); i++) threads_[i].join();
+}
+
+void SpectralEngine::add_data_vals(){
+  channels_.clear();
+  derived_.clear();
+  int n_vals = data_vals_->get_num_added();
+  for (int i=0; i < n_vals; i++){
+    if (data_vals_->is_buffered(i)) channels_.push_back(i);
+  }
+  for (size_t i=0; i < channels_.size(); i++){
+    string id = data_vals_->get_id(channels_[i]);
+    for (size_t j=0; j < desc_.bands.size(); j++){
+      derived_.push_back(data_vals_->add_data_val(id + ":" + desc_.bands[j].name, 0, false, 0));
+    }
+    if (desc_.peak_freq) derived_.push_back(data_vals_->add_data_val(id + ":peak_freq", 0, false, 0));
+  }
+  n_batches_ = (channels_.size() + SPECTRAL_BATCH_SIZE - 1) / SPECTRAL_BATCH_SIZE;
+  log_notice("spectral engine covers %zu channels in %d batches", channels_.size(), n_batches_);
+}
+
+void SpectralEngine::start(){
+  if (n_batches_ == 0) return;
+  next_pass_time_ = chrono::steady_clock::now();
+  next_batch_ = n_batches_;
+  int n_threads = desc_.n_threads > 0 ? desc_.n_threads : 1;
+  for (int i=0; i < n_threads; i++) threads_.push_back(thread(&SpectralEngine::worker_loop, this));
+}
+
+void SpectralEngine::worker_loop(){
+  int buffer_size = data_vals_->get_buffer_size();
+  WelchPsd welch(fft_plans_, buffer_size, segment_length_, overlap_, SPECTRAL_BATCH_SIZE);
+  int n_bins = welch.get_num_bins();
+  vector<float> series((size_t)SPECTRAL_BATCH_SIZE * buffer_size);
+  vector<float> psd((size_t)SPECTRAL_BATCH_SIZE * n_bins);
+  vector<float> sample_rates(SPECTRAL_BATCH_SIZE);
+  vector<int> inds;
+  vector<int> live;
+
+  while (true){
+    int batch;
+    {
+      unique_lock<mutex> lock(mutex_);
+      while (!is_stopping_ && next_batch_ >= n_batches_){
+	//the last worker out of a pass starts the next one when it is due
+	if (n_busy_ == 0 && chrono::steady_clock::now() >= next_pass_time_){
+	  next_batch_ = 0;
+	  next_pass_time_ = chrono::steady_clock::now() +
+	    chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(desc_.update_time));
+	  cv_.notify_all();
+	  break;
+	}
+	if (n_busy_ == 0) cv_.wait_until(lock, next_pass_time_);
+	else cv_.wait(lock);
+      }
+      if (is_stopping_) return;
+      batch = next_batch_++;
+      n_busy_++;
+    }
+
+    size_t begin = (size_t)batch * SPECTRAL_BATCH_SIZE;
+    size_t end = min(begin + SPECTRAL_BATCH_SIZE, channels_.size());
+    inds.assign(channels_.begin() + begin, channels_.begin() + end);
+    data_vals_->get_buffers(inds, series.data());
+
+    //channels that haven't seen a sample yet have no sample rate or spectrum,
+    //the rest are packed to the front, welch runs its fixed plan once per channel
+    live.clear();
+    for (size_t i=0; i < inds.size(); i++){
+      float sample_rate = data_vals_->get_sample_rate(inds[i]);
+      if (sample_rate <= 0) continue;
+      if (live.size() != i) copy(series.begin() + i * buffer_size, series.begin() + (i+1) * buffer_size,
+				 series.begin() + live.size() * buffer_size);
+      sample_rates[live.size()] = sample_rate;
+      live.push_back(i);
+    }
+    welch.compute(series.data(), live.size(), sample_rates.data(), psd.data());
+
+    for (size_t l=0; l < live.size(); l++){
+      const float * p = psd.data() + l * n_bins;
+      float df = sample_rates[l] / welch.get_segment_length();
+      const int * out = derived_.data() + (begin + live[l]) * n_derived_;
+      for (size_t b=0; b < desc_.bands.size(); b++){
+	float power = 0;
+	for (int k=0; k < n_bins; k++){
+	  float f = k * df;
+	  if (f >= desc_.bands[b].min_freq && f <= desc_.bands[b].max_freq) power += p[k];
+	}
+	data_vals_->update_val(out[b], power * df);
+      }
+      if (desc_.peak_freq){
+	int peak = 1;
+	for (int k=2; k < n_bins; k++) if (p[k] > p[peak]) peak = k;
+	data_vals_->update_val(out[desc_.bands.size()], n_bins > 1 ? peak * df : 0);
+      }
+    }
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      n_busy_--;
+    }
+    cv_.notify_all();
+  }
+}
@@ -0,0 +1,84 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+#include "datavals.h"
+#include "fftplans.h"
+
+/**
+   Takes the spectra of every buffered data val in the background and
+   publishes numbers from them as new data vals, so equations and colormaps
+   can use them like any other.
+
+   For a buffered data val with id X it adds X:name for each band, the power
+   between min_freq and max_freq in units^2, and X:peak_freq, the frequency of
+   the largest bin above DC in Hz.
+
+   The channels are split into batches that worker threads take in turn.  Each
+   batch is copied out of the ring buffers at once and goes through the same
+   Welch spectra and cached plans as the plot panel.  Only the channels that
+   have a sample rate are transformed, and since the plan is per channel the
+   number of them never makes a new one.  A pass over every channel starts
+   every update_time seconds, or right away if the last one took longer.
+ **/
+
+struct spectral_band_desc{
+  std::string name;
+  float min_freq;
+  float max_freq;
+};
+
+struct spectral_engine_desc{
+  std::vector<spectral_band_desc> bands;
+  bool peak_freq;
+  float update_time;
+  int n_threads;
+};
+
+
+class SpectralEngine{
+ public:
+  SpectralEngine(const spectral_engine_desc & desc, DataVals * data_vals, FftPlanCache * fft_plans,
+		 int psd_segment_length, float psd_overlap);
+  ~SpectralEngine();
+
+  static bool is_enabled(const spectral_engine_desc & desc){return desc.bands.size() > 0 || desc.peak_freq;}
+  //how many data vals to register before DataVals::initialize so there is room
+  //for the derived ones of up to n_channels buffered channels
+  static int get_num_derived(const spectral_engine_desc & desc, int n_channels);
+
+  //adds the derived data vals, call once the data streamers have added theirs
+  void add_data_vals();
+  //starts the worker threads
+  void start();
+
+ private:
+  SpectralEngine(const SpectralEngine&); //prevent copy construction
+  SpectralEngine& operator=(const SpectralEngine&); //prevent assignment
+
+  void worker_loop();
+
+  spectral_engine_desc desc_;
+  DataVals * data_vals_;
+  FftPlanCache * fft_plans_;
+  int segment_length_;
+  float overlap_;
+
+  //the buffered channels and, per channel, the band data vals then the peak one
+  std::vector<int> channels_;
+  std::vector<int> derived_;
+  int n_derived_;
+  int n_batches_;
+
+  std::vector<std::thread> threads_;
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  int next_batch_;
+  int n_busy_;
+  bool is_stopping_;
+  std::chrono::steady_clock::time_point next_pass_time_;
+};
@@ -0,0 +1,120 @@
+#include "threadpool.h"
+
+#include "logging.h"
+
+using namespace std;
+
+
+StageTimer::StageTimer() : t0_(chrono::steady_clock::now()){}
+
+double StageTimer::now(){
+  return chrono::duration<double>(chrono::steady_clock::now() - t0_).count();
+}
+
+void StageTimer::record(std::string stage, double start_time, double end_time){
+  lock_guard<mutex> lock(mutex_);
+  for (size_t i=0; i < stages_.size(); i++){
+    stage_time & st = stages_[i];
+    if (st.name != stage) continue;
+    if (start_time < st.first_start) st.first_start = start_time;
+    if (end_time > st.last_end) st.last_end = end_time;
+    st.busy += end_time - start_time;
+    st.n_tasks++;
+    return;
+  }
+  stage_time st = {stage, start_time, end_time, end_time - start_time, 1};
+  stages_.push_back(st);
+}
+
+void StageTimer::report(){
+  lock_guard<mutex> lock(mutex_);
+  log_notice("startup timing, total %.1f ms", 1000.0 * now());
+  for (size_t i=0; i < stages_.size(); i++){
+    const stage_time & st = stages_[i];
+    if (st.n_tasks == 1){
+      log_notice("  %-28s %8.1f ms", st.name.c_str(), 1000.0 * st.busy);
+    } else {
+      //for pooled stages the span is what startup actually waited on
+      log_notice("  %-28s %8.1f ms span, %8.1f ms busy over %d tasks",
+		 st.name.c_str(), 1000.0 * (st.last_end - st.first_start),
+		 1000.0 * st.busy, st.n_tasks);
+    }
+  }
+}
+
+
+ThreadPool::ThreadPool(int n_threads, StageTimer * timer)
+  : timer_(timer), n_unfinished_(0), is_stopping_(false){
+  if (n_threads <= 0) n_threads = thread::hardware_concurrency();
+  if (n_threads <= 0) n_threads = 1;
+  for (int i=0; i < n_threads; i++){
+    threads_.push_back(thread(&ThreadPool::worker_loop, this));
+  }
+}
+
+ThreadPool::~ThreadPool(){
+  {
+    lock_guard<mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  task_cv_.notify_all();
+  for (size_t i=0; i < threads_.size(); i++) threads_[i].join();
+}
+
+void ThreadPool::submit(std::string stage, std::function<void()> task){
+  {
+    lock_guard<mutex> lock(mutex_);
+    pool_task pt = {stage, task};
+    tasks_.push_back(pt);
+    n_unfinished_++;
+  }
+  task_cv_.notify_one();
+}
+
+void ThreadPool::submit_range(std::string stage, size_t n, size_t chunk_size,
+			      std::function<void(size_t, size_t)> func){
+  if (chunk_size == 0) chunk_size = 1;
+  for (size_t begin=0; begin < n; begin += chunk_size){
+    size_t end = begin + chunk_size < n ? begin + chunk_size : n;
+    submit(stage, [func, begin, end](){ func(begin, end); });
+  }
+}
+
+void ThreadPool::wait(){
+  unique_lock<mutex> lock(mutex_);
+  done_cv_.wait(lock, [this](){ return n_unfinished_ == 0; });
+  if (first_error_){
+    exception_ptr err = first_error_;
+    first_error_ = exception_ptr();
+    rethrow_exception(err);
+  }
+}
+
+void ThreadPool::worker_loop(){
+  while (true){
+    pool_task pt;
+    {
+      unique_lock<mutex> lock(mutex_);
+      task_cv_.wait(lock, [this](){ return is_stopping_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      pt = tasks_.front();
+      tasks_.pop_front();
+    }
+
+    double start = timer_ ? timer_->now() : 0;
+    exception_ptr err;
+    try {
+      pt.func();
+    } catch (...) {
+      err = current_exception();
+    }
+    if (timer_) timer_->record(pt.stage, start, timer_->now());
+
+    {
+      lock_guard<mutex> lock(mutex_);
+      if (err && !first_error_) first_error_ = err;
+      n_unfinished_--;
+      if (n_unfinished_ == 0) done_cv_.notify_all();
+    }
+  }
+}
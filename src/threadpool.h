@@ -0,0 +1,92 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <exception>
+
+/**
+   A small fixed size pool of worker threads for the cpu only parts of startup.
+
+   Every task is tagged with a stage name and the time spent in it is added to
+   that stage of the StageTimer, so the startup report shows how long each
+   stage kept the workers busy and when its last task finished.
+
+   If a task throws (log_fatal does) the first exception is handed back to the
+   thread calling wait().
+ **/
+
+class StageTimer{
+ public:
+  StageTimer();
+
+  //seconds since the timer was made
+  double now();
+
+  //can be called from any thread
+  void record(std::string stage, double start_time, double end_time);
+
+  //logs every stage in the order it was first recorded
+  void report();
+
+ private:
+  StageTimer(const StageTimer&); //prevent copy construction
+  StageTimer& operator=(const StageTimer&); //prevent assignment
+
+  struct stage_time{
+    std::string name;
+    double first_start;
+    double last_end;
+    double busy;
+    int n_tasks;
+  };
+
+  std::chrono::steady_clock::time_point t0_;
+  std::mutex mutex_;
+  std::vector<stage_time> stages_;
+};
+
+
+class ThreadPool{
+ public:
+  //n_threads <= 0 uses one thread per core, timer may be NULL
+  ThreadPool(int n_threads, StageTimer * timer);
+  ~ThreadPool();
+
+  void submit(std::string stage, std::function<void()> task);
+
+  //splits [0, n) into chunks of chunk_size and calls func(begin, end) on each
+  void submit_range(std::string stage, size_t n, size_t chunk_size,
+		    std::function<void(size_t, size_t)> func);
+
+  //blocks until everything submitted so far is done
+  void wait();
+
+  int get_num_threads(){return threads_.size();}
+
+ private:
+  ThreadPool(const ThreadPool&); //prevent copy construction
+  ThreadPool& operator=(const ThreadPool&); //prevent assignment
+
+  struct pool_task{
+    std::string stage;
+    std::function<void()> func;
+  };
+
+  void worker_loop();
+
+  StageTimer * timer_;
+  std::vector<std::thread> threads_;
+  std::deque<pool_task> tasks_;
+  size_t n_unfinished_;
+  bool is_stopping_;
+  std::exception_ptr first_error_;
+
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+};
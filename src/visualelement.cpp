@@ -1,205 +1,318 @@
 #include "visualelement.h"
 #include <algorithm>
+#include <unordered_set>
 #include <string.h>
 
 #include "genericutils.h"
 #include "logging.h"
+#include "histogram.h"
+#include "ranking.h"
+#include "sparklines.h"
 
 using namespace std;
 using namespace glm;
 
-VisElem::VisElem(SimpleRen * simple_ren, EquationMap * eqs,
-		 vis_elem_repr v
-		 ){
 
-  s_ren = simple_ren;
+uint32_t StringPool::intern(const std::string & s){
+  auto it = ids_.find(s);
+  if (it != ids_.end()) return it->second;
+  uint32_t id = strs_.size();
+  strs_.push_back(s);
+  ids_[s] = id;
+  return id;
+}
 
-  int geo_index = s_ren->get_geo_index(v.geo_id);
-  render_state rs = get_empty_ren_state();
 
+VisElemStore::VisElemStore(SimpleRen * simple_ren, EquationMap * eqs)
+  : s_ren_(simple_ren), equation_map_(eqs), highlight_time_(0), histogram_(NULL), ranking_(NULL), sparklines_(NULL), drawn_epoch_(0){}
+
+int VisElemStore::add(vis_elem_repr v){
+  size_t i = size();
+  drawn_epoch_++;
+  ren_index_.push_back(-1);
+  highlight_index_.push_back(-1);
+  geo_id_.push_back(0);
+  layer_.push_back(0);
+  group_.push_back(0);
+  eq_ind_.push_back(0);
+  flags_.push_back(0);
+  grid_layer_.push_back(-1);
+  grid_x_.push_back(-1);
+  grid_y_.push_back(-1);
+  eq_begin_.push_back(0);
+  eq_count_.push_back(0);
+  label_begin_.push_back(0);
+  label_count_.push_back(0);
+  tag_begin_.push_back(0);
+  tag_count_.push_back(0);
+  set_elem(i, v);
+  return i;
+}
+
+void VisElemStore::replace(size_t i, vis_elem_repr v){
+  //the old label and equation ranges are left behind, they only pile up on config reloads
+  drawn_epoch_++;
+  set_elem(i, v);
+}
+
+uint32_t VisElemStore::append_strings(const std::vector<std::string> & strs, std::vector<uint32_t> & ids){
+  uint32_t begin = ids.size();
+  for (size_t j=0; j < strs.size(); j++) ids.push_back(pool_.intern(strs[j]));
+  return begin;
+}
+
+void VisElemStore::set_elem(size_t i, const vis_elem_repr & v){
+  if (v.labels.size() == 0){
+    log_fatal("Vis elem with no label");
+  }
+
+  render_state rs = get_empty_ren_state();
   rs.x_center = v.x_center;
   rs.y_center = v.y_center;
   rs.x_scale = v.x_scale;
   rs.y_scale = v.y_scale;
   rs.rotation = v.rotation;
   rs.layer = v.layer;
-  rs.geo_index = geo_index;  
-  simple_ren_index_ = s_ren->add_ren_state(rs);  
 
-  if (v.labels.size() == 0){
-    log_fatal("Vis elem with no label");
+  HeatmapLayer * heatmap = NULL;
+  grid_layer_[i] = -1;
+  grid_x_[i] = -1;
+  grid_y_[i] = -1;
+  if (v.grid_layer.size() > 0){
+    heatmap = s_ren_->get_heatmap_layer(v.grid_layer);
+    if (heatmap == NULL) log_fatal("Vis elem uses unknown grid layer %s", v.grid_layer.c_str());
+    size_t gl = find(grid_layers_.begin(), grid_layers_.end(), heatmap) - grid_layers_.begin();
+    if (gl == grid_layers_.size()) grid_layers_.push_back(heatmap);
+    grid_layer_[i] = gl;
+    grid_x_[i] = v.grid_x;
+    grid_y_[i] = v.grid_y;
+    glm::vec2 cell_center = heatmap->get_cell_center(v.grid_x, v.grid_y);
+    rs.x_center = cell_center.x;
+    rs.y_center = cell_center.y;
+    rs.layer = heatmap->get_layer();
+    ren_index_[i] = -1;
+  } else {
+    rs.geo_index = s_ren_->get_geo_index(v.geo_id);
+    ren_index_[i] = s_ren_->add_ren_state(rs);
   }
-
-
-  //set all our labels
-  //v.labels;
-  labels = vector<string>(v.labels.size());
-  for (size_t i=0; i < v.labels.size(); i++)labels[i] = v.labels[i];
-
-  group_ = v.group;
-  l_data_labels = vector<string>(v.labelled_data.size());
-  l_data_vals = vector<string>(v.labelled_data.size());
-
-  for (size_t i=0; i < v.labelled_data.size(); i++){
-    l_data_labels[i] = v.labelled_data[i];
-    l_data_vals[i] = v.labelled_data_vs[i];
+  layer_[i] = rs.layer;
+
+  label_begin_[i] = append_strings(v.labels, label_ids_);
+  label_count_[i] = v.labels.size();
+  group_[i] = pool_.intern(v.group);
+  tag_begin_[i] = append_strings(v.labelled_data, tag_label_ids_);
+  for (size_t j=0; j < v.labelled_data.size(); j++){
+    tag_val_ids_.push_back(pool_.intern(v.labelled_data_vs[j]));
   }
-
-  layer_ = v.layer;
-  int highlight_geo_index = s_ren->get_geo_index(v.highlight_geo_id);
-
-  hXScale = rs.x_scale;  
-  hYScale = rs.y_scale;
-  hTDelt = 0;
-
-  rs.layer = -10;
-  rs.geo_index = highlight_geo_index;
-  highlight_index_ = s_ren->add_ren_state(rs);
-  geo_id_ = v.geo_id;
-
-
-  equation_map_ = eqs;
-  equation_inds_ = std::vector<int>(v.equations.size());
-
-  for (size_t i=0; i < v.equations.size(); i++){
-    equation_inds_[i] = equation_map_->get_eq_index(v.equations[i]);
+  tag_count_[i] = v.labelled_data.size();
+
+  //a highlight behind a grid cell would be hidden by its neighbours, so it
+  //goes on top and is partially transparent
+  rs.layer = heatmap != NULL ? layer_[i] + 1 : -10;
+  rs.geo_index = s_ren_->get_geo_index(v.highlight_geo_id);
+  highlight_index_[i] = s_ren_->add_ren_state(rs);
+  geo_id_[i] = pool_.intern(v.geo_id);
+
+  eq_begin_[i] = eq_inds_.size();
+  eq_count_[i] = v.equations.size();
+  for (size_t j=0; j < v.equations.size(); j++){
+    eq_inds_.push_back(equation_map_->get_eq_index(v.equations[j]));
   }
-  has_eq_ = true;
-  eq_ind_ = 0;
+  eq_ind_[i] = 0;
 
-  set_drawn();
-  update_color(0);
-  is_highlighted_ = false;
+  flags_[i] = 0;
+  set_drawn(i);
+  update_color(i, 0);
 }
 
-void VisElem::set_eq_ind(unsigned int ind){
-	if (ind < equation_inds_.size())
-		eq_ind_ = ind;
-	else
-		eq_ind_ = 0;
+void VisElemStore::remove_from_renderer(size_t i){
+  HeatmapLayer * heatmap = get_heatmap_layer(i);
+  if (heatmap != NULL) heatmap->set_cell_drawn(grid_x_[i], grid_y_[i], false);
+  if (ren_index_[i] >= 0) s_ren_->remove_ren_state(ren_index_[i]);
+  s_ren_->remove_ren_state(highlight_index_[i]);
+  ren_index_[i] = -1;
+  highlight_index_[i] = -1;
+  flags_[i] = 0;
 }
 
-int VisElem::get_num_eqs(){
-  return equation_inds_.size();
+void VisElemStore::truncate(size_t n){
+  if (n >= size()) return;
+  drawn_epoch_++;
+  ren_index_.resize(n);
+  highlight_index_.resize(n);
+  geo_id_.resize(n);
+  layer_.resize(n);
+  group_.resize(n);
+  eq_ind_.resize(n);
+  flags_.resize(n);
+  grid_layer_.resize(n);
+  grid_x_.resize(n);
+  grid_y_.resize(n);
+  eq_begin_.resize(n);
+  eq_count_.resize(n);
+  label_begin_.resize(n);
+  label_count_.resize(n);
+  tag_begin_.resize(n);
+  tag_count_.resize(n);
 }
 
-int VisElem::get_layer(){
-  return layer_;
-}
 
-void VisElem::set_drawn(){
-  s_ren->set_drawn(simple_ren_index_);
+void VisElemStore::set_eq_ind(unsigned int ind){
+  for (size_t i=0; i < size(); i++){
+    eq_ind_[i] = ind < eq_count_[i] ? ind : 0;
+  }
 }
 
-void VisElem::set_not_drawn(){
-  s_ren->set_not_drawn(simple_ren_index_);
+void VisElemStore::set_drawn(size_t i){
+  drawn_epoch_++;
+  flags_[i] |= VE_DRAWN;
+  HeatmapLayer * heatmap = get_heatmap_layer(i);
+  if (heatmap != NULL) heatmap->set_cell_drawn(grid_x_[i], grid_y_[i], true);
+  else s_ren_->set_drawn(ren_index_[i]);
 }
 
-bool VisElem::is_drawn(){
-  return s_ren->is_drawn(simple_ren_index_);
+void VisElemStore::set_not_drawn(size_t i){
+  drawn_epoch_++;
+  flags_[i] &= ~VE_DRAWN;
+  HeatmapLayer * heatmap = get_heatmap_layer(i);
+  if (heatmap != NULL) heatmap->set_cell_drawn(grid_x_[i], grid_y_[i], false);
+  else s_ren_->set_not_drawn(ren_index_[i]);
 }
 
+void VisElemStore::set_group_drawn(std::string group, bool drawn){
+  uint32_t gid = pool_.intern(group);
+  for (size_t i=0; i < size(); i++){
+    if (group_[i] != gid) continue;
+    if (drawn) set_drawn(i);
+    else set_not_drawn(i);
+  }
+}
 
-void VisElem::set_highlighted(glm::vec3 color){
-  is_highlighted_ = true;
-  s_ren->set_drawn(highlight_index_);
-  s_ren->set_color( highlight_index_, vec4(color, 1) );
+std::vector<std::string> VisElemStore::get_groups() const{
+  std::vector<std::string> groups;
+  std::unordered_set<uint32_t> seen;
+  for (size_t i=0; i < size(); i++){
+    if (seen.insert(group_[i]).second) groups.push_back(pool_.get(group_[i]));
+  }
+  return groups;
 }
 
-void VisElem::set_not_highlighted(){
-  is_highlighted_ = false;
-  s_ren->set_not_drawn(highlight_index_);
 
+void VisElemStore::set_highlighted(size_t i, glm::vec3 color){
+  flags_[i] |= VE_HIGHLIGHTED;
+  float alpha = grid_layer_[i] >= 0 ? 0.5 : 1;
+  s_ren_->set_drawn(highlight_index_[i]);
+  s_ren_->set_color(highlight_index_[i], vec4(color, alpha));
 }
 
-void VisElem::animate_highlight(float tstep){
-  hTDelt += tstep;
-  /**
-  s_ren->set_scale(highlight_index_,  
-		 (1 + .05*cos(15*hTDelt)) * hXScale,
-		 (1 + .05*cos(15*hTDelt)) * hYScale);
-  **/
-  if (is_highlighted_){
-    if (fmod(hTDelt, 1) > .25 )
-      s_ren->set_drawn(highlight_index_);      
-    else
-      s_ren->set_not_drawn(highlight_index_);
+void VisElemStore::set_not_highlighted(size_t i){
+  flags_[i] &= ~VE_HIGHLIGHTED;
+  s_ren_->set_not_drawn(highlight_index_[i]);
+}
 
+void VisElemStore::animate_highlights(float tstep){
+  highlight_time_ += tstep;
+  bool blink_on = fmod(highlight_time_, 1) > .25;
+  for (size_t i=0; i < size(); i++){
+    if (!(flags_[i] & VE_HIGHLIGHTED)) continue;
+    if (blink_on)
+      s_ren_->set_drawn(highlight_index_[i]);
+    else
+      s_ren_->set_not_drawn(highlight_index_[i]);
   }
 }
 
-glm::mat4 VisElem::get_ms_transform(){
-  return s_ren->get_ms_transform(simple_ren_index_);
+glm::mat4 VisElemStore::get_ms_transform(size_t i){
+  if (ren_index_[i] < 0) return s_ren_->get_ms_transform(highlight_index_[i]);
+  return s_ren_->get_ms_transform(ren_index_[i]);
 }
 
-std::string VisElem::get_geo_id(){
-  return geo_id_;
+Equation & VisElemStore::get_current_equation(size_t i){
+  l3_assert(eq_count_[i] > 0);
+  return equation_map_->get_eq(eq_inds_[eq_begin_[i] + eq_ind_[i]]);
 }
 
-Equation & VisElem::get_current_equation(){
-  l3_assert(equation_inds_.size() > 0);
-  return equation_map_->get_eq(equation_inds_[eq_ind_]);
+float VisElemStore::update_color(size_t i, size_t index){
+  Equation & eq = get_current_equation(i);
+  float val = eq.get_normalized_value(index);
+  HeatmapLayer * heatmap = get_heatmap_layer(i);
+  if (heatmap != NULL){
+    heatmap->set_value(grid_x_[i], grid_y_[i], val);
+    return val;
+  }
+  s_ren_->set_color(ren_index_[i], eq.cmap(val));
+  return val;
 }
 
-void VisElem::update_color(size_t index){
-  l3_assert(has_eq_);
-  glm::vec4 col = get_current_equation().get_color(index);
-  s_ren->set_color(simple_ren_index_, col );
+void VisElemStore::update_layer_cmaps(){
+  size_t n_left = grid_layers_.size();
+  vector<char> is_set(n_left, 0);
+  for (size_t i=0; i < size() && n_left > 0; i++){
+    int gl = grid_layer_[i];
+    if (gl < 0 || is_set[gl]) continue;
+    is_set[gl] = 1;
+    n_left--;
+    grid_layers_[gl]->set_cmap(get_current_equation(i).cmap);
+  }
 }
 
+void VisElemStore::update_colors(size_t frame, size_t update_freq){
+  size_t n = size();
+  update_layer_cmaps();
+  if (histogram_ == NULL && ranking_ == NULL && sparklines_ == NULL){
+    for (size_t i=0; i < n; i++) {
+      size_t not_updated = !(frame == ((i*update_freq)/n));
+      update_color(i, not_updated);
+    }
+    return;
+  }
 
-void VisElem::update_all_equations(){
-  for (size_t i=0; i<equation_inds_.size();i++){
-    equation_map_->get_eq(equation_inds_[i]).get_value();
-  } 
-}
-
-bool VisElem::string_matches_labels(const char * pattern){
-  for (size_t i=0; i < labels.size(); i++){
-    if (is_glob_match(pattern, labels[i])) return true;
+  //the value is still cached in the equation after the color is computed
+  if (histogram_ != NULL) histogram_->begin_pass(n);
+  if (ranking_ != NULL) ranking_->begin_pass(n);
+  if (sparklines_ != NULL) sparklines_->begin_pass(n);
+  for (size_t i=0; i < n; i++) {
+    size_t not_updated = !(frame == ((i*update_freq)/n));
+    float normalized = update_color(i, not_updated);
+    if (!(flags_[i] & VE_DRAWN)) continue;
+    if (sparklines_ != NULL) sparklines_->add(i, normalized);
+    float val = *(get_current_equation(i).get_value_address());
+    if (histogram_ != NULL) histogram_->add(i, val);
+    if (ranking_ != NULL) ranking_->add(i, val);
   }
-  return false;
+  if (histogram_ != NULL) histogram_->end_pass();
+  if (ranking_ != NULL) ranking_->end_pass();
+  if (sparklines_ != NULL) sparklines_->end_pass();
 }
 
 
-
-bool VisElem::string_matches_labels_quick(const char * pattern){
-	for (size_t i=0; i < labels.size(); i++){
-		if (! strcmp(pattern, labels[i].c_str())) return true;
-	}
-	return false;
+void VisElemStore::update_all_equations(size_t i){
+  for (size_t j=0; j < eq_count_[i]; j++){
+    equation_map_->get_eq(eq_inds_[eq_begin_[i] + j]).get_value();
+  }
 }
 
-void VisElem::get_all_info(std::vector<string> & ai_labels, std::vector<string> & ai_tags,
-			   std::vector<string*> & ai_tag_vals,
-			   std::vector<string> & ai_eq_labels,  std::vector<float*> & ai_eq_addrs
-			  ){
-  l3_assert(labels.size() > 0);
-  ai_labels = std::vector<string>(labels);
-  l3_assert(ai_labels.size() > 0);
-  ai_tags = std::vector<string>(l_data_labels);
-  ai_tag_vals = std::vector<string*>(l_data_vals.size(), NULL);
-  for (size_t i=0; i < l_data_vals.size(); i++){
-    ai_tag_vals[i] = &(l_data_vals[i]);
+void VisElemStore::get_all_info(size_t i, std::vector<string> & ai_labels, std::vector<string> & ai_tags,
+				std::vector<string*> & ai_tag_vals,
+				std::vector<string> & ai_eq_labels,  std::vector<float*> & ai_eq_addrs
+				){
+  l3_assert(label_count_[i] > 0);
+  ai_labels.clear();
+  for (size_t j=0; j < label_count_[i]; j++) ai_labels.push_back(get_label(i, j));
+  ai_tags.clear();
+  ai_tag_vals.clear();
+  for (size_t j=0; j < tag_count_[i]; j++){
+    ai_tags.push_back(pool_.get(tag_label_ids_[tag_begin_[i] + j]));
+    ai_tag_vals.push_back(pool_.get_ptr(tag_val_ids_[tag_begin_[i] + j]));
   }
-  
-  //ai_eq_labels = std::vector<string>(equation_inds_.size(), "");
-  //ai_eq_addrs = std::vector<float*>(equation_inds_.size(), NULL);
+
   ai_eq_labels.clear();
   ai_eq_addrs.clear();
-  for (size_t i=0; i < equation_inds_.size(); i++){
-    Equation & cur_eq = equation_map_->get_eq(equation_inds_[i]);
+  for (size_t j=0; j < eq_count_[i]; j++){
+    Equation & cur_eq = equation_map_->get_eq(eq_inds_[eq_begin_[i] + j]);
     if (cur_eq.display_in_info_bar()) {
-	    //ai_eq_labels[i] = cur_eq.get_display_label();
-	    //ai_eq_addrs[i] = cur_eq.get_value_address();
 	    ai_eq_labels.push_back( cur_eq.get_display_label() );
 	    ai_eq_addrs.push_back(cur_eq.get_value_address());
     }
   }
 }
-
-
-std::string VisElem::get_group(){
-  return group_;
-}
-
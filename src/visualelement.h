@@ -3,6 +3,8 @@
 #include <vector>
 #include <unordered_map>
 #include <memory>
+#include <deque>
+#include <stdint.h>
 
 #include <AntTweakBar.h>
 #include "glm/glm.hpp"
@@ -33,82 +35,156 @@ struct vis_elem_repr{
 
   std::vector< std::string > labelled_data;
   std::vector< std::string > labelled_data_vs;
+
+  //if grid_layer is set the element is a cell of that layer instead of an svg
+  std::string grid_layer;
+  int grid_x;
+  int grid_y;
 };
 
 typedef struct vis_elem_repr vis_elem_repr;
 
 
-class VisElem{
-  /**
-     Represents a visual element.
-
-
-     I've kind of made a sketchy choice, so if you change any of the labelled data,
-     labels, or equations you need to call updateAIPointers
-
-   **/
-
+/**
+   Interns strings so the labels, groups and tags of every element share one
+   copy.  The strings live in a deque so pointers into it stay valid, the info
+   bar shows tag values through them.
+ **/
+class StringPool{
  public:
-  VisElem(SimpleRen * simple_ren, EquationMap * eqs,
-	  vis_elem_repr v );
-  
-  void set_drawn();
-  void set_not_drawn();
-  bool is_drawn();
+  uint32_t intern(const std::string & s);
+  const std::string & get(uint32_t id) const {return strs_[id];}
+  std::string * get_ptr(uint32_t id){return &strs_[id];}
+  size_t size() const {return strs_.size();}
+ private:
+  std::deque<std::string> strs_;
+  std::unordered_map<std::string, uint32_t> ids_;
+};
 
 
-  void set_highlighted(glm::vec3 col);
-  void set_not_highlighted();
-  
-  void update_color(size_t index);  
-  void update_all_equations();
+class ValueHistogram;
+class ValueRanking;
+class Sparklines;
 
-  glm::mat4 get_ms_transform();//ms = model space
-  std::string get_geo_id();
-  
-  int get_layer();
-  Equation & get_current_equation();
+#define VE_DRAWN 1
+#define VE_HIGHLIGHTED 2
 
-  void animate_highlight(float tstep);
+class VisElemStore{
+  /**
+     Holds every visual element as one entry in a set of parallel arrays.
 
+     Elements are referred to by index everywhere.  The per element state is a
+     few ints: render state indices, geometry, layer, group, displayed
+     equation and the drawn/highlighted flags.  Labels, tags and equation
+     indices are ranges into shared arrays so the per frame passes are linear
+     scans over contiguous memory.
+   **/
+ public:
+  VisElemStore(SimpleRen * simple_ren, EquationMap * eqs);
+
+  //returns the index of the new element
+  int add(vis_elem_repr v);
+  //rebuilds element i from v, call remove_from_renderer(i) first
+  void replace(size_t i, vis_elem_repr v);
+  //frees the render states, the element can't be drawn after this
+  void remove_from_renderer(size_t i);
+  //drops elements past n, they have to be removed from the renderer
+  void truncate(size_t n);
+
+  size_t size() const {return ren_index_.size();}
+
+  void set_drawn(size_t i);
+  void set_not_drawn(size_t i);
+  bool is_drawn(size_t i) const {return flags_[i] & VE_DRAWN;}
+  //bumped whenever an element is added, replaced, shown or hidden
+  unsigned long get_drawn_epoch() const {return drawn_epoch_;}
+  //shows or hides every element in a group
+  void set_group_drawn(std::string group, bool drawn);
+
+  void set_highlighted(size_t i, glm::vec3 col);
+  void set_not_highlighted(size_t i);
+  void animate_highlights(float tstep);
+
+  //the element colors are recalculated every frame, the min and max of an
+  //element's equation only every update_freq frames
+  void update_colors(size_t frame, size_t update_freq);
+  //returns the value that went into the color map
+  float update_color(size_t i, size_t index);
+  //a heatmap layer draws every cell with one color map, the one of the
+  //current equation of its first element
+  void update_layer_cmaps();
+  //the color pass adds the drawn elements' values to hist, NULL to stop
+  void set_histogram(ValueHistogram * hist){histogram_ = hist;}
+  //the same for the ranking of the highest or lowest values
+  void set_ranking(ValueRanking * ranking){ranking_ = ranking;}
+  //the color map values of every element, when it is sampling
+  void set_sparklines(Sparklines * sparklines){sparklines_ = sparklines;}
+  void update_all_equations(size_t i);
+
+  //elements with fewer equations show their first
   void set_eq_ind(unsigned int ind);
-  int get_num_eqs();
+  int get_num_eqs(size_t i) const {return eq_count_[i];}
+  Equation & get_current_equation(size_t i);
+
+  glm::mat4 get_ms_transform(size_t i);//ms = model space
+  std::string get_geo_id(size_t i) const {return pool_.get(geo_id_[i]);}
+  int get_layer(size_t i) const {return layer_[i];}
+  std::string get_group(size_t i) const {return pool_.get(group_[i]);}
+  std::vector<std::string> get_groups() const;
 
-  void get_all_info(std::vector<std::string> &labels, std::vector<std::string> & tags,
+  size_t get_num_labels(size_t i) const {return label_count_[i];}
+  const std::string & get_label(size_t i, size_t j) const {return pool_.get(label_ids_[label_begin_[i] + j]);}
+
+  void get_all_info(size_t i, std::vector<std::string> &labels, std::vector<std::string> & tags,
 		    std::vector<std::string*> & tag_vals,
 		    std::vector<std::string> & eq_labels,std::vector<float*> & eq_addrs
 		    );
 
-  bool string_matches_labels(const char * pattern);
-  bool string_matches_labels_quick(const char * pattern);
-
-  std::string get_group();
+  HeatmapLayer * get_heatmap_layer(size_t i) const {
+    return grid_layer_[i] < 0 ? NULL : grid_layers_[grid_layer_[i]];
+  }
+  int get_grid_x(size_t i) const {return grid_x_[i];}
+  int get_grid_y(size_t i) const {return grid_y_[i];}
 
-  std::vector< std::string > labels;
  private:
-  //VisElem( const VisElem& );
-  const VisElem& operator=( const VisElem& );
-
-  int has_eq_;
-  int simple_ren_index_;
-  int highlight_index_;
-  int layer_;
-  std::string geo_id_;
-  SimpleRen * s_ren;
-  float hXScale, hYScale, hTDelt;
-
-  
-  std::vector<int> equation_inds_;
-  EquationMap * equation_map_;
-  int eq_ind_;
-
-  std::string group_;
-	
-	
-  std::vector< std::string > l_data_labels; //labelled data things
-  std::vector< std::string > l_data_vals;
-  bool is_highlighted_;
-};
+  VisElemStore(const VisElemStore&); //prevent copy construction
+  VisElemStore& operator=(const VisElemStore&); //prevent assignment
 
+  void set_elem(size_t i, const vis_elem_repr & v);
+  uint32_t append_strings(const std::vector<std::string> & strs, std::vector<uint32_t> & ids);
 
-typedef std::shared_ptr<VisElem> VisElemPtr;
+  SimpleRen * s_ren_;
+  EquationMap * equation_map_;
+  StringPool pool_;
+  std::vector<HeatmapLayer*> grid_layers_;
+  float highlight_time_;
+  ValueHistogram * histogram_;
+  ValueRanking * ranking_;
+  Sparklines * sparklines_;
+  unsigned long drawn_epoch_;
+
+  //one entry per element
+  std::vector<int> ren_index_; //-1 for grid cells
+  std::vector<int> highlight_index_;
+  std::vector<uint32_t> geo_id_;
+  std::vector<int> layer_;
+  std::vector<uint32_t> group_;
+  std::vector<int> eq_ind_;
+  std::vector<unsigned char> flags_;
+  std::vector<int> grid_layer_; //index into grid_layers_ or -1
+  std::vector<int> grid_x_;
+  std::vector<int> grid_y_;
+
+  std::vector<uint32_t> eq_begin_;
+  std::vector<uint32_t> eq_count_;
+  std::vector<uint32_t> label_begin_;
+  std::vector<uint32_t> label_count_;
+  std::vector<uint32_t> tag_begin_;
+  std::vector<uint32_t> tag_count_;
+
+  //the ranges point into these
+  std::vector<int> eq_inds_;
+  std::vector<uint32_t> label_ids_;
+  std::vector<uint32_t> tag_label_ids_;
+  std::vector<uint32_t> tag_val_ids_;
+};